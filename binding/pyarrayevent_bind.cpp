@@ -145,8 +145,15 @@ void bind_dl2_event(nb::module_ &m) {
 }
 
 void bind_dl1_event(nb::module_ &m) {
+    nb::enum_<ImageRejection>(m, "ImageRejection")
+        .value("none", ImageRejection::none)
+        .value("too_few_picture_pixels", ImageRejection::too_few_picture_pixels)
+        .value("max_charge_too_low", ImageRejection::max_charge_too_low)
+        .value("total_charge_too_low", ImageRejection::total_charge_too_low)
+        .value("intensity_too_low", ImageRejection::intensity_too_low);
     nb::class_<DL1Event>(m, "DL1Event")
         .def_prop_ro("tels", &DL1Event::get_tels)
+        .def_ro("rejected_tels", &DL1Event::rejected_tels)
         .def("__repr__", [](DL1Event& self) {
             std::string repr = "DL1Event:\n";
             auto tels = self.get_tels();
@@ -162,16 +169,26 @@ void bind_dl1_event(nb::module_ &m) {
             }
             return repr;
         });
+    nb::class_<SparseImage>(m, "SparseImage")
+        .def_ro("n_pixels", &SparseImage::n_pixels)
+        .def_ro("pixel_id", &SparseImage::pixel_id)
+        .def_ro("charge", &SparseImage::charge)
+        .def_ro("peak_time", &SparseImage::peak_time)
+        .def("__len__", &SparseImage::size)
+        .def("__repr__", [](SparseImage& self) {
+            return fmt::format("SparseImage: {} of {} pixels", self.size(), self.n_pixels);
+        });
     nb::class_<DL1Camera>(m, "DL1Camera")
         .def_ro("image", &DL1Camera::image)
         .def_ro("peak_time", &DL1Camera::peak_time)
-        .def_ro("mask", &DL1Camera::mask)
+        .def_prop_ro("mask", [](const DL1Camera& self) { return self.mask.to_bools(); })
+        .def_ro("cleaned_image", &DL1Camera::cleaned_image)
         .def_ro("image_parameters", &DL1Camera::image_parameters)
         .def("__repr__", [](DL1Camera& self) {
             return fmt::format("DL1Camera:\n  image shape: {}x{}\n  peak_time shape: {}x{}\n  mask shape: {}x{}", 
                               self.image.rows(), self.image.cols(),
                               self.peak_time.rows(), self.peak_time.cols(),
-                              self.mask.rows(), self.mask.cols());
+                              self.mask.size(), 1);
         });
     nb::class_<ImageParameters>(m, "image_parameters")
         .def_ro("hillas", &ImageParameters::hillas)
@@ -350,7 +367,7 @@ void bind_simulated_event(nb::module_ &m) {
         .def_ro("impact_parameter", &SimulatedCamera::impact_parameter)
         .def("__repr__", &SimulatedCamera::print)
         .def_ro("fake_image", &SimulatedCamera::fake_image)
-        .def_ro("fake_image_mask", &SimulatedCamera::fake_image_mask)
+        .def_prop_ro("fake_image_mask", [](const SimulatedCamera& self) { return self.fake_image_mask.to_bools(); })
         .def_ro("pe_amplitude", &SimulatedCamera::pe_amplitude)
         .def_ro("pe_time", &SimulatedCamera::pe_time)
         .def_ro("time_range_10_90", &SimulatedCamera::time_range_10_90)
@@ -394,7 +411,7 @@ void bind_tel_monitor(nb::module_ &m) {
         .def_ro("n_pixels", &TelMonitor::n_pixels)
         .def_ro("pedestal_per_sample", &TelMonitor::pedestal_per_sample)
         .def_ro("dc_to_pe", &TelMonitor::dc_to_pe)
-        .def("__repr__", [](TelMonitor& self) {
+        .def("__repr__", [](const TelMonitor& self) {
             return fmt::format("TelMonitor:\n  n_channels: {}\n  n_pixels: {}", 
                               self.n_channels, self.n_pixels);
         });
@@ -10,6 +10,7 @@
 #include "LoggerInitialize.hh"
 #include "RootEventSource.hh"
 #include "SimtelEventSource.hh"
+#include "MultiSimtelEventSource.hh"
 namespace nb = nanobind;
 
 NB_MODULE(_pyeventsource, m){
@@ -94,10 +95,26 @@ NB_MODULE(_pyeventsource, m){
         .def(nb::init<const std::string&, int64_t, std::vector<int>, bool>(), nb::arg("filename"), nb::arg("max_events") = -1, nb::arg("subarray")=std::vector<int>{}, nb::arg("load_subarray_from_env")=false)
         .def_prop_ro("shower_array", &RootEventSource::get_shower_array)
         .def("__getitem__", &RootEventSource::operator[]);
+    nb::class_<SimtelReadOptions>(m, "SimtelReadOptions")
+        .def(nb::init<>())
+        .def_rw("prefetch_depth", &SimtelReadOptions::prefetch_depth)
+        .def_rw("prefetch_buffer_size", &SimtelReadOptions::prefetch_buffer_size)
+        .def_rw("max_prefetch_memory", &SimtelReadOptions::max_prefetch_memory)
+        .def_rw("compute_r1", &SimtelReadOptions::compute_r1)
+        .def_rw("save_event_index", &SimtelReadOptions::save_event_index);
     nb::class_<SimtelEventSource, EventSource>(m, "SimtelEventSource")
-        .def(nb::init<const std::string&, int64_t, std::vector<int>, bool>(), nb::arg("filename"), nb::arg("max_events") = -1, nb::arg("subarray")=std::vector<int>{}, nb::arg("load_simulated_showers")=false)
+        .def(nb::init<const std::string&, int64_t, std::vector<int>, bool, int, SimtelReadOptions>(), nb::arg("filename"), nb::arg("max_events") = -1, nb::arg("subarray")=std::vector<int>{}, nb::arg("load_simulated_showers")=false, nb::arg("gain_selector_threshold") = 4000, nb::arg("read_options") = SimtelReadOptions())
         .def_prop_ro("shower_array", &SimtelEventSource::get_shower_array)
+        .def("build_event_index", &SimtelEventSource::build_event_index, nb::arg("save_sidecar") = true)
+        .def("get_event_number", &SimtelEventSource::get_event_number, nb::arg("event_id"))
+        .def("__getitem__", &SimtelEventSource::operator[])
         .def("__repr__", &SimtelEventSource::print);
+    nb::class_<MultiSimtelEventSource, EventSource>(m, "MultiSimtelEventSource")
+        .def(nb::init<const std::vector<std::string>&, int, bool, int64_t, std::vector<int>, bool, int, SimtelReadOptions>(), nb::arg("filenames"), nb::arg("n_readers") = 4, nb::arg("ordered") = true, nb::arg("max_events") = -1, nb::arg("subarray")=std::vector<int>{}, nb::arg("load_simulated_showers")=false, nb::arg("gain_selector_threshold") = 4000, nb::arg("read_options") = SimtelReadOptions())
+        .def_static("expand_glob", &MultiSimtelEventSource::expand_glob, nb::arg("pattern"))
+        .def_ro("filenames", &MultiSimtelEventSource::filenames)
+        .def_prop_ro("shower_array", &MultiSimtelEventSource::get_shower_array)
+        .def("__repr__", &MultiSimtelEventSource::print);
     
     m.def("write_statistics", RootHistogram::write_statistics, nb::arg("statistics"), nb::arg("filename"));
 }
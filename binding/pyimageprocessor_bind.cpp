@@ -25,7 +25,9 @@ void bind_imageprocessor(nb::module_ &m)
             return "ImageProcessor:\n  Config: " + self.get_config_str();
         })
         .def_static("dilate_image", [](const CameraGeometry& camera_geometry, Eigen::Vector<bool, -1>& image_mask) {
-            ImageProcessor::dilate_image(camera_geometry, image_mask);
+            auto mask = PixelMask::from_bools(image_mask);
+            ImageProcessor::dilate_image(camera_geometry, mask);
+            image_mask = mask.to_bools();
         });
 }
 
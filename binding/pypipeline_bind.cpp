@@ -0,0 +1,23 @@
+#include "EventPipeline.hh"
+#include "nanobind/nanobind.h"
+#include "nanobind/stl/string.h"
+namespace nb = nanobind;
+
+void bind_pipeline(nb::module_ &m)
+{
+    nb::class_<EventPipeline>(m, "EventPipeline")
+        .def(nb::init<EventSource&>(), nb::arg("source"), nb::keep_alive<1, 2>())
+        .def(nb::init<EventSource&, const std::string&>(), nb::arg("source"), nb::arg("config_str"), nb::keep_alive<1, 2>())
+        // The workers never call into Python, so the GIL is released while the events are processed
+        .def("run", [](EventPipeline& self, DataWriter& data_writer) {
+            self.run(data_writer);
+        }, nb::arg("data_writer"), nb::call_guard<nb::gil_scoped_release>())
+        .def_prop_ro("n_workers", &EventPipeline::get_n_workers)
+        .def("__repr__", [](EventPipeline& self) {
+            return "EventPipeline:\n  Config: " + self.get_config_str();
+        });
+}
+
+NB_MODULE(_pylast_pipeline, m){
+    bind_pipeline(m);
+}
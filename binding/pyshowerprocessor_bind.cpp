@@ -14,16 +14,14 @@
 #include "nanobind/eigen/dense.h"
 namespace nb = nanobind;
 
-class PublicList: public GeometryReconstructor
+// The C++ reconstructors keep no state between calls, the python reconstructors read the
+// selected telescopes of the last call and fill the geometry themselves
+class PyGeometryReconstructor: public GeometryReconstructor
 {
     public:
-        using GeometryReconstructor::geometry;
-        using GeometryReconstructor::hillas_dicts;
-        using GeometryReconstructor::telescopes;
-        using GeometryReconstructor::array_pointing_direction;
-        using GeometryReconstructor::compute_angle_separation;
-        using GeometryReconstructor::convert_to_sky;
-        using GeometryReconstructor::convert_to_fov;
+        using GeometryReconstructor::GeometryReconstructor;
+        GeometryReconstructionInput input;
+        ReconstructedGeometry geometry{};
 };
 void bind_showerprocessor(nb::module_ &m) {
     nb::class_<ShowerProcessor>(m, "ShowerProcessor")
@@ -40,19 +38,29 @@ void bind_showerprocessor(nb::module_ &m) {
         .def("__call__", [](ImageQuery& self, const ImageParameters& image_parameters) {
             return self(image_parameters);
         });
-    nb::class_<GeometryReconstructor>(m, "GeometryReconstructor")
+    nb::class_<PyGeometryReconstructor>(m, "GeometryReconstructor")
         .def(nb::init<const SubarrayDescription&>(), nb::arg("subarray"))
         .def(nb::init<const SubarrayDescription&, const std::string&>(), nb::arg("subarray"), nb::arg("config_str"))
-        .def("__call__", [](GeometryReconstructor& self, ArrayEvent& event) {
-            self(event);
+        .def("__call__", [](PyGeometryReconstructor& self, ArrayEvent& event) {
+            self.input = self.select_telescopes(event);
+        })
+        .def_rw("geometry", &PyGeometryReconstructor::geometry)
+        .def_prop_ro("hillas_dicts", [](PyGeometryReconstructor& self) {
+            return self.input.hillas_dicts;
+        })
+        .def_prop_ro("telescopes", [](PyGeometryReconstructor& self) {
+            return self.input.telescopes;
+        })
+        .def_prop_ro("array_pointing_direction", [](PyGeometryReconstructor& self) {
+            return self.input.array_pointing_direction;
         })
-        .def_rw("geometry", &PublicList::geometry)
-        .def_ro("hillas_dicts", &PublicList::hillas_dicts)
-        .def_ro("telescopes", &PublicList::telescopes)
-        .def_ro("array_pointing_direction", &PublicList::array_pointing_direction)
-        .def_static("compute_angle_separation", &PublicList::compute_angle_separation)
-        .def("convert_to_sky", &PublicList::convert_to_sky)
-        .def("convert_to_fov", &PublicList::convert_to_fov);
+        .def_static("compute_angle_separation", &GeometryReconstructor::compute_angle_separation)
+        .def("convert_to_sky", [](PyGeometryReconstructor& self, double fov_x, double fov_y) {
+            return GeometryReconstructor::convert_to_sky(*self.input.nominal_frame, fov_x, fov_y);
+        }, nb::arg("fov_x"), nb::arg("fov_y"))
+        .def("convert_to_fov", [](PyGeometryReconstructor& self, double alt, double az) {
+            return GeometryReconstructor::convert_to_fov(*self.input.nominal_frame, alt, az);
+        }, nb::arg("alt"), nb::arg("az"));
     nb::class_<MLReconstructor>(m, "MLReconstructor")
         .def(nb::init<const std::string&>(), nb::arg("config_str"))
         .def_ro("telescopes", &MLReconstructor::telescopes)
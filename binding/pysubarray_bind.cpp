@@ -27,7 +27,7 @@ void bind_subarray_description(nb::module_ &m)
 
     nb::class_<CameraDescription>(m, "CameraDescription")
         .def_ro("camera_name", &CameraDescription::camera_name)
-        .def_ro("geometry", &CameraDescription::camera_geometry)
+        .def_prop_ro("geometry", [](const CameraDescription& self) -> const CameraGeometry& { return *self.camera_geometry; }, nb::rv_policy::reference_internal)
         .def_ro("readout", &CameraDescription::camera_readout)
         .def("__repr__", &CameraDescription::print);
     nb::class_<CameraReadout>(m, "CameraReadout")
@@ -38,6 +38,7 @@ void bind_subarray_description(nb::module_ &m)
         .def_ro("n_channels", &CameraReadout::n_channels)
         .def_ro("n_pixels", &CameraReadout::n_pixels)
         .def_ro("n_samples", &CameraReadout::n_samples)
+        .def_ro("gain_selector_threshold", &CameraReadout::gain_selector_threshold)
         .def("__repr__", &CameraReadout::print);
     nb::class_<CameraGeometry>(m, "CameraGeometry")
         .def_ro("camera_name", &CameraGeometry::camera_name)
@@ -2,11 +2,12 @@
  * @file ArrayEvent.hh
  * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
  * @brief core class to describe an array event
- * @version 0.2
+ * @version 0.3
  * @date 2024-12-07
  * 
  * @changelog
  * - v0.2: Follow the rule of zero, clear up the code.
+ * - v0.3: Keep the storage of the data levels for reuse through ArrayEventPool.
  *
  * @copyright Copyright (c) 2024
  * 
@@ -14,6 +15,9 @@
  #pragma once
 #include "SimulatedEvent.hh"
 #include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include "R0Event.hh"
 #include "R1Event.hh"
 #include "EventMonitor.hh"
@@ -28,6 +32,25 @@
 class ArrayEvent {
 public:
     ArrayEvent() = default;
+    /**
+     * @brief Moving leaves the other event without data levels, so a moved-from event is not taken for a recyclable one
+     */
+    ArrayEvent(ArrayEvent&& other) noexcept { *this = std::move(other); }
+    ArrayEvent& operator=(ArrayEvent&& other) noexcept
+    {
+        simulation = std::exchange(other.simulation, std::nullopt);
+        r0 = std::exchange(other.r0, std::nullopt);
+        r1 = std::exchange(other.r1, std::nullopt);
+        monitor = std::exchange(other.monitor, std::nullopt);
+        dl0 = std::exchange(other.dl0, std::nullopt);
+        dl1 = std::exchange(other.dl1, std::nullopt);
+        pointing = std::exchange(other.pointing, std::nullopt);
+        dl2 = std::exchange(other.dl2, std::nullopt);
+        spare_levels = std::move(other.spare_levels);
+        event_id = other.event_id;
+        run_id = other.run_id;
+        return *this;
+    }
     std::optional<SimulatedEvent> simulation;
     std::optional<R0Event> r0;
     std::optional<R1Event> r1;
@@ -36,6 +59,75 @@ public:
     std::optional<DL1Event> dl1;
     std::optional<Pointing> pointing;
     std::optional<DL2Event> dl2;
-    int event_id;
-    int run_id;
-};
\ No newline at end of file
+    // Sources that do not know the ids leave them at 0, the fake image noise is keyed by them
+    int event_id = 0;
+    int run_id = 0;
+
+    /**
+     * @brief Get the data level, creating it from the storage kept by reset() if it is not set yet
+     * 
+     * @tparam Level One of the data level classes, e.g. R0Event
+     */
+    template<typename Level>
+    Level& emplace_level()
+    {
+        auto& level = level_of<Level>();
+        if(!level)
+        {
+            level.emplace(std::move(std::get<Level>(spare_levels)));
+        }
+        return *level;
+    }
+    /**
+     * @brief Unset all data levels and ids, keeping the telescope storage for emplace_level()
+     */
+    void reset()
+    {
+        reset_level(simulation);
+        reset_level(r0);
+        reset_level(r1);
+        reset_level(monitor);
+        reset_level(dl0);
+        reset_level(dl1);
+        reset_level(pointing);
+        reset_level(dl2);
+        event_id = 0;
+        run_id = 0;
+    }
+    /**
+     * @brief Whether any data level is set
+     */
+    bool has_levels() const
+    {
+        return simulation || r0 || r1 || monitor || dl0 || dl1 || pointing || dl2;
+    }
+private:
+    template<typename Level>
+    std::optional<Level>& level_of()
+    {
+        if constexpr (std::is_same_v<Level, SimulatedEvent>) return simulation;
+        else if constexpr (std::is_same_v<Level, R0Event>) return r0;
+        else if constexpr (std::is_same_v<Level, R1Event>) return r1;
+        else if constexpr (std::is_same_v<Level, EventMonitor>) return monitor;
+        else if constexpr (std::is_same_v<Level, DL0Event>) return dl0;
+        else if constexpr (std::is_same_v<Level, DL1Event>) return dl1;
+        else if constexpr (std::is_same_v<Level, Pointing>) return pointing;
+        else
+        {
+            static_assert(std::is_same_v<Level, DL2Event>, "Unknown data level");
+            return dl2;
+        }
+    }
+    template<typename Level>
+    void reset_level(std::optional<Level>& level)
+    {
+        if(level)
+        {
+            level->reset();
+            std::get<Level>(spare_levels) = std::move(*level);
+            level.reset();
+        }
+    }
+    // Data levels unset by reset(), with the storage of their telescopes
+    std::tuple<SimulatedEvent, R0Event, R1Event, EventMonitor, DL0Event, DL1Event, Pointing, DL2Event> spare_levels;
+};
@@ -0,0 +1,45 @@
+/**
+ * @file ArrayEventPool.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Pool of processed events whose storage is reused for the next events
+ * @version 0.1
+ * @date 2025-04-12
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include "ArrayEvent.hh"
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Events given back once they are written, reset but with their per-telescope buffers allocated.
+ *        An event source fills the acquired events in place, so for telescopes with the same number
+ *        of pixels and samples as before no new memory is needed.
+ *
+ *        The pool can be shared by threads, e.g. a reader acquiring and a writer recycling events.
+ */
+class ArrayEventPool
+{
+public:
+    explicit ArrayEventPool(size_t max_events = 16);
+    ArrayEventPool(const ArrayEventPool&) = delete;
+    ArrayEventPool& operator=(const ArrayEventPool&) = delete;
+
+    /**
+     * @brief A recycled event if there is one, otherwise a new event
+     */
+    ArrayEvent acquire();
+    /**
+     * @brief Reset the event and keep it for the next acquire().
+     *        Events without data levels and events beyond max_events are dropped.
+     */
+    void recycle(ArrayEvent&& event);
+    size_t size() const;
+private:
+    size_t max_events;
+    std::vector<ArrayEvent> events;
+    mutable std::mutex mutex;
+};
@@ -4,17 +4,198 @@
  * @brief Basic container for telescope data
  * @version 0.1
  * @date 2025-01-16
- * 
+ *
  * @copyright Copyright (c) 2025
- * 
+ *
  */
  #pragma once
- #include <unordered_map>
- #include <memory>
+ #include <algorithm>
+ #include <bit>
+ #include <cstddef>
+ #include <cstdint>
+ #include <iterator>
  #include <map>
+ #include <optional>
+ #include <stdexcept>
+ #include <string>
+ #include <utility>
  #include <vector>
- #include <algorithm>
 
+/**
+ * @brief Telescope data stored in place in a dense array indexed by tel_id, with an occupancy bitset.
+ *        Iterating yields (tel_id, TelData*) pairs in ascending tel_id order, like the map of pointers it replaces.
+ *
+ *        As with the map of pointers, the telescope data is not const through a const container.
+ *
+ *        Adding a tel_id larger than the current capacity may move the stored telescopes, call reserve()
+ *        with the largest tel_id first to keep the pointers returned by emplace() valid.
+ */
+template<typename TelData>
+class DenseTelMap
+{
+    public:
+        class Iterator
+        {
+            public:
+                using value_type = std::pair<int, TelData*>;
+                using reference = value_type&;
+                using pointer = value_type*;
+                using difference_type = std::ptrdiff_t;
+                using iterator_category = std::input_iterator_tag;
+                Iterator(const DenseTelMap* map, int tel_id): map(map) { seek(tel_id); }
+                reference operator*() { return current; }
+                pointer operator->() { return &current; }
+                Iterator& operator++() { seek(current.first + 1); return *this; }
+                bool operator==(const Iterator& other) const { return current.first == other.current.first; }
+                bool operator!=(const Iterator& other) const { return !(*this == other); }
+            private:
+                void seek(int tel_id)
+                {
+                    tel_id = map->next_tel(tel_id);
+                    current = {tel_id, tel_id < map->capacity() ? &*map->slots[tel_id] : nullptr};
+                }
+                const DenseTelMap* map;
+                // The pair is kept in the iterator, so structured bindings can refer to it
+                value_type current;
+        };
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+        DenseTelMap() = default;
+        DenseTelMap(DenseTelMap&& other) noexcept:
+            slots(std::move(other.slots)), occupied(std::move(other.occupied)), n_tels(std::exchange(other.n_tels, 0)) {}
+        DenseTelMap& operator=(DenseTelMap&& other) noexcept
+        {
+            slots = std::move(other.slots);
+            occupied = std::move(other.occupied);
+            n_tels = std::exchange(other.n_tels, 0);
+            return *this;
+        }
+
+        template<typename... Args>
+        TelData* emplace(int tel_id, Args&&... args)
+        {
+            if(tel_id < 0)
+            {
+                throw std::out_of_range("Negative tel_id " + std::to_string(tel_id));
+            }
+            if(contains(tel_id))
+            {
+                return nullptr;
+            }
+            if(tel_id >= capacity())
+            {
+                // Grow geometrically, the telescopes are usually added in ascending tel_id order
+                reserve(std::max(tel_id, 2 * capacity()));
+            }
+            slots[tel_id].emplace(std::forward<Args>(args)...);
+            occupied[tel_id / 64] |= uint64_t(1) << (tel_id % 64);
+            n_tels++;
+            return &*slots[tel_id];
+        }
+        /**
+         * @brief Make room for the telescopes up to max_tel_id
+         */
+        void reserve(int max_tel_id)
+        {
+            if(max_tel_id < capacity())
+            {
+                return;
+            }
+            slots.resize(max_tel_id + 1);
+            occupied.resize((max_tel_id + 64) / 64, 0);
+        }
+        /**
+         * @brief Add tel_id reusing the data a previous event left in its slot, its fields still hold the old values.
+         *        Without old data the telescope is default constructed. Returns nullptr if tel_id is already present.
+         */
+        TelData* reuse(int tel_id)
+        {
+            if(tel_id < 0 || tel_id >= capacity() || !slots[tel_id].has_value())
+            {
+                return emplace(tel_id);
+            }
+            if(contains(tel_id))
+            {
+                return nullptr;
+            }
+            occupied[tel_id / 64] |= uint64_t(1) << (tel_id % 64);
+            n_tels++;
+            return &*slots[tel_id];
+        }
+        /**
+         * @brief Remove tel_id but keep its data, so reuse() can hand out its buffers again
+         */
+        void release(int tel_id)
+        {
+            if(contains(tel_id))
+            {
+                occupied[tel_id / 64] &= ~(uint64_t(1) << (tel_id % 64));
+                n_tels--;
+            }
+        }
+        TelData* get(int tel_id) const { return contains(tel_id) ? &*slots[tel_id] : nullptr; }
+        TelData* at(int tel_id) const
+        {
+            if(!contains(tel_id))
+            {
+                throw std::out_of_range("No data for tel_id " + std::to_string(tel_id));
+            }
+            return &*slots[tel_id];
+        }
+        bool contains(int tel_id) const
+        {
+            return tel_id >= 0 && tel_id < capacity() && (occupied[tel_id / 64] >> (tel_id % 64) & 1);
+        }
+        size_t count(int tel_id) const { return contains(tel_id) ? 1 : 0; }
+        size_t size() const { return n_tels; }
+        bool empty() const { return n_tels == 0; }
+        /**
+         * @brief Remove all telescopes, the capacity is kept
+         */
+        void clear()
+        {
+            for(auto& slot: slots)
+            {
+                slot.reset();
+            }
+            release_all();
+        }
+        /**
+         * @brief Remove all telescopes but keep their data, so reuse() can hand out the allocated buffers again
+         */
+        void release_all()
+        {
+            std::fill(occupied.begin(), occupied.end(), 0);
+            n_tels = 0;
+        }
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, capacity()); }
+    private:
+        int capacity() const { return static_cast<int>(slots.size()); }
+        // First occupied tel_id not smaller than tel_id, capacity() if there is none
+        int next_tel(int tel_id) const
+        {
+            if(tel_id >= capacity())
+            {
+                return capacity();
+            }
+            size_t word = tel_id / 64;
+            uint64_t bits = occupied[word] & (~uint64_t(0) << (tel_id % 64));
+            while(bits == 0)
+            {
+                if(++word == occupied.size())
+                {
+                    return capacity();
+                }
+                bits = occupied[word];
+            }
+            return static_cast<int>(word * 64 + std::countr_zero(bits));
+        }
+        mutable std::vector<std::optional<TelData>> slots;
+        std::vector<uint64_t> occupied;
+        size_t n_tels = 0;
+};
 
 template<typename TelData>
 class BaseTelContainer{
@@ -25,39 +206,48 @@ class BaseTelContainer{
         BaseTelContainer& operator=(const BaseTelContainer& other) = delete;
         BaseTelContainer(BaseTelContainer&& other) noexcept = default;
         BaseTelContainer& operator=(BaseTelContainer&& other) noexcept = default;
-        std::unordered_map<int, std::unique_ptr<TelData>> tels;
+        DenseTelMap<TelData> tels;
         template<typename... Args>
         TelData* add_tel(int tel_id, Args&&... args) {
-            if (tels.find(tel_id) != tels.end()) {
-                return nullptr;
-            }
-            auto [it, success] = tels.emplace(
-                tel_id, 
-                std::make_unique<TelData>(std::forward<Args>(args)...)
-            );
-            return success ? it->second.get() : nullptr;
+            return tels.emplace(tel_id, std::forward<Args>(args)...);
         }
         TelData* get_tel(int tel_id) {
-            auto it = tels.find(tel_id);
-            return it != tels.end() ? it->second.get() : nullptr;
+            return tels.get(tel_id);
         }
         const TelData* get_tel(int tel_id) const {
-            auto it = tels.find(tel_id);
-            return it != tels.end() ? it->second.get() : nullptr;
+            return tels.get(tel_id);
+        }
+        /**
+         * @brief Add tel_id with the storage of the telescope data a previous event left, see DenseTelMap::reuse
+         */
+        TelData* reuse_tel(int tel_id) {
+            return tels.reuse(tel_id);
+        }
+        /**
+         * @brief Remove tel_id, keeping its storage for reuse_tel
+         */
+        void release_tel(int tel_id) {
+            tels.release(tel_id);
+        }
+        /**
+         * @brief Remove all telescopes, keeping their storage for reuse_tel
+         */
+        void reset() {
+            tels.release_all();
         }
         std::map<int, TelData*> get_tels() const {
             std::map<int, TelData*> rels;
-            for(const auto& pair : tels){
-                rels[pair.first] = pair.second.get();
+            for(const auto& [tel_id, tel_data] : tels){
+                rels.emplace_hint(rels.end(), tel_id, tel_data);
             }
             return rels;
         }
         std::vector<int> get_ordered_tels() const {
             std::vector<int> ordered_tels;
-            for(const auto& pair : tels){
-                ordered_tels.push_back(pair.first);
+            ordered_tels.reserve(tels.size());
+            for(const auto& [tel_id, tel_data] : tels){
+                ordered_tels.push_back(tel_id);
             }
-            std::sort(ordered_tels.begin(), ordered_tels.end(), std::less<int>());
             return ordered_tels;
         }
-};
\ No newline at end of file
+};
@@ -15,14 +15,6 @@
 #include "ArrayEvent.hh"
 #include "ImageExtractor.hh"
 #include "Configurable.hh"
- /**
-  * @brief Select the gain channel by threshold
-  * 
-  * @param waveform  2-channel waveform (assume the first channel is the high gain channel, sometimes the second channel is 0)
-  * @param threshold threshold for the low gain channel
-  * @return Eigen::VectorXi
-  */
- Eigen::VectorXi select_gain_channel_by_threshold(const std::array<Eigen::Matrix<uint16_t, -1, -1, Eigen::RowMajor>, 2>& waveform, const double threshold);
 
 
 class ImageExtractorFactory
@@ -53,9 +45,12 @@ class Calibrator: public Configurable
     void configure(const json& config) override;
     ~Calibrator() = default;
 
-    void operator()(ArrayEvent& event);
+    void operator()(ArrayEvent& event) const;
     std::unique_ptr<ImageExtractor> image_extractor;
     private:
         const SubarrayDescription& subarray;
         std::string image_extractor_type;
+        // Extract the telescopes of an event on the shared thread pool if there are at least min_parallel_telescopes
+        bool parallel_telescopes;
+        size_t min_parallel_telescopes;
 };
\ No newline at end of file
@@ -10,6 +10,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 #include "CameraGeometry.hh"
 #include "CameraReadout.hh"
@@ -20,8 +21,8 @@ class CameraDescription
 public:
     /** @brief Name of the camera */
     string camera_name;
-    /** @brief Geometry of the camera */
-    CameraGeometry camera_geometry;
+    /** @brief Geometry of the camera, shared by the telescopes with the same camera */
+    std::shared_ptr<const CameraGeometry> camera_geometry;
     /** @brief Readout of the camera */
     CameraReadout camera_readout;
     
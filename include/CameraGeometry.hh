@@ -13,6 +13,9 @@
 #include "Eigen/Dense"
 #include "Eigen/Sparse"
 #include "Eigen/src/Core/Matrix.h"
+#include "PixelMask.hh"
+#include <cstdint>
+#include <vector>
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
 using std::string;
@@ -42,8 +45,14 @@ public:
     double cam_rotation;
     /** @brief Neighbor matrix  row i is the neighbor of pixel i */
     Eigen::SparseMatrix<int, Eigen::RowMajor> neigh_matrix;
-    /** @brief Map from width to border pixel mask */
-    std::unordered_map<int, Eigen::Vector<bool, -1>> border_pixel_mask; 
+    /**
+     * @brief Neighbor lists in CSR form, the neighbors of pixel i are
+     *        neighbor_indices[neighbor_offsets[i]] ... neighbor_indices[neighbor_offsets[i + 1] - 1]
+     */
+    std::vector<int32_t> neighbor_offsets;
+    std::vector<int16_t> neighbor_indices;
+    /** @brief Map from width to border pixel mask, filled with the neighbor matrix for every width up to the one covering the camera */
+    std::unordered_map<int, PixelMask> border_pixel_mask; 
     /** @brief Pixel width [m] */
     Eigen::VectorXd pix_width;
     /** @brief Pixel width in the fov frame [rad] */
@@ -67,11 +76,15 @@ public:
     const string print() const;
     /**
      * @brief Get the border pixel within a certain width 
-     *        
+     *        All widths are computed with the neighbor matrix, so a const geometry can be shared between threads
      * @param width 
-     * @return Eigen::Vector<bool, -1> 
+     * @return PixelMask 
+     */
+    PixelMask get_border_pixel_mask(int width) const;
+    /**
+     * @brief Add the neighbors of the set pixels to the mask
      */
-    Eigen::Vector<bool, -1> get_border_pixel_mask(int width);
+    void dilate(PixelMask& mask) const;
     Eigen::VectorXd get_pix_x_fov() const
     {
         if(pix_x_fov.size() == 0)
@@ -89,4 +102,11 @@ public:
         return pix_y_fov;
     }
     void compute_neighbor_matrix(bool diagonal = false);
+    /**
+     * @brief Fill the pixel positions and widths in the fov frame [rad]
+     * @param focal_length focal length of the optics [m]
+     */
+    void compute_fov_coordinates(double focal_length);
+private:
+    PixelMask compute_border_pixel_mask(int width) const;
 };
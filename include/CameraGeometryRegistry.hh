@@ -0,0 +1,63 @@
+/**
+ * @file CameraGeometryRegistry.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Camera geometries shared between the telescopes with the same camera
+ * @version 0.1
+ * @date 2025-04-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include "CameraGeometry.hh"
+#include "Eigen/Dense"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Builds every camera geometry once, keyed by camera name, a hash of the pixel table and the focal length.
+ *        The neighbor lists, the border masks and the fov coordinates are computed when the geometry is built,
+ *        so the returned geometries are never modified and can be shared between telescopes and threads.
+ *        The registry only keeps weak references, a geometry is freed with the last subarray using it.
+ */
+class CameraGeometryRegistry
+{
+public:
+    CameraGeometryRegistry() = default;
+    CameraGeometryRegistry(const CameraGeometryRegistry&) = delete;
+    CameraGeometryRegistry& operator=(const CameraGeometryRegistry&) = delete;
+
+    /**
+     * @brief Geometry of the pixel table, built on the first request
+     * @param focal_length focal length of the optics used for the fov coordinates [m]
+     */
+    std::shared_ptr<const CameraGeometry> get(const std::string& camera_name, const Eigen::Ref<const Eigen::VectorXd>& pix_x, const Eigen::Ref<const Eigen::VectorXd>& pix_y, const Eigen::Ref<const Eigen::VectorXd>& pix_area, const Eigen::Ref<const Eigen::VectorXi>& pix_type, double cam_rotation, double focal_length);
+    /**
+     * @brief Number of geometries still in use
+     */
+    size_t size() const;
+
+    /**
+     * @brief Registry shared by all event sources, so the readers of several files share the geometries too
+     */
+    static CameraGeometryRegistry& shared();
+private:
+    struct Key
+    {
+        std::string camera_name;
+        uint64_t pixel_hash;
+        double focal_length;
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+    static uint64_t hash_pixel_table(const Eigen::Ref<const Eigen::VectorXd>& pix_x, const Eigen::Ref<const Eigen::VectorXd>& pix_y, const Eigen::Ref<const Eigen::VectorXd>& pix_area, const Eigen::Ref<const Eigen::VectorXi>& pix_type, double cam_rotation);
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, std::weak_ptr<const CameraGeometry>, KeyHash> geometries;
+};
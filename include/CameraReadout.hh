@@ -33,6 +33,8 @@ public:
     int n_samples;
     /** @brief Expected pulse shape for a signal in the waveform. 2 dimensional, first dimension is gain channel */
     Eigen::MatrixXd reference_pulse_shape;
+    /** @brief ADC count of the high gain channel above which the low gain channel is selected */
+    double gain_selector_threshold = 4000;
 
 
     const string print() const;
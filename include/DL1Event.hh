@@ -12,6 +12,25 @@
 #include "ImageParameters.hh"
 #include <Eigen/Dense>
 #include "BaseTelContainer.hh"
+#include "MapNodePool.hh"
+#include "PixelMask.hh"
+#include "SparseImage.hh"
+#include <cstdint>
+#include <map>
+/**
+ * @brief Why the image of a triggered telescope has no DL1 parameters
+ *
+ */
+enum class ImageRejection : uint8_t
+{
+    none = 0,
+    // Pre-screen of the DL0 image, before the cleaning
+    too_few_picture_pixels,
+    max_charge_too_low,
+    total_charge_too_low,
+    // Intensity of the cleaned image
+    intensity_too_low
+};
 class DL1Camera
 {
     public:
@@ -35,10 +54,30 @@ class DL1Camera
      * @brief Get the pixel mask after tail_cuts clean
      * 
      */
-    Eigen::Vector<bool, -1> mask;
+    PixelMask mask;
+    /**
+     * @brief The pixels surviving the cleaning with their charges and peak times
+     *
+     */
+    SparseImage cleaned_image;
 };
 class DL1Event: public BaseTelContainer<DL1Camera>
 {
     public:
     DL1Event() = default;
+    /**
+     * @brief Telescopes with a DL0 image that were not parameterised, with the reason
+     *
+     */
+    std::map<int, ImageRejection> rejected_tels;
+    void reject_tel(int tel_id, ImageRejection reason) {
+        rejected_nodes.acquire(rejected_tels, tel_id) = reason;
+    }
+    void reset() {
+        BaseTelContainer::reset();
+        rejected_nodes.release_all(rejected_tels);
+    }
+    private:
+    // Map nodes of the rejected telescopes of the previous events
+    MapNodePool<std::map<int, ImageRejection>> rejected_nodes;
 };
\ No newline at end of file
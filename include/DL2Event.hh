@@ -11,7 +11,9 @@
 
 #pragma once
 
+#include "MapNodePool.hh"
 #include "ReconstructedGeometry.hh"
+#include <algorithm>
 #include <unordered_map>
 #include <string>
 #include "TelImpactParameter.hh"
@@ -55,36 +57,46 @@ class DL2Event
         std::unordered_map<int, TelReconstructedParameter> tels;
         std::unordered_map<std::string, ReconstructedEnergy> energy;
         std::unordered_map<std::string, ReconstructedParticle> particle;
-        void add_tel(int tel_id, TelReconstructedParameter tel_reconstructed_parameter)
+        /**
+         * @brief Remove all entries, their map nodes are kept for the next event
+         */
+        void reset()
         {
-            tels[tel_id] = tel_reconstructed_parameter;
+            geometry_nodes.release_all(geometry);
+            tel_nodes.release_all(tels);
+            energy_nodes.release_all(energy);
+            particle_nodes.release_all(particle);
         }
-        void add_energy(std::string name, ReconstructedEnergy energy)
+        void add_tel(int tel_id, const TelReconstructedParameter& tel_reconstructed_parameter)
         {
-            this->energy[name] = energy;
+            tel_nodes.acquire(tels, tel_id) = tel_reconstructed_parameter;
         }
-        void add_geometry(std::string name, ReconstructedGeometry geometry)
+        void add_energy(const std::string& name, const ReconstructedEnergy& energy)
         {
-            this->geometry[name] = geometry;
+            energy_nodes.acquire(this->energy, name) = energy;
         }
-        void add_particle(std::string name, ReconstructedParticle particle)
+        void add_geometry(const std::string& name, const ReconstructedGeometry& geometry)
         {
-            this->particle[name] = particle;
+            geometry_nodes.acquire(this->geometry, name) = geometry;
         }
-        void add_tel_geometry(int tel_id, double impact_parameter, std::string geometry_reconstructor_name)
+        void add_particle(const std::string& name, const ReconstructedParticle& particle)
         {
-            TelReconstructedParameter tel_reconstructed_parameter;
+            particle_nodes.acquire(this->particle, name) = particle;
+        }
+        void add_tel_geometry(int tel_id, double impact_parameter, const std::string& geometry_reconstructor_name)
+        {
+            auto& tel_reconstructed_parameter = reset_tel(tel_id, [&geometry_reconstructor_name](const std::string& name) { return name == geometry_reconstructor_name; });
             tel_reconstructed_parameter.impact_parameters[geometry_reconstructor_name] = TelImpactParameter{impact_parameter, 0};
-            tels[tel_id] = tel_reconstructed_parameter;
         }
         void add_tel_geometry(int tel_id, std::vector<double> impact_parameters, std::vector<std::string> reconstructor_names)
         {
-            TelReconstructedParameter tel_reconstructed_parameter;
+            auto& tel_reconstructed_parameter = reset_tel(tel_id, [&reconstructor_names](const std::string& name) {
+                return std::find(reconstructor_names.begin(), reconstructor_names.end(), name) != reconstructor_names.end();
+            });
             for(size_t i = 0; i < impact_parameters.size(); i++)
             {
                 tel_reconstructed_parameter.impact_parameters[reconstructor_names[i]] = TelImpactParameter{impact_parameters[i], 0};
             }
-            tels[tel_id] = tel_reconstructed_parameter;
         }
         void set_tel_estimate_energy(int tel_id, double energy)
         {
@@ -105,4 +117,23 @@ class DL2Event
                 tels[tel_ids[i]].estimate_disp = disps[i];
             }
         }
+    private:
+        MapNodePool<std::unordered_map<std::string, ReconstructedGeometry>> geometry_nodes;
+        MapNodePool<std::unordered_map<int, TelReconstructedParameter>> tel_nodes;
+        MapNodePool<std::unordered_map<std::string, ReconstructedEnergy>> energy_nodes;
+        MapNodePool<std::unordered_map<std::string, ReconstructedParticle>> particle_nodes;
+        /**
+         * @brief Parameters of tel_id with the estimates unset and only the impact parameters of the kept reconstructors,
+         *        whose nodes are overwritten next instead of being allocated again
+         */
+        template<typename KeepName>
+        TelReconstructedParameter& reset_tel(int tel_id, KeepName keep_name)
+        {
+            auto& tel_reconstructed_parameter = tel_nodes.acquire(tels, tel_id);
+            tel_reconstructed_parameter.estimate_energy = 0;
+            tel_reconstructed_parameter.estimate_hadroness = 0;
+            tel_reconstructed_parameter.estimate_disp = 0;
+            std::erase_if(tel_reconstructed_parameter.impact_parameters, [&keep_name](const auto& entry) { return !keep_name(entry.first); });
+            return tel_reconstructed_parameter;
+        }
 };
\ No newline at end of file
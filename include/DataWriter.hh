@@ -48,6 +48,10 @@
         virtual void write_event(const ArrayEvent& event) = 0;
         virtual void write_statistics(const Statistics& statistics, bool last) = 0;
         //virtual void write_simulation_config() = 0;
+        // Store the pixel masks of the images as 64 bit words instead of one bool per pixel
+        bool pack_masks = false;
+        // Store only the pixels surviving the cleaning for the DL1 images
+        bool sparse_images = false;
     protected:
         EventSource& source;
         std::string filename;
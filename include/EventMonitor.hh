@@ -10,14 +10,54 @@
  */
 
  #pragma once
- #include <unordered_map>
+ #include "BaseTelContainer.hh"
  #include "Eigen/Dense"
  #include <optional>
+ #include <map>
+ #include <memory>
+ #include <vector>
+ #include <algorithm>
  #include <TelMonitor.hh>
- #include <BaseTelContainer.hh>
- class EventMonitor: public BaseTelContainer<TelMonitor>
+ /**
+  * @brief The monitoring data only changes with new monitor/calibration blocks, so the events
+  *        share the same immutable TelMonitor until then instead of holding their own copy.
+  */
+ class EventMonitor
  {
    public:
     EventMonitor() = default;
+    DenseTelMap<std::shared_ptr<const TelMonitor>> tels;
+    const TelMonitor* add_tel(int tel_id, std::shared_ptr<const TelMonitor> tel_monitor) {
+        auto* added = tels.emplace(tel_id, std::move(tel_monitor));
+        return added ? added->get() : nullptr;
+    }
+    const TelMonitor* add_tel(int tel_id, TelMonitor&& tel_monitor) {
+        return add_tel(tel_id, std::make_shared<const TelMonitor>(std::move(tel_monitor)));
+    }
+    const TelMonitor* get_tel(int tel_id) const {
+        auto* tel_monitor = tels.get(tel_id);
+        return tel_monitor ? tel_monitor->get() : nullptr;
+    }
+    std::map<int, const TelMonitor*> get_tels() const {
+        std::map<int, const TelMonitor*> rels;
+        for(const auto& [tel_id, tel_monitor] : tels){
+            rels.emplace_hint(rels.end(), tel_id, tel_monitor->get());
+        }
+        return rels;
+    }
+    std::vector<int> get_ordered_tels() const {
+        std::vector<int> ordered_tels;
+        ordered_tels.reserve(tels.size());
+        for(const auto& [tel_id, tel_monitor] : tels){
+            ordered_tels.push_back(tel_id);
+        }
+        return ordered_tels;
+    }
+    /**
+     * @brief Drop the shared monitors, the telescope slots are kept
+     */
+    void reset() {
+        tels.clear();
+    }
  };
 
@@ -0,0 +1,83 @@
+/**
+ * @file EventPipeline.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Process the events of a source on several worker threads
+ * @version 0.1
+ * @date 2025-04-02
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include "Calibration.hh"
+#include "Configurable.hh"
+#include "DataWriter.hh"
+#include "EventSource.hh"
+#include "ImageProcessor.hh"
+#include "ShowerProcessor.hh"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief EventPipeline runs Calibrator, ImageProcessor and ShowerProcessor on a pool of worker threads,
+ *        the events are read from the source and written in the order of the source.
+ *
+ *        The source is read and the output is written on the thread calling run(), the eventio state of
+ *        SimtelEventSource is thread local so the source can not move to another thread. At most
+ *        max_events_in_flight events are read but not yet written, which bounds both the input and the output queue.
+ *        The processors are const-callable and keep no state between events, so one instance of each
+ *        processor is shared by all workers.
+ *
+ *        The configuration has the keys "calibrator", "image_processor" and "shower_processor" for the processors,
+ *        "n_workers" and "max_events_in_flight".
+ */
+class EventPipeline: public Configurable
+{
+public:
+    DECLARE_CONFIGURABLE_DEFINITIONS(EventSource&, source, EventPipeline);
+    ~EventPipeline();
+    static json get_default_config();
+    json default_config() const override {return get_default_config();}
+    void configure(const json& config) override;
+
+    /**
+     * @brief Process all events of the source and write them with the data writer
+     */
+    void run(DataWriter& data_writer);
+    /**
+     * @brief Process all events of the source, the processed events are passed to the consumer in the order of the source
+     *
+     * @param consumer called on the thread calling run, afterwards the event is given back to the source with recycle_event
+     */
+    void run(const std::function<void(ArrayEvent&)>& consumer);
+
+    int get_n_workers() const { return n_workers; }
+private:
+    void worker_loop();
+    void stop_workers();
+
+    EventSource& source;
+    int n_workers;
+    size_t max_events_in_flight;
+    std::unique_ptr<Calibrator> calibrator;
+    std::unique_ptr<ImageProcessor> image_processor;
+    std::unique_ptr<ShowerProcessor> shower_processor;
+    std::vector<std::thread> threads;
+
+    // Events waiting for a worker, with their position in the source
+    std::deque<std::pair<size_t, ArrayEvent>> input_queue;
+    // Processed events waiting to be written, ordered by their position in the source
+    std::map<size_t, ArrayEvent> output_events;
+    bool stop = false;
+    std::exception_ptr worker_error;
+    std::mutex queue_mutex;
+    std::condition_variable input_not_empty;
+    std::condition_variable output_ready;
+};
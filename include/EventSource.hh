@@ -19,6 +19,8 @@
 #include "Metaparam.hh"
 #include "SubarrayDescription.hh"
 #include "ArrayEvent.hh"
+#include "ArrayEventPool.hh"
+#include <memory>
 #include <optional>
 #include "Statistics.hh"
 #include "SimulatedShowerArray.hh"
@@ -59,8 +61,13 @@ public:
                 ++position_;
                 source_->current_event_index = position_;
                 if(source_ && !source_->is_finished() && (source_->max_events == -1 || position_ < source_->max_events)){
+                    // An event moved out by the caller is left without data levels and is not kept by the pool
+                    source_->recycle_event(std::move(*source_->current_event));
                     *source_->current_event = source_->get_event();
                 }
+                if(source_ && source_->is_iteration_done()){
+                    source_->on_iteration_end();
+                }
                 return *this;
             }
         private:
@@ -112,6 +119,15 @@ public:
      * @brief load_simulated_showers is used to load the simulated showers into the shower_array
      */
     std::optional<SimulatedShowerArray> shower_array;   
+    /**
+     * @brief Processed events given back with recycle_event, the next events are read into their storage.
+     *        Sources reading for another source can share its pool.
+     */
+    std::shared_ptr<ArrayEventPool> event_pool = std::make_shared<ArrayEventPool>();
+    /**
+     * @brief Give an event back once it is written, so its buffers are reused for the next events
+     */
+    void recycle_event(ArrayEvent&& event) { event_pool->recycle(std::move(event)); }
     /**
      * @brief The current read event
      */
@@ -185,7 +201,26 @@ protected:
      */
     virtual void init_subarray() = 0;
 
+    /**
+     * @brief Called at initialization if load_simulated_showers is set.
+     *        Sources that collect the showers while reading the events can defer the loading.
+     * 
+     */
+    virtual void init_simulated_showers() { load_all_simulated_showers(); }
+    /**
+     * @brief Called by the iterator once the last event is read or max_events is reached
+     * 
+     */
+    virtual void on_iteration_end() {}
+    bool is_iteration_done() {
+        return is_finished() || (max_events != -1 && current_event_index >= max_events);
+    }
+
     bool is_subarray_selected(int tel_id) const;
+    /**
+     * @brief An empty event to read into, reusing the storage of a recycled event when there is one
+     */
+    ArrayEvent acquire_event() { return event_pool->acquire(); }
     virtual void open_file() = 0;
 
     
@@ -197,7 +232,7 @@ protected:
         init_atmosphere_model();
         init_subarray();
         if(load_simulated_showers){
-            load_all_simulated_showers();
+            init_simulated_showers();
         }
     } 
     catch(const std::exception& e) {
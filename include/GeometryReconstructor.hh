@@ -17,27 +17,39 @@
 #include "SubarrayDescription.hh"
 #include "CoordFrames.hh"
 #include "ReconstructedGeometry.hh"
+
+/**
+ * @brief The telescopes of one event selected for the geometry reconstruction, built for every call
+ *        so that one reconstructor can be used by several threads at once
+ */
+struct GeometryReconstructionInput
+{
+    std::vector<int> telescopes;
+    std::unordered_map<int, HillasParameter> hillas_dicts;
+    std::unordered_map<int, SphericalRepresentation> telescope_pointing;
+    SphericalRepresentation array_pointing_direction;
+    std::unique_ptr<TelescopeFrame> nominal_frame;
+};
+
 class GeometryReconstructor: private Configurable
 {
     public:
         DECLARE_CONFIGURABLE_DEFINITIONS(const SubarrayDescription& , subarray, GeometryReconstructor);
         virtual ~GeometryReconstructor() = default;
-        virtual void operator()(ArrayEvent& event);
+        virtual void operator()(ArrayEvent& event) const;
         virtual std::string name() const {return "BaseGeometryReconstructor";}
         json default_config() const override {return get_default_config();}
         static json get_default_config();
         void configure(const json& config) override;
-        std::vector<int> telescopes;
+        /**
+         * @brief Select the telescopes passing the image query, the dl2 event is created if it does not exist
+         */
+        GeometryReconstructionInput select_telescopes(ArrayEvent& event) const;
+        static double compute_angle_separation(double az1, double alt1, double az2, double alt2);
+        static std::pair<double, double> convert_to_sky(const TelescopeFrame& nominal_frame, double fov_x, double fov_y);
+        static std::pair<double, double> convert_to_fov(const TelescopeFrame& nominal_frame, double alt, double az);
     protected:
         bool use_fake_hillas = false; 
-        static double compute_angle_separation(double az1, double alt1, double az2, double alt2);
-        std::pair<double, double> convert_to_sky(double fov_x, double fov_y);
-        std::pair<double, double> convert_to_fov(double alt, double az);
         std::unique_ptr<ImageQuery> query_;
-        ReconstructedGeometry geometry;
-        SphericalRepresentation array_pointing_direction;
-        std::unique_ptr<TelescopeFrame> nominal_frame;
-        std::unordered_map<int, SphericalRepresentation> telescope_pointing;
         const SubarrayDescription& subarray;
-        std::unordered_map<int, HillasParameter> hillas_dicts;
-};
\ No newline at end of file
+};
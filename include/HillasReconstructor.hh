@@ -24,21 +24,22 @@
         HillasReconstructor(const SubarrayDescription& subarray, const json& config): GeometryReconstructor(subarray, config) {};
         HillasReconstructor(const SubarrayDescription& subarray, const std::string& config_str): GeometryReconstructor(subarray, config_str) {};
         virtual ~HillasReconstructor() = default;
-        bool reconstruct(const std::unordered_map<int, HillasParameter>& hillas_dicts);
+        /**
+         * @brief Reconstruct the shower geometry from the selected telescopes, the result is not valid for less than two telescopes
+         */
+        ReconstructedGeometry reconstruct(const GeometryReconstructionInput& input) const;
         virtual std::string name() const override{ return "HillasReconstructor"; };
-        virtual void operator()(ArrayEvent& event) override;
+        virtual void operator()(ArrayEvent& event) const override;
 
-        std::unordered_map<int, double> impact_parameters;
     private:
-        std::unordered_map<int, HillasParameter> nominal_hillas_dicts;
-        void fill_nominal_hillas_dicts(const std::unordered_map<int, HillasParameter>& hillas_dicts);
-        std::tuple<double, double, double, double> reconstruction_nominal_intersection();
-        std::tuple<double, double, double, double> reconstruction_tilted_intersection();
-        double reconstruction_hmax(double fov_x, double fov_y,double altitude);
-        std::vector<std::pair<int, int>> get_tel_pairs();
-        std::unordered_map<int, Point2D> get_tiled_tel_position();
-        std::unique_ptr<TiltedGroundFrame> tilted_frame;
-        std::pair<double, double> project_to_ground(Eigen::Vector3d intersection_position, const SkyDirection<AltAzFrame>& direction);
+        using HillasDicts = std::unordered_map<int, HillasParameter>;
+        static HillasDicts get_nominal_hillas_dicts(const GeometryReconstructionInput& input);
+        static std::tuple<double, double, double, double> reconstruction_nominal_intersection(const std::vector<int>& telescopes, const HillasDicts& nominal_hillas_dicts);
+        std::tuple<double, double, double, double> reconstruction_tilted_intersection(const std::vector<int>& telescopes, const HillasDicts& nominal_hillas_dicts, const TiltedGroundFrame& tilted_frame) const;
+        static double reconstruction_hmax(const GeometryReconstructionInput& input, const HillasDicts& nominal_hillas_dicts, const std::unordered_map<int, double>& impact_parameters, double fov_x, double fov_y, double altitude);
+        static std::vector<std::pair<int, int>> get_tel_pairs(const std::vector<int>& telescopes);
+        std::unordered_map<int, Point2D> get_tiled_tel_position(const std::vector<int>& telescopes, const TiltedGroundFrame& tilted_frame) const;
+        static std::pair<double, double> project_to_ground(Eigen::Vector3d intersection_position, const SkyDirection<AltAzFrame>& direction);
         static double knonrad_weight(double reduced_amplitude, double delta_1, double delta_2, double sin_part);
     
     
@@ -11,6 +11,8 @@
 #pragma once
 #include "Configurable.hh"
 #include "CameraGeometry.hh"
+#include "PixelMask.hh"
+#include "SparseImage.hh"
 #include "Eigen/Dense"
 using json = nlohmann::json;
 class ImageCleaner
@@ -18,7 +20,37 @@ class ImageCleaner
 public:
     ImageCleaner() = default;
     virtual ~ImageCleaner() = default;
-    virtual Eigen::Vector<bool, -1> operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const = 0;
+    virtual PixelMask operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const = 0;
+    /**
+     * @brief Same as operator(), writing into mask. Cleaners that can reuse the storage of mask override it
+     */
+    virtual void operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, PixelMask& mask) const
+    {
+        mask = (*this)(camera_geometry, image);
+    }
+    /**
+     * @brief Clean the image and keep only the surviving pixels, with their charges and peak times
+     */
+    SparseImage clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, const Eigen::VectorXd& peak_time = Eigen::VectorXd()) const
+    {
+        return SparseImage::from_mask((*this)(camera_geometry, image), image, peak_time);
+    }
+    /**
+     * @brief Same as clean, the cleaning mask is returned in mask so it does not have to be rebuilt from the sparse image
+     */
+    SparseImage clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, const Eigen::VectorXd& peak_time, PixelMask& mask) const
+    {
+        (*this)(camera_geometry, image, mask);
+        return SparseImage::from_mask(mask, image, peak_time);
+    }
+    /**
+     * @brief Same as clean, writing into mask and cleaned_image so the buffers of a reused telescope are not reallocated
+     */
+    void clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, const Eigen::VectorXd& peak_time, PixelMask& mask, SparseImage& cleaned_image) const
+    {
+        (*this)(camera_geometry, image, mask);
+        cleaned_image.assign(mask, image, peak_time);
+    }
 };
 class TailcutsCleaner: public ImageCleaner, public Configurable
 {
@@ -27,15 +59,23 @@ public:
     static json get_default_config() ;
     json default_config() const override;
     void configure(const json& config) override;
-    Eigen::Vector<bool, -1> operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const override;
-    static Eigen::Vector<bool, -1> tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels = false, int min_number_picture_neighbors = 0);
+    PixelMask operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const override;
+    void operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, PixelMask& mask) const override;
+    static PixelMask tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels = false, int min_number_picture_neighbors = 0, int picture_neighbor_passes = 1);
+    /**
+     * @brief Same as tailcuts_clean, writing into mask
+     */
+    static void tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, PixelMask& mask, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels = false, int min_number_picture_neighbors = 0, int picture_neighbor_passes = 1);
     double get_picture_thresh() const {return picture_thresh;}
     double get_boundary_thresh() const {return boundary_thresh;}
     bool get_keep_isolated_pixels() const {return keep_isolated_pixels;}
     int get_min_number_picture_neighbors() const {return min_number_picture_neighbors;}
+    int get_picture_neighbor_passes() const {return picture_neighbor_passes;}
 private:
     double picture_thresh;
     double boundary_thresh;
     bool keep_isolated_pixels;
     int min_number_picture_neighbors;
+    // Times the min_number_picture_neighbors filter is applied, each pass to the pixels kept by the previous one
+    int picture_neighbor_passes;
 };
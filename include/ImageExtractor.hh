@@ -12,9 +12,13 @@
 #include "Eigen/Dense"
 #include <cstddef>
 #include <utility>
+#include <vector>
 #include "SubarrayDescription.hh"
 #include "optional"
 #include "Configurable.hh"
+#include "R0Event.hh"
+#include "R1Event.hh"
+#include "TelMonitor.hh"
 /**
  * @brief Extract the waveform around the peak
  * 
@@ -25,7 +29,44 @@
  * @param sampling_rate_ghz  double
  * @return std::pair<Eigen::VectorXd, Eigen::VectorXd> 0: charge, 1: time
  */
-std::pair<Eigen::VectorXd, Eigen::VectorXd>  extract_around_peak(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform, const Eigen::VectorXi& peak_index, const Eigen::VectorXi& window_width, const Eigen::VectorXi& window_shift, double sampling_rate_ghz);
+std::pair<Eigen::VectorXd, Eigen::VectorXd>  extract_around_peak(const R1WaveformMatrix& waveform, const Eigen::VectorXi& peak_index, const Eigen::VectorXi& window_width, const Eigen::VectorXi& window_shift, double sampling_rate_ghz);
+/**
+ * @brief Same as get_peak_index followed by extract_around_peak, in one pass over the samples of each pixel.
+ *        The pixels are taken in tiles: the peak search and the prefix sums of the charge and of the index weighted
+ *        positive charge run across the pixels of a tile for every sample, the window sums are then differences
+ *        of the prefix sums at the clamped window edges. Windows narrower than a quarter of the readout are summed
+ *        directly from the samples instead of the prefix sums. The sums are accumulated in double.
+ *
+ * @param waveform  (n_pixels, n_samples)
+ * @param window_width
+ * @param window_shift
+ * @param sampling_rate_ghz
+ * @return std::pair<Eigen::VectorXd, Eigen::VectorXd> 0: charge, 1: time
+ */
+std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_around_local_peak(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz);
+/**
+ * @brief Same as extract_around_local_peak, writing into charge and peak_time, which are only reallocated if their size changes
+ */
+void extract_around_local_peak(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time);
+/**
+ * @brief Same as get_peak_index and extract_around_peak on the calibrated waveform, but computed on the R0 samples
+ *        of the selected gain. The peak search and the window sums are done on the integer ADC counts, the pedestal
+ *        and dc_to_pe are only applied to the sums of each pixel: sum((adc - ped) * g) = (sum(adc) - n * ped) * g.
+ *        Assumes dc_to_pe > 0, so the peak of the ADC counts is the peak of the calibrated waveform.
+ *
+ * @param waveform  2-channel R0 waveform (n_pixels, n_samples)
+ * @param gain_selection  (n_pixels)
+ * @param monitor  pedestal and dc_to_pe of the telescope
+ * @param window_width
+ * @param window_shift
+ * @param sampling_rate_ghz
+ * @return std::pair<Eigen::VectorXd, Eigen::VectorXd> 0: charge, 1: time
+ */
+std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_around_peak_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int window_width, int window_shift, double sampling_rate_ghz);
+/**
+ * @brief Same as extract_around_peak_r0, writing into charge and peak_time, which are only reallocated if their size changes
+ */
+void extract_around_peak_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time);
 
 
 class ImageExtractor
@@ -34,14 +75,26 @@ class ImageExtractor
        ImageExtractor(const SubarrayDescription& subarray);
        virtual ~ImageExtractor() = default;
 
-       virtual std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform, const Eigen::VectorXi& gain_selection, int tel_id) = 0;
-       Eigen::VectorXi get_peak_index(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform);
-       Eigen::VectorXd compute_integration_correction(const Eigen::MatrixXd& reference_pulse, double reference_pulse_sample_width_ns, double sample_width_ns, int window_width, int window_shift);
-       Eigen::VectorXd get_cached_integration_correction() const { return *cached_correction;}
+       virtual std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id) const = 0;
+       /**
+        * @brief Extract the image from the R0 waveform, used when the event has no R1.
+        *        By default the R1 waveform is computed first.
+        */
+       virtual std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id) const;
+       /**
+        * @brief Same as operator(), writing into charge and peak_time so the buffers of a reused telescope are kept.
+        *        By default the result of operator() is moved into them.
+        */
+       virtual void extract(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const;
+       /**
+        * @brief Same as extract_r0, writing into charge and peak_time
+        */
+       virtual void extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const;
+       static Eigen::VectorXi get_peak_index(const R1WaveformMatrix& waveform);
+       static Eigen::VectorXd compute_integration_correction(const Eigen::MatrixXd& reference_pulse, double reference_pulse_sample_width_ns, double sample_width_ns, int window_width, int window_shift);
     protected:
         const SubarrayDescription& subarray;
         std::unordered_map<int, double> sampling_rate_ghz;
-        std::optional<Eigen::VectorXd> cached_correction;
 
 
 };
@@ -52,10 +105,10 @@ class FullWaveFormExtractor: public ImageExtractor
     FullWaveFormExtractor(const SubarrayDescription& subarray);
     virtual ~FullWaveFormExtractor() = default;
 
-    std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform, const Eigen::VectorXi& gain_selection, int tel_id) override
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id) const override
     {
         int window_width = waveform.cols();
-        double sampling_rate_ghz = this->sampling_rate_ghz[tel_id];
+        double sampling_rate_ghz = this->sampling_rate_ghz.at(tel_id);
         return extract_around_peak(waveform, Eigen::VectorXi::Zero(waveform.rows()), Eigen::VectorXi::Constant(waveform.rows(), window_width), Eigen::VectorXi::Zero(waveform.rows()), sampling_rate_ghz);
     }
 };
@@ -71,21 +124,48 @@ class LocalPeakExtractor: public ImageExtractor, public Configurable
     void configure(const json& config) override;
     virtual ~LocalPeakExtractor() = default;
 
-    std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform, const Eigen::VectorXi& gain_selection, int tel_id) override
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> operator()(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id) const override
+    {
+        std::pair<Eigen::VectorXd, Eigen::VectorXd> extracted;
+        extract(waveform, gain_selection, tel_id, extracted.first, extracted.second);
+        return extracted;
+    }
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id) const override
+    {
+        std::pair<Eigen::VectorXd, Eigen::VectorXd> extracted;
+        extract_r0(waveform, gain_selection, monitor, tel_id, extracted.first, extracted.second);
+        return extracted;
+    }
+    void extract(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const override
+    {
+        double sampling_rate_ghz = this->sampling_rate_ghz.at(tel_id);
+        extract_around_local_peak(waveform, this->window_width, this->window_shift, sampling_rate_ghz, charge, peak_time);
+        if (this->apply_correction)
+        {
+            this->correction(charge, gain_selection, tel_id);
+        }
+    }
+    void extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const override
     {
-        auto peak_index = this->get_peak_index(waveform);
-        double sampling_rate_ghz = this->sampling_rate_ghz[tel_id];
-        auto [charge, peak_time] = extract_around_peak(waveform, peak_index, Eigen::VectorXi::Constant(waveform.rows(), this->window_width), Eigen::VectorXi::Constant(waveform.rows(), this->window_shift), sampling_rate_ghz);
-        const auto& readout = subarray.tels.at(tel_id).camera_description.camera_readout;
+        double sampling_rate_ghz = this->sampling_rate_ghz.at(tel_id);
+        extract_around_peak_r0(waveform, gain_selection, monitor, this->window_width, this->window_shift, sampling_rate_ghz, charge, peak_time);
         if (this->apply_correction)
         {
-            this->correction(charge, gain_selection, readout, sampling_rate_ghz);
+            this->correction(charge, gain_selection, tel_id);
         }
-        return std::make_pair(charge, peak_time);
     }
+    /**
+     * @brief Integration correction of each gain channel of the telescope, computed in configure().
+     *        Telescopes with the same camera readout share the same correction.
+     */
+    const Eigen::VectorXd& get_integration_correction(int tel_id) const;
 
     private:
-    void correction(Eigen::VectorXd& charge, const Eigen::VectorXi& gain_selection, const CameraReadout& readout, double sampling_rate_ghz);
+    void correction(Eigen::VectorXd& charge, const Eigen::VectorXi& gain_selection, int tel_id) const;
+    /** @brief Distinct integration corrections, one for each camera readout of the subarray */
+    std::vector<Eigen::VectorXd> integration_corrections;
+    /** @brief Index in integration_corrections of each telescope, by tel_id, -1 for the telescopes not in the subarray */
+    std::vector<int> correction_index;
     int window_width;
     int window_shift;
     bool apply_correction;
@@ -18,30 +18,85 @@
 #include "ImageCleaner.hh"
 #include "ArrayEvent.hh"
 #include "ImageParameters.hh"
+#include "RandomGenerator.hh"
+/**
+ * @brief Cuts on the DL0 image, computed in one pass, for images that cannot pass the intensity cut after the cleaning.
+ *        The cuts must not be tighter than those of the cleaning, then no image passing the later cut is rejected.
+ *        ImageProcessor derives them from the configured cleaning and min_intensity.
+ */
+struct ImagePreScreen
+{
+    bool enabled = true;
+    double picture_thresh = 10;
+    double boundary_thresh = 5;
+    int min_picture_pixels = 3;
+    double min_max_charge = 10;
+    // Minimum positive charge summed over the pixels above the boundary threshold
+    double min_total_charge = 50;
+    ImageRejection operator()(const Eigen::VectorXd& image) const;
+    /**
+     * @brief Tightest cuts that reject no image the tailcuts cleaning and the intensity cut would keep:
+     *        a kept pixel is above the lower of the two thresholds and the image has a picture pixel,
+     *        which needs min_number_picture_neighbors picture neighbors unless isolated pixels are kept.
+     *        Disabled if min_intensity <= 0, as an empty cleaned image then passes the intensity cut.
+     */
+    static ImagePreScreen from_cleaning(const TailcutsCleaner& cleaner, double min_intensity);
+    /**
+     * @brief Whether no cut is tighter than the same cut of other
+     */
+    bool looser_than(const ImagePreScreen& other) const;
+};
 class ImageProcessor: public Configurable
 {
 public:
     DECLARE_CONFIGURABLE_DEFINITIONS(const SubarrayDescription&, subarray, ImageProcessor);
     ~ImageProcessor() = default;
-    static Eigen::Vector<bool, -1> tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels = false, int min_number_picture_neighbors = 0);
+    static PixelMask tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels = false, int min_number_picture_neighbors = 0, int picture_neighbor_passes = 1);
     void configure(const json& config) override;
     static json get_default_config();
     json default_config() const override {return get_default_config();}
-    void operator()(ArrayEvent& event);
+    void operator()(ArrayEvent& event) const;
     static HillasParameter hillas_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image);
-    static LeakageParameter leakage_parameter(CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image);
+    /**
+     * @brief Hillas, concentration and intensity parameters from two passes over the pixels kept by the cleaning,
+     *        the leakage and morphology parameters are left unset.
+     *        psi is in (-pi/2, pi/2], the sign of the skewness follows it
+     */
+    static ImageParameters moment_parameters(const CameraGeometry& camera_geometry, const SparseImage& image);
+    static ImageParameters moment_parameters(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, const PixelMask& image_mask);
+    static LeakageParameter leakage_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image);
+    static LeakageParameter leakage_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image, const PixelMask& image_mask);
+    /**
+     * @brief Leakage of the pixels kept by the cleaning, the border masks are only tested at these pixels
+     */
+    static LeakageParameter leakage_parameter(const CameraGeometry& camera_geometry, const SparseImage& image);
     static ConcentrationParameter concentration_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image, const HillasParameter& hillas_parameter);
-    static MorphologyParameter morphology_parameter(const CameraGeometry& camera_geometry, const Eigen::Vector<bool, -1>& image_mask);
+    static MorphologyParameter morphology_parameter(const CameraGeometry& camera_geometry, const PixelMask& image_mask);
+    static MorphologyParameter morphology_parameter(const CameraGeometry& camera_geometry, const SparseImage& image);
     static IntensityParameter intensity_parameter(const Eigen::VectorXd& masked_image);
-    static void dilate_image(const CameraGeometry& camera_geometry, Eigen::Vector<bool, -1>& image_mask);
+    static void dilate_image(const CameraGeometry& camera_geometry, PixelMask& image_mask);
 private:
     const SubarrayDescription& subarray;
     std::string image_cleaner_type;
     std::unique_ptr<ImageCleaner> image_cleaner;
+    ImagePreScreen pre_screen;
+    // Minimum intensity of the cleaned image
+    double min_intensity = 50;
     double poisson_noise = 0.0;
-    void handle_simulation_level(ArrayEvent& event);
-    bool fake_trigger(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double threshold, int min_pixels_above_threshold = 4);
-    Eigen::VectorXd adding_poisson_noise(Eigen::VectorXi true_image, double poisson_noise);
+    PoissonSampler poisson_sampler;
+    // Key of the noise generator with the run id, the noise of a telescope only depends on the seed, run, event and telescope
+    uint32_t random_seed = 0;
+    // Process the telescopes of an event on the shared thread pool if there are at least min_parallel_telescopes
+    bool parallel_telescopes = false;
+    size_t min_parallel_telescopes = 4;
+    /**
+     * @brief Clean the image and compute the image parameters of one telescope into dl1_camera, whose buffers are reused.
+     *        Returns the reason if the image is too faint, dl1_camera is then only partly filled
+     */
+    ImageRejection process_telescope(int tel_id, const DL0Camera& dl0_camera, DL1Camera& dl1_camera) const;
+    void handle_simulation_level(ArrayEvent& event) const;
+    bool fake_trigger(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double threshold, int min_pixels_above_threshold = 4) const;
+    Eigen::VectorXd adding_poisson_noise(const Eigen::VectorXi& true_image, int run_id, int event_id, int tel_id) const;
 
 };
 
@@ -14,6 +14,7 @@
  #include "Configurable.hh"
  #include "ImageParameters.hh"
  #include "ExprQuery.hh"
+ #include <memory>
  class ImageQuery : public ExprQuery, public Configurable{
     public:
     /**
@@ -29,32 +30,46 @@
         {
             initialize();
         }
-        init_variables();
+        expression = std::make_shared<const std::string>(get_expr());
     } 
     /**
-     * @brief Evaluate the image query on the given image parameters
+     * @brief Evaluate the image query on the given image parameters.
+     *        Each thread evaluates with its own parser and variables, so one query can be shared between threads
      * 
      * @param image_parameter 
      * @return true 
      * @return false 
      */
-    bool operator() (const ImageParameters& image_parameter);
+    bool operator() (const ImageParameters& image_parameter) const;
 
 
     protected:
-        void init_variables();
         void configure(const json& config) override;
         virtual json default_config() const override
         {
             return json();
         }
     private:
-        void init_hillas_parameter();
-        void init_leakage_parameter();
-        void init_morphology_parameter();
-        HillasParameter hillas_parameter_;
-        LeakageParameter leakage_parameter_;
-        double morphology_n_pixels_;
+        /**
+         * @brief A parser reading its own copy of the variables
+         */
+        struct Evaluator
+        {
+            explicit Evaluator(const std::string& expr);
+            // The parser keeps the addresses of the variables
+            Evaluator(const Evaluator&) = delete;
+            Evaluator& operator=(const Evaluator&) = delete;
+            mu::Parser parser;
+            HillasParameter hillas_parameter;
+            LeakageParameter leakage_parameter;
+            double morphology_n_pixels = 0;
+        };
+        /**
+         * @brief The evaluator of the calling thread for this query, created on the first evaluation in the thread
+         */
+        Evaluator& thread_evaluator() const;
+        // The evaluators of the threads refer to the query through it, and drop their evaluator once it is gone
+        std::shared_ptr<const std::string> expression;
  };
     
     
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * @file MapNodePool.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Nodes of a map kept from event to event
+ * @version 0.1
+ * @date 2025-04-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Nodes of a std::map or std::unordered_map kept after its entries are removed, so the entries of the next
+ *        event are added without allocating. A copy starts empty, the nodes stay with the map they came from.
+ */
+template<typename Map>
+class MapNodePool
+{
+    public:
+        MapNodePool() = default;
+        MapNodePool(const MapNodePool&) {}
+        MapNodePool& operator=(const MapNodePool&) { return *this; }
+        MapNodePool(MapNodePool&&) noexcept = default;
+        MapNodePool& operator=(MapNodePool&&) noexcept = default;
+        /**
+         * @brief Move all entries of map into the pool, map is left empty
+         */
+        void release_all(Map& map)
+        {
+            while(!map.empty())
+            {
+                nodes.push_back(map.extract(map.begin()));
+            }
+        }
+        /**
+         * @brief Value of key in map. A missing key is added with a node of the pool if there is one, the value then
+         *        still holds the data of the entry it was released from, otherwise it is value initialized
+         */
+        typename Map::mapped_type& acquire(Map& map, const typename Map::key_type& key)
+        {
+            auto it = map.find(key);
+            if(it != map.end())
+            {
+                return it->second;
+            }
+            if(nodes.empty())
+            {
+                return map[key];
+            }
+            // A node released with the same key is taken first, a string key then keeps its storage
+            auto same_key = std::find_if(nodes.begin(), nodes.end(), [&key](const auto& node) { return node.key() == key; });
+            if(same_key != nodes.end())
+            {
+                std::swap(*same_key, nodes.back());
+            }
+            auto node = std::move(nodes.back());
+            nodes.pop_back();
+            node.key() = key;
+            return map.insert(std::move(node)).position->second;
+        }
+        size_t size() const { return nodes.size(); }
+    private:
+        std::vector<typename Map::node_type> nodes;
+};
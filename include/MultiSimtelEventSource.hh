@@ -0,0 +1,105 @@
+/**
+ * @file MultiSimtelEventSource.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Read a list of simtel files as one event stream
+ * @version 0.1
+ * @date 2025-03-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include "EventSource.hh"
+#include "SimtelEventSource.hh"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief MultiSimtelEventSource reads several simtel files on reader threads, each file with its own
+ *        SimtelEventSource, and merges their events into one stream.
+ *        All files must have compatible subarray descriptions, the simulation configuration, atmosphere
+ *        model and metaparam are taken from the first file.
+ *        With ordered = true the events come file by file in the order of the file list,
+ *        otherwise in the order they are read.
+ *        Once all files are read, statistics holds the sum of the statistics of the files.
+ */
+class MultiSimtelEventSource: public EventSource
+{
+public:
+    MultiSimtelEventSource(const std::vector<std::string>& filenames, int n_readers = 4, bool ordered = true, int64_t max_events = -1, std::vector<int> subarray = {}, bool load_simulated_showers = false, int gain_selector_threshold = 4000, SimtelReadOptions read_options = {});
+    virtual ~MultiSimtelEventSource();
+
+    /**
+     * @brief After the iteration, the showers collected by the readers are merged in file order.
+     *        Before that, the showers of each file are read separately.
+     */
+    virtual void load_all_simulated_showers() override;
+    const SimulatedShowerArray& get_shower_array() {
+        if(!shower_array.has_value())
+        {
+            load_all_simulated_showers();
+        }
+        return *shower_array;
+    }
+    const std::string print() const;
+    /**
+     * @brief Files matching the glob pattern in sorted order, e.g. MultiSimtelEventSource(expand_glob("run_*.simtel.zst"))
+     */
+    static std::vector<std::string> expand_glob(const std::string& pattern);
+
+    std::vector<std::string> filenames;
+private:
+    virtual void open_file() override;
+    // Everything is read from the first file in open_file
+    virtual void init_simulation_config() override {}
+    virtual void init_atmosphere_model() override {}
+    virtual void init_metaparam() override {}
+    virtual void init_subarray() override {}
+    // The readers collect the showers while reading the events
+    virtual void init_simulated_showers() override {}
+    virtual void on_iteration_end() override;
+    virtual bool is_finished() override { return finished; }
+    ArrayEvent get_event() override;
+
+    void start_readers();
+    void stop_readers();
+    void reader_loop();
+    void read_file(size_t file_index);
+    /**
+     * @brief Wait until the queue has space, returns false if the readers are stopped
+     */
+    bool push_event(size_t file_index, ArrayEvent&& event);
+    size_t queue_index(size_t file_index) const { return ordered ? file_index : 0; }
+
+    struct EventQueue {
+        std::deque<ArrayEvent> events;
+        // Number of files that finished writing to this queue
+        size_t done_files = 0;
+        size_t expected_files = 1;
+    };
+    int n_readers;
+    bool ordered;
+    int gain_selector_threshold;
+    SimtelReadOptions read_options;
+    static constexpr size_t queue_capacity = 16;
+
+    std::vector<EventQueue> queues;
+    size_t current_queue = 0;
+    bool finished = false;
+    size_t completed_files = 0;
+    std::vector<std::optional<SimulatedShowerArray>> file_shower_arrays;
+    std::vector<std::optional<Statistics>> file_statistics;
+
+    std::vector<std::thread> readers;
+    // Guarded by queue_mutex, like the other reader state below
+    size_t next_file = 0;
+    bool stop = false;
+    std::exception_ptr reader_error;
+    std::mutex queue_mutex;
+    std::condition_variable queue_not_empty;
+    std::condition_variable queue_not_full;
+};
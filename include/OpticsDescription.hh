@@ -26,5 +26,12 @@ public:
     double equivalent_focal_length;
     /** @brief Effective focal length of the telescope [m] */
     double effective_focal_length;
+    /**
+     * @brief Focal length for the fov coordinates of the camera, the equivalent one if the effective one is not available [m]
+     */
+    double get_focal_length() const
+    {
+        return effective_focal_length != 0 ? effective_focal_length : equivalent_focal_length;
+    }
     const string print() const;
 };
\ No newline at end of file
@@ -0,0 +1,199 @@
+/**
+ * @file PixelMask.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Bit-packed pixel mask used from the image cleaning to the image parameters
+ * @version 0.1
+ * @date 2025-04-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include "Eigen/Dense"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief One bit per pixel in 64 bit words, the bits past the last pixel are always zero.
+ *        Counting uses popcount and the combination of two masks works word by word,
+ *        so a 3000 pixel mask takes 47 words.
+ */
+class PixelMask
+{
+public:
+    PixelMask() = default;
+    /**
+     * @brief Mask of n_pixels pixels, all unset
+     */
+    explicit PixelMask(int n_pixels): n_pixels(n_pixels), bits((n_pixels + 63) / 64, 0) {}
+    static PixelMask from_bools(const bool* values, int n_pixels)
+    {
+        PixelMask mask(n_pixels);
+        for(int i = 0; i < n_pixels; i++)
+        {
+            mask.bits[i / 64] |= uint64_t(values[i]) << (i % 64);
+        }
+        return mask;
+    }
+    static PixelMask from_bools(const Eigen::Vector<bool, -1>& values)
+    {
+        return from_bools(values.data(), values.size());
+    }
+    /**
+     * @brief Mask from packed words, e.g. read back from a file
+     */
+    template<typename Word>
+    static PixelMask from_words(const Word* words, size_t n_words, int n_pixels)
+    {
+        static_assert(std::is_integral_v<Word> && sizeof(Word) == sizeof(uint64_t), "PixelMask words are 64 bit");
+        PixelMask mask(n_pixels);
+        if(n_words != mask.bits.size())
+        {
+            throw std::runtime_error("PixelMask of " + std::to_string(n_pixels) + " pixels needs " + std::to_string(mask.bits.size()) + " words, got " + std::to_string(n_words));
+        }
+        std::copy(words, words + n_words, mask.bits.begin());
+        mask.clear_tail();
+        return mask;
+    }
+    Eigen::Vector<bool, -1> to_bools() const
+    {
+        Eigen::Vector<bool, -1> values = Eigen::Vector<bool, -1>::Zero(n_pixels);
+        for_each([&values](int i) { values[i] = true; });
+        return values;
+    }
+
+    int size() const { return n_pixels; }
+    bool test(int i) const { return bits[i / 64] >> (i % 64) & 1; }
+    bool operator[](int i) const { return test(i); }
+    bool operator()(int i) const { return test(i); }
+    void set(int i) { bits[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(int i) { bits[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    /**
+     * @brief Unset all pixels, the size is kept
+     */
+    void clear() { std::fill(bits.begin(), bits.end(), 0); }
+    /**
+     * @brief Resize to n_pixels pixels, all unset, the storage is reused if it is large enough
+     */
+    void assign(int n_pixels)
+    {
+        this->n_pixels = n_pixels;
+        bits.assign((n_pixels + 63) / 64, 0);
+    }
+
+    int count() const
+    {
+        int n = 0;
+        for(auto word: bits)
+        {
+            n += std::popcount(word);
+        }
+        return n;
+    }
+    bool any() const
+    {
+        for(auto word: bits)
+        {
+            if(word)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    /**
+     * @brief Number of pixels set in both masks, without building the intersection
+     */
+    int count_and(const PixelMask& other) const
+    {
+        check_size(other);
+        int n = 0;
+        for(size_t i = 0; i < bits.size(); i++)
+        {
+            n += std::popcount(bits[i] & other.bits[i]);
+        }
+        return n;
+    }
+    PixelMask& operator&=(const PixelMask& other)
+    {
+        check_size(other);
+        for(size_t i = 0; i < bits.size(); i++)
+        {
+            bits[i] &= other.bits[i];
+        }
+        return *this;
+    }
+    PixelMask& operator|=(const PixelMask& other)
+    {
+        check_size(other);
+        for(size_t i = 0; i < bits.size(); i++)
+        {
+            bits[i] |= other.bits[i];
+        }
+        return *this;
+    }
+    friend PixelMask operator&(PixelMask lhs, const PixelMask& rhs) { return lhs &= rhs; }
+    friend PixelMask operator|(PixelMask lhs, const PixelMask& rhs) { return lhs |= rhs; }
+    bool operator==(const PixelMask& other) const { return n_pixels == other.n_pixels && bits == other.bits; }
+
+    /**
+     * @brief Call f(pixel) for the set pixels in ascending order
+     */
+    template<typename Func>
+    void for_each(Func&& f) const
+    {
+        for(size_t iword = 0; iword < bits.size(); iword++)
+        {
+            uint64_t word = bits[iword];
+            while(word)
+            {
+                f(static_cast<int>(iword * 64 + std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    /**
+     * @brief Copy of values with the pixels outside the mask set to zero
+     */
+    template<typename Vector>
+    Vector masked(const Vector& values) const
+    {
+        Vector result = Vector::Zero(values.size());
+        for_each([&result, &values](int i) { result[i] = values[i]; });
+        return result;
+    }
+    /**
+     * @brief Sum of values over the set pixels
+     */
+    template<typename Vector>
+    double sum(const Vector& values) const
+    {
+        double total = 0;
+        for_each([&total, &values](int i) { total += values[i]; });
+        return total;
+    }
+    const std::vector<uint64_t>& words() const { return bits; }
+private:
+    void check_size(const PixelMask& other) const
+    {
+        if(other.n_pixels != n_pixels)
+        {
+            throw std::runtime_error("PixelMask sizes differ: " + std::to_string(n_pixels) + " and " + std::to_string(other.n_pixels));
+        }
+    }
+    void clear_tail()
+    {
+        if(n_pixels % 64)
+        {
+            bits.back() &= (uint64_t(1) << (n_pixels % 64)) - 1;
+        }
+    }
+    int n_pixels = 0;
+    std::vector<uint64_t> bits;
+};
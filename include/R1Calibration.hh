@@ -0,0 +1,33 @@
+/**
+ * @file R1Calibration.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief R0 to R1 calibration kernels
+ * @version 0.1
+ * @date 2025-03-28
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <array>
+#include "R0Event.hh"
+#include "R1Event.hh"
+#include "TelMonitor.hh"
+
+namespace R1Calibration {
+/**
+ * @brief Gain selection, pedestal subtraction and dc_to_pe conversion in one pass over the samples
+ *        r1(ipix, isample) = (r0[g](ipix, isample) - pedestal_per_sample(g, ipix)) * dc_to_pe(g, ipix) with g = gain_selection(ipix).
+ *        The inner loop over the samples of a pixel is contiguous in both matrices and is vectorized by the compiler.
+ *
+ * @param waveform  2-channel R0 waveform (n_pixels, n_samples)
+ * @param gain_selection selected gain channel of each pixel
+ * @param monitor pedestal and dc_to_pe of the telescope
+ * @param r1_waveform output, resized to (n_pixels, n_samples)
+ */
+void calibrate(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, R1WaveformMatrix& r1_waveform);
+/**
+ * @brief Scalar reference of calibrate computed in double precision, used to validate the fast kernel
+ */
+void calibrate_reference(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, R1WaveformMatrix& r1_waveform);
+}
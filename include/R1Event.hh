@@ -12,12 +12,14 @@
 #include <unordered_map>
 #include "BaseTelContainer.hh"
 #include <Eigen/Dense>
+// R1 waveforms are stored in single precision
+using R1WaveformMatrix = Eigen::Matrix<float, -1, -1, Eigen::RowMajor>;
 class R1Camera
 {
     public:
         int n_pixels;
         int n_samples;
-        Eigen::Matrix<double, -1, -1, Eigen::RowMajor> waveform;
+        R1WaveformMatrix waveform;
         Eigen::VectorXi gain_selection;
 };
 /**
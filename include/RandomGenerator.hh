@@ -0,0 +1,164 @@
+/**
+ * @file RandomGenerator.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Counter-based random numbers and the poisson sampler of the simulated fake images
+ * @version 0.1
+ * @date 2025-04-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include "Eigen/Dense"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Philox4x32-10 counter-based generator (Salmon et al., SC'11).
+ *        The output is a pure function of the key and the counter, so the numbers drawn for an event
+ *        do not depend on the thread processing it or on the events processed before.
+ */
+class Philox4x32
+{
+public:
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+    Philox4x32() = default;
+    explicit Philox4x32(Key key): key(key) {}
+
+    Counter operator()(Counter counter) const
+    {
+        Key round_key = key;
+        for(int round = 0; round < 10; round++)
+        {
+            if(round > 0)
+            {
+                round_key[0] += 0x9E3779B9u;
+                round_key[1] += 0xBB67AE85u;
+            }
+            const uint64_t product0 = uint64_t(0xD2511F53u) * counter[0];
+            const uint64_t product1 = uint64_t(0xCD9E8D57u) * counter[2];
+            counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ round_key[0], static_cast<uint32_t>(product1),
+                       static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ round_key[1], static_cast<uint32_t>(product0)};
+        }
+        return counter;
+    }
+    /**
+     * @brief Two uniform numbers in [0, 1) with 53 random bits from one block
+     */
+    std::array<double, 2> uniform_pair(Counter counter) const
+    {
+        const Counter block = (*this)(counter);
+        const uint64_t first = (uint64_t(block[0]) << 32) | block[1];
+        const uint64_t second = (uint64_t(block[2]) << 32) | block[3];
+        return {(first >> 11) * 0x1.0p-53, (second >> 11) * 0x1.0p-53};
+    }
+
+    Key key{0, 0};
+};
+
+/**
+ * @brief Poisson numbers of a fixed mean drawn from uniform numbers.
+ *        Means up to max_table_mean use the inverse of the cumulative distribution with a guide table,
+ *        larger means the normal approximation with continuity correction.
+ */
+class PoissonSampler
+{
+public:
+    static constexpr double max_table_mean = 100;
+    PoissonSampler() = default;
+    explicit PoissonSampler(double mean): mean(mean), sigma(std::sqrt(mean))
+    {
+        if(!(mean >= 0) || !std::isfinite(mean))
+        {
+            throw std::runtime_error("Poisson mean must be finite and non-negative, got " + std::to_string(mean));
+        }
+        if(mean > max_table_mean)
+        {
+            return;
+        }
+        // Cumulative distribution up to where the remaining tail is below the resolution of the uniform numbers
+        double probability = std::exp(-mean);
+        double cumulative = probability;
+        cdf.push_back(cumulative);
+        for(int k = 1; 1 - cumulative > 1e-16 && probability > 0; k++)
+        {
+            probability *= mean / k;
+            cumulative += probability;
+            cdf.push_back(cumulative);
+        }
+        cdf.back() = 1.0;
+        // guide[j] is the smallest k with cdf[k] > j / n_guide, the search starts there
+        const int n_guide = static_cast<int>(cdf.size());
+        guide.resize(n_guide);
+        int k = 0;
+        for(int j = 0; j < n_guide; j++)
+        {
+            while(cdf[k] <= static_cast<double>(j) / n_guide)
+            {
+                k++;
+            }
+            guide[j] = k;
+        }
+    }
+    /**
+     * @brief Poisson number of the uniform number u in [0, 1), table means only
+     */
+    int from_uniform(double u) const
+    {
+        int k = guide[static_cast<int>(u * guide.size())];
+        while(cdf[k] <= u)
+        {
+            k++;
+        }
+        return k;
+    }
+    /**
+     * @brief Poisson number of a standard normal number, the large mean approximation
+     */
+    int from_normal(double z) const
+    {
+        return std::max(0, static_cast<int>(std::floor(mean + sigma * z + 0.5)));
+    }
+    bool uses_table() const { return !cdf.empty(); }
+    /**
+     * @brief Fill samples with poisson numbers from the generator, one block per two samples.
+     *        Sample i is drawn from the block counter {i / 2, 0, stream[0], stream[1]}.
+     */
+    void fill(Eigen::Ref<Eigen::VectorXi> samples, const Philox4x32& generator, std::array<uint32_t, 2> stream) const
+    {
+        const int n_samples = static_cast<int>(samples.size());
+        for(int i = 0; i < n_samples; i += 2)
+        {
+            const auto [u0, u1] = generator.uniform_pair({static_cast<uint32_t>(i / 2), 0, stream[0], stream[1]});
+            int first, second;
+            if(uses_table())
+            {
+                first = from_uniform(u0);
+                second = from_uniform(u1);
+            }
+            else
+            {
+                // Box-Muller, 1 - u0 keeps the logarithm finite
+                const double radius = std::sqrt(-2 * std::log(1 - u0));
+                first = from_normal(radius * std::cos(2 * M_PI * u1));
+                second = from_normal(radius * std::sin(2 * M_PI * u1));
+            }
+            samples[i] = first;
+            if(i + 1 < n_samples)
+            {
+                samples[i + 1] = second;
+            }
+        }
+    }
+
+    double mean = 0;
+private:
+    double sigma = 0;
+    std::vector<double> cdf;
+    std::vector<int> guide;
+};
@@ -37,7 +37,7 @@
         ShowerProcessor(ShowerProcessor&&) = default;
         ShowerProcessor& operator=(const ShowerProcessor&) = delete;
         ShowerProcessor& operator=(ShowerProcessor&&) = delete;
-        void operator()(ArrayEvent& event);
+        void operator()(ArrayEvent& event) const;
         void configure(const json& config) override;
         json default_config() const override {return get_default_config();}
         static json get_default_config();
@@ -0,0 +1,99 @@
+/**
+ * @file SimtelEventIndex.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Byte offsets of the blocks of each event in a simtel file
+ * @version 0.1
+ * @date 2025-03-10
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Offsets of the blocks needed to read one event, an offset of -1 means no such block was found
+ *
+ */
+struct SimtelEventIndexEntry {
+    int event_id = -1;
+    int64_t shower_offset = -1;
+    int64_t mc_event_offset = -1;
+    int64_t event_offset = -1;
+    // Number of calibration blocks found before the SimtelEvent block
+    size_t n_calibration_blocks = 0;
+};
+
+/**
+ * @brief A monitor or calibration block, it applies to all following events of its telescope
+ *
+ */
+struct SimtelCalibrationBlock {
+    unsigned long type = 0;
+    long ident = 0;
+    int64_t offset = -1;
+};
+
+/**
+ * @brief Map the event number and the event_id to the block offsets of the event.
+ *        It can be saved next to the simtel file as a sidecar file `<filename>.idx`,
+ *        together with the size and modification time of the simtel file.
+ *
+ */
+class SimtelEventIndex {
+public:
+    SimtelEventIndex() = default;
+    SimtelEventIndex(uint64_t file_size, int64_t file_mtime): file_size(file_size), file_mtime(file_mtime) {}
+
+    void add_event(const SimtelEventIndexEntry& entry);
+    void add_calibration_block(const SimtelCalibrationBlock& block) { calibration_blocks.push_back(block); }
+    size_t n_calibration_blocks() const { return calibration_blocks.size(); }
+    /**
+     * @brief The last block of each type and telescope before the event, in file order.
+     *        Reading them gives the calibration a sequential read has at this event.
+     */
+    std::vector<SimtelCalibrationBlock> calibration_blocks_before(size_t event_number) const;
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    const SimtelEventIndexEntry& operator[](size_t event_number) const { return entries[event_number]; }
+    /**
+     * @brief Event number of the first event with the given event_id
+     */
+    std::optional<size_t> find_event_id(int event_id) const;
+
+    /**
+     * @brief Load the index from a sidecar file, returns std::nullopt if the file does not exist,
+     *        can not be parsed or was made for a file of another size or modification time
+     *
+     * @param index_path
+     * @param expected_file_size size of the simtel file the index belongs to
+     * @param expected_file_mtime modification time of the simtel file, see modification_time
+     */
+    static std::optional<SimtelEventIndex> load(const std::string& index_path, uint64_t expected_file_size, int64_t expected_file_mtime);
+    /**
+     * @brief Write the index to a sidecar file
+     *
+     * @return false if the file can not be written
+     */
+    bool save(const std::string& index_path) const;
+    static std::string sidecar_path(const std::string& simtel_filename) { return simtel_filename + ".idx"; }
+    /**
+     * @brief Modification time of the file in ticks of the filesystem clock
+     */
+    static int64_t modification_time(const std::string& filename);
+    /**
+     * @brief Set file_size and file_mtime from the simtel file the index belongs to
+     */
+    void set_file(const std::string& simtel_filename);
+
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+private:
+    std::vector<SimtelEventIndexEntry> entries;
+    std::vector<SimtelCalibrationBlock> calibration_blocks;
+    std::unordered_map<int, size_t> event_id_to_number;
+};
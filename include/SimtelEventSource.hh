@@ -16,7 +16,9 @@
 #include <unordered_map>
 #include <memory>
 #include "SimtelFileHandler.hh"
+#include "SimtelEventIndex.hh"
 #include "SimulatedShowerArray.hh"
+#include "TelMonitor.hh"
 /**
  * @brief SimtelEventSource can automatically read the simtel files and fill the DataLevel R0 and R1 and SimulatedEvent
  * 
@@ -25,23 +27,43 @@ class SimtelEventSource: public EventSource
 {
 public:
     SimtelEventSource() = default;
-    SimtelEventSource(const string& filename, int64_t max_events = -1 , std::vector<int> subarray = {}, bool load_simulated_showers = false, int gain_selector_threshold = 4000);
+    SimtelEventSource(const string& filename, int64_t max_events = -1 , std::vector<int> subarray = {}, bool load_simulated_showers = false, int gain_selector_threshold = 4000, SimtelReadOptions read_options = {});
 
     virtual ~SimtelEventSource() = default;
     const std::string print() const;
     /**
-     * @brief This can be called directory or set the load_simulated_showers to true in the constructor
-     *        After calling this function, the simulated showers will be loaded into the shower_array
+     * @brief After calling this function, the simulated showers will be loaded into the shower_array.
+     *        The showers are collected while the events are read, once the iteration is done only the
+     *        remaining shower blocks are read. Before that, the whole file is read again for the showers.
+     *        With load_simulated_showers set in the constructor, the shower_array is filled at the end of the iteration.
      * 
      */
     virtual void load_all_simulated_showers() override;
+    /**
+     * @brief Scan the block headers of the file and build the event index, which enables random access.
+     *        The index is also saved as a sidecar file next to the input if save_sidecar is true.
+     *        Only uncompressed files can be indexed. Without calling this function, the index is
+     *        built while the file is read to the end, or loaded from an existing sidecar file.
+     *        The index built while reading is only saved with SimtelReadOptions::save_event_index.
+     * 
+     * @param save_sidecar
+     */
+    void build_event_index(bool save_sidecar = true);
+    /**
+     * @brief Event number of the event with the given event_id, std::nullopt without an index
+     */
+    std::optional<int> get_event_number(int event_id) const;
     const SimulatedShowerArray& get_shower_array() {
         if(!shower_array.has_value())
         {
-            shower_array = SimulatedShowerArray(std::move(simtel_file_handler->shower_array));
+            load_all_simulated_showers();
         }
         return *shower_array;
     }
+    /**
+     * @brief Name of the histogram in statistics filled with the true energy of each sequentially read event
+     */
+    static constexpr const char* event_energy_histogram = "log10(True Energy(TeV)) of read events";
 private:
     /**
      * @brief Initialize the `SimtelFileHandler` and read util events
@@ -52,6 +74,11 @@ private:
     virtual void init_atmosphere_model() override;
     virtual void init_metaparam() override;
     virtual void init_subarray() override;
+    /**
+     * @brief Create the histograms in statistics, they are filled while the events are read
+     *
+     */
+    void init_statistics();
 
     /**
      * @brief Let the simtelfile_handler read the next event, SimtelEvent block
@@ -61,6 +88,19 @@ private:
      */
     bool _load_next_event() ;
     virtual bool is_finished()  override {return simtel_file_handler->no_more_blocks;}
+    // The showers are collected during the event loop, see on_iteration_end
+    virtual void init_simulated_showers() override {}
+    virtual void on_iteration_end() override;
+    /**
+     * @brief Read the shower blocks after the current position and take the showers collected by the file handler
+     * 
+     */
+    void collect_remaining_showers();
+    /**
+     * @brief Read all showers with a second file handler, without touching the event loop
+     * 
+     */
+    void read_all_showers_separately();
 
     /**
      * @brief Actually implementation of init_simulation_config, set the simulation configuration from the simtel file
@@ -85,13 +125,38 @@ private:
     void read_pointing(ArrayEvent& event);
     void apply_simtel_calibration(ArrayEvent& event);
     ArrayEvent get_event() override;
-    CameraGeometry get_telescope_camera_geometry(int tel_index);
+    /**
+     * @brief Random access through the event index, the next sequential read continues after this event.
+     *        The last monitor and calibration blocks of each telescope before the event are read first,
+     *        so the event has the same calibration as in a sequential read.
+     */
+    ArrayEvent get_event(int index) override;
+    /**
+     * @brief Fill the ArrayEvent from the currently loaded event
+     */
+    ArrayEvent read_loaded_event();
+    /**
+     * @brief Use the index recorded during the first pass once the whole file is read
+     */
+    void finish_recorded_index();
+    std::shared_ptr<const CameraGeometry> get_telescope_camera_geometry(int tel_index, double focal_length);
     CameraReadout get_telescope_camera_readout(int tel_index);
     OpticsDescription get_telescope_optics(int tel_index);
     std::array<double, 3> get_telescope_position(int tel_index);
     std::unique_ptr<SimtelFileHandler> simtel_file_handler;
     std::string camera_name;
     std::string optics_name;
+    // Given to the camera readouts of the subarray, the gain selection uses the readout value
     int gain_selector_threshold;
+    SimtelReadOptions read_options;
+    std::optional<SimtelEventIndex> event_index;
+    // Number of calibration blocks of the index reflected in the file handler after a random access, -1 if unknown
+    int64_t loaded_calibration_blocks = -1;
+    // Monitoring data shared by all events until a new monitor or calibration block arrives
+    struct CachedTelMonitor {
+        uint64_t version = 0;
+        std::shared_ptr<const TelMonitor> monitor;
+    };
+    std::unordered_map<int, CachedTelMonitor> monitor_cache;
 };
 
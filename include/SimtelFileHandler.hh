@@ -23,10 +23,26 @@
 #include <optional>
 #include <functional>
 #include "SimulatedShowerArray.hh"
+#include "SimtelEventIndex.hh"
 #include "spdlog/spdlog.h"
 
 using History_Entry = std::pair<time_t, std::string>;
 using History_List = std::vector<History_Entry>;
+/**
+ * @brief Options on how the input is read, the prefetch options are only used with the EventIO extension
+ * 
+ */
+struct SimtelReadOptions {
+    // Number of buffers decompressed ahead by a background thread, 0 decompresses on the reading thread
+    size_t prefetch_depth = 4;
+    size_t prefetch_buffer_size = 4 << 20;
+    // Upper limit of the memory used by the decompressed buffers
+    size_t max_prefetch_memory = 64 << 20;
+    // Without R1 the Calibrator extracts the DL0 images directly from the R0 samples
+    bool compute_r1 = true;
+    // Save the event index recorded during the first pass as a sidecar file next to the input
+    bool save_event_index = false;
+};
 class SimtelFileHandler {
     friend class SimtelEventSource;
 public:
@@ -55,7 +71,7 @@ public:
         TEST_BLOCK = 777
     };
 
-    SimtelFileHandler(const std::string& filename);
+    SimtelFileHandler(const std::string& filename, SimtelReadOptions options = {});
     SimtelFileHandler() = default;
     ~SimtelFileHandler();
     SimtelFileHandler(const SimtelFileHandler&) = delete;
@@ -66,6 +82,41 @@ public:
     SimtelFileHandler(SimtelFileHandler&& others) = delete;
     SimtelFileHandler& operator=(SimtelFileHandler&& others) = delete;
 
+    /**
+     * @brief Only decode the telescope events of the given telescopes, the sub-blocks of
+     *        other telescopes are skipped without unpacking the samples.
+     *        Must be called after the run header is read, an empty list decodes all telescopes.
+     * 
+     * @param tel_ids 
+     */
+    void set_telescope_selection(const std::vector<int>& tel_ids);
+
+    /**
+     * @brief Whether the input can be positioned, i.e. an uncompressed file
+     */
+    bool is_seekable() const;
+    /**
+     * @brief Scan the block headers of the whole file and record the offsets of each event,
+     *        the blocks are skipped without being read. The read position is restored afterwards.
+     * 
+     * @return SimtelEventIndex 
+     */
+    SimtelEventIndex scan_event_index();
+    /**
+     * @brief Record the offsets of each event while the file is read, see recorded_index
+     */
+    void start_recording_event_index();
+    /**
+     * @brief Load the event at the given position, the blocks between the MC_Event and the SimtelEvent
+     *        block are read as in load_next_event
+     * 
+     * @param entry 
+     * @param calibration_blocks monitor and calibration blocks read before the event,
+     *        see SimtelEventIndex::calibration_blocks_before
+     * @return true if the event is loaded
+     */
+    bool load_event_at(const SimtelEventIndexEntry& entry, const std::vector<SimtelCalibrationBlock>& calibration_blocks = {});
+
 #ifdef DEBUG
 public:
 #else
@@ -75,14 +126,24 @@ private:
     bool no_more_blocks = false;
     bool have_true_image = false;
     std::string filename = "none";
+    SimtelReadOptions read_options;
 
     SimulatedShowerArray shower_array;
+    // Whether the showers of the MC_Event blocks are pushed to shower_array
+    bool collect_showers = true;
+    // Filled while reading if start_recording_event_index was called
+    std::optional<SimtelEventIndex> recorded_index;
+    SimtelEventIndexEntry pending_index_entry;
     // C-Style Pointer here for eventio hsdata
     FILE* input_file = nullptr;
     IO_BUFFER* iobuf = nullptr;
     IO_ITEM_HEADER item_header;
     AllHessData* hsdata = nullptr;
     std::unordered_map<int, int> tel_id_to_index;
+    // Incremented by tel_index whenever a TelescopeMonitor or LaserCalibration block is read
+    std::unordered_map<int, uint64_t> monitor_version;
+    // Indexed by tel_index, empty if all telescopes are decoded
+    std::vector<bool> selected_tel_index;
     std::unordered_map<std::string, std::string> global_metadata;
     std::unordered_map<int, std::unordered_map<std::string, std::string>> tel_metadata;
 
@@ -115,6 +176,11 @@ private:
      */
     void only_read_blocks(std::vector<BlockType> block_types);
     bool only_read_mc_event();
+    /**
+     * @brief Read the shower blocks until the end of file, the remaining events are skipped
+     * 
+     */
+    void read_remaining_showers();
     /**
      * @brief Read the simtel file until we meet the SimtelEvent block and read it.
      * 
@@ -132,6 +198,13 @@ private:
     MetaParamList metadata_list;
     void find_block();
     void skip_block();
+    int64_t tell() const;
+    void seek(int64_t offset);
+    /**
+     * @brief Update the pending index entry with the block found at the offset,
+     *        a SimtelEvent block completes the entry and adds it to the index
+     */
+    void record_block_offset(SimtelEventIndex& index, int64_t offset);
     void read_block();
     void _read_history();
     void _read_metadata();
@@ -154,6 +227,13 @@ private:
     void _read_true_image();
     void _read_mc_pesum();
     void _read_simtel_event();
+    /**
+     * @brief Same as read_simtel_event, but skip the telescope and tracking sub-blocks
+     *        of telescopes not in selected_tel_index
+     * 
+     * @return int status of get_item_end, negative on error
+     */
+    int read_selected_simtel_event();
     void handle_history();
     void handle_metadata();
     void handle_runheader();
@@ -15,6 +15,7 @@ class ImageParameters;
 #include "TelImpactParameter.hh"
 #include "spdlog/fmt/fmt.h"
 #include "ImageParameters.hh"
+#include "PixelMask.hh"
 
 class SimulatedCamera {
 public:
@@ -39,7 +40,7 @@ public:
      * 
      */
     Eigen::VectorXd fake_image;
-    Eigen::Vector<bool, -1> fake_image_mask; // Mask for the fake image
+    PixelMask fake_image_mask; // Mask for the fake image
     Eigen::VectorXd pe_amplitude; // Amplitude of the photoelectrons
     Eigen::VectorXd pe_time; // Time of the photoelectrons
     double time_range_10_90;
@@ -28,4 +28,9 @@ public:
 
     std::vector<int> triggered_tels;
 
+    void reset() {
+        BaseTelContainer::reset();
+        triggered_tels.clear();
+    }
+
 };
\ No newline at end of file
@@ -47,6 +47,18 @@ public:
         shower_primary_ids.push_back(shower.shower_primary_id);
     }
 
+    void append(const SimulatedShowerArray& other) {
+        energies.insert(energies.end(), other.energies.begin(), other.energies.end());
+        alts.insert(alts.end(), other.alts.begin(), other.alts.end());
+        azs.insert(azs.end(), other.azs.begin(), other.azs.end());
+        core_xs.insert(core_xs.end(), other.core_xs.begin(), other.core_xs.end());
+        core_ys.insert(core_ys.end(), other.core_ys.begin(), other.core_ys.end());
+        h_first_ints.insert(h_first_ints.end(), other.h_first_ints.begin(), other.h_first_ints.end());
+        x_maxs.insert(x_maxs.end(), other.x_maxs.begin(), other.x_maxs.end());
+        starting_grammages.insert(starting_grammages.end(), other.starting_grammages.begin(), other.starting_grammages.end());
+        shower_primary_ids.insert(shower_primary_ids.end(), other.shower_primary_ids.begin(), other.shower_primary_ids.end());
+    }
+
     size_t size() const { return energies.size(); }
 
     // 属性访问方法，返回 Eigen::Map 避免复制
@@ -0,0 +1,101 @@
+/**
+ * @file SparseImage.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief Pixels surviving the image cleaning with their charges and peak times
+ * @version 0.1
+ * @date 2025-04-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include "Eigen/Dense"
+#include "PixelMask.hh"
+#include <vector>
+
+/**
+ * @brief Compact image of the pixels kept by the cleaning, in ascending pixel order.
+ *        A cleaned image usually keeps 10-100 of the few thousand camera pixels, so the image parameters
+ *        are computed from these lists instead of the full camera vectors.
+ */
+class SparseImage
+{
+public:
+    SparseImage() = default;
+    /**
+     * @brief Pixels of the mask, peak_time may be empty if there are no peak times
+     */
+    static SparseImage from_mask(const PixelMask& mask, const Eigen::VectorXd& image, const Eigen::VectorXd& peak_time = Eigen::VectorXd())
+    {
+        SparseImage sparse_image;
+        sparse_image.assign(mask, image, peak_time);
+        return sparse_image;
+    }
+    /**
+     * @brief Same as from_mask, the lists keep their storage so a reused image does not allocate
+     */
+    void assign(const PixelMask& mask, const Eigen::VectorXd& image, const Eigen::VectorXd& pixel_peak_time = Eigen::VectorXd())
+    {
+        n_pixels = mask.size();
+        const int n_kept = mask.count();
+        pixel_id.clear();
+        charge.clear();
+        peak_time.clear();
+        pixel_id.reserve(n_kept);
+        charge.reserve(n_kept);
+        const bool has_peak_time = pixel_peak_time.size() > 0;
+        if(has_peak_time)
+        {
+            peak_time.reserve(n_kept);
+        }
+        mask.for_each([&](int i)
+        {
+            pixel_id.push_back(i);
+            charge.push_back(image[i]);
+            if(has_peak_time)
+            {
+                peak_time.push_back(pixel_peak_time[i]);
+            }
+        });
+    }
+    /** @brief Number of pixels kept */
+    int size() const { return static_cast<int>(pixel_id.size()); }
+    bool empty() const { return pixel_id.empty(); }
+    double sum() const
+    {
+        double total = 0;
+        for(auto value: charge)
+        {
+            total += value;
+        }
+        return total;
+    }
+    PixelMask mask() const
+    {
+        PixelMask pixel_mask(n_pixels);
+        for(auto pixel: pixel_id)
+        {
+            pixel_mask.set(pixel);
+        }
+        return pixel_mask;
+    }
+    /**
+     * @brief Camera sized vector with the values of the kept pixels and zero elsewhere
+     */
+    template<typename Vector>
+    Vector to_dense(const std::vector<double>& values) const
+    {
+        Vector dense = Vector::Zero(n_pixels);
+        for(size_t i = 0; i < values.size(); i++)
+        {
+            dense[pixel_id[i]] = values[i];
+        }
+        return dense;
+    }
+
+    /** @brief Number of pixels of the camera */
+    int n_pixels = 0;
+    std::vector<int> pixel_id;
+    std::vector<double> charge;
+    std::vector<double> peak_time;
+};
@@ -26,19 +26,20 @@
 
         std::map<std::string, std::shared_ptr<Histogram<float>>> histograms;
         
+        /**
+         * @brief Add the histograms of other, histograms missing here are copied so the ones of other are not changed later
+         */
         Statistics& operator+=(const Statistics& other) {
-            if (histograms.empty())
+            for (const auto& [key, value] : other.histograms)
             {
-                histograms = other.histograms;
-            }
-            else
-            {
-                for (const auto& [key, value] : other.histograms)
+                auto it = histograms.find(key);
+                if (it == histograms.end())
+                {
+                    histograms.emplace(key, value->clone());
+                }
+                else
                 {
-                    if (histograms.find(key) != histograms.end())
-                    {
-                        *histograms.at(key) =  *histograms.at(key) + *value;
-                    }
+                    *it->second + *value;
                 }
             }
             return *this;
@@ -45,4 +45,8 @@ public:
     }
     const string print() const;
     std::vector<telescope_id_t> get_ordered_telescope_ids() const;
+    /**
+     * @brief Whether the other subarray has the same telescopes, at the same positions and with the same camera and optics
+     */
+    bool is_compatible(const SubarrayDescription& other) const;
 };
@@ -0,0 +1,50 @@
+/**
+ * @file ThreadPool.hh
+ * @author Zach Peng (zhipzhang@mail.ustc.edu.cn)
+ * @brief A small thread pool for the per-telescope work inside one event
+ * @version 0.1
+ * @date 2025-04-05
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t n_threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Call body(i) for i in [0, n) and return when all calls are done.
+     *        The calling thread runs tasks too, so parallel_for can be called from inside a task
+     *        or from several threads at once without waiting on a busy pool.
+     *        The first exception thrown by body is rethrown after all calls are done.
+     */
+    void parallel_for(size_t n, const std::function<void(size_t)>& body);
+    size_t size() const { return threads.size(); }
+
+    /**
+     * @brief Pool shared by all processors, with one thread less than the hardware threads
+     *        since the calling thread takes part in the work
+     */
+    static ThreadPool& shared();
+private:
+    void worker_loop();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    bool stop = false;
+    std::mutex tasks_mutex;
+    std::condition_variable tasks_not_empty;
+};
@@ -41,29 +41,39 @@ double point_line_distance(const std::array<T,3>& point,
   * 
   * @param waveform  2-channel waveform (assume the first channel is the high gain channel, sometimes the second channel is 0)
   * @param threshold threshold for the low gain channel
-  * @return Eigen::VectorXi
+  * @param gain_selector (n_pixels) output, its allocation is reused if it already has the size
   */
 template<typename T>
-Eigen::VectorXi select_gain_channel_by_threshold(const std::array<Eigen::Matrix<T, -1, -1, Eigen::RowMajor>, 2>& waveform, const double threshold)
+void select_gain_channel_by_threshold(const std::array<Eigen::Matrix<T, -1, -1, Eigen::RowMajor>, 2>& waveform, const double threshold, Eigen::VectorXi& gain_selector)
 {
     // Matrix is (n_pixels, n_samples)
-    // Vector returned is (n_pixels)
+    gain_selector.setZero(waveform[0].rows());
     if(waveform[1].isZero())
     {
-        return Eigen::VectorXi::Zero(waveform[0].rows());
+        return;
     }
-    else 
+    // If the high gain channel exceeds the threshold, select the low gain channel
+    for(int i = 0; i < waveform[0].rows(); i++)
     {
-        // If the high gain channel exceeds the threshold, select the low gain channel
-        Eigen::VectorXi gain_selector = Eigen::VectorXi::Zero(waveform[0].rows());
-        for(int i = 0; i < waveform[0].rows(); i++)
+        if((waveform[0].row(i).array() > threshold).any())
         {
-            if((waveform[0].row(i).array() > threshold).any())
-            {
-                gain_selector(i) = 1;
-            }
+            gain_selector(i) = 1;
         }
-        return gain_selector;
     }
+}
+ /**
+  * @brief Select the gain channel by threshold
+  * 
+  * @param waveform  2-channel waveform (assume the first channel is the high gain channel, sometimes the second channel is 0)
+  * @param threshold threshold for the low gain channel
+  * @return Eigen::VectorXi
+  */
+template<typename T>
+Eigen::VectorXi select_gain_channel_by_threshold(const std::array<Eigen::Matrix<T, -1, -1, Eigen::RowMajor>, 2>& waveform, const double threshold)
+{
+    // Vector returned is (n_pixels)
+    Eigen::VectorXi gain_selector;
+    select_gain_channel_by_threshold(waveform, threshold, gain_selector);
+    return gain_selector;
 }
 }
\ No newline at end of file
@@ -221,6 +221,8 @@ public:
     virtual void print(std::ostream& os = std::cout) const = 0;
     virtual int get_dimension() const = 0;
     virtual Histogram<Precision>& operator+ (const Histogram<Precision>& other) = 0;
+    // Deep copy, including the axes
+    virtual std::unique_ptr<Histogram<Precision>> clone() const = 0;
 };
 
 // 1D Histogram class
@@ -240,6 +242,9 @@ public:
     virtual int get_dimension() const override {
         return 1;
     }
+    std::unique_ptr<Histogram<Precision>> clone() const override {
+        return std::make_unique<Histogram1D<Precision>>(*this);
+    }
     Precision get_low_edge() const
     {
         return axis_->get_low_edge();
@@ -415,6 +420,9 @@ public:
     virtual int get_dimension() const override {
         return 2;
     }
+    std::unique_ptr<Histogram<Precision>> clone() const override {
+        return std::make_unique<Histogram2D<Precision>>(*this);
+    }
     Precision get_x_low_edge() const
     {
         return x_axis_->get_low_edge();
@@ -649,6 +657,9 @@ public:
     int get_dimension() const override {
         return 0;
     }
+    std::unique_ptr<Histogram<Precision>> clone() const override {
+        return std::make_unique<Profile1D<Precision>>(*this);
+    }
     // Fill profile with a point (x,y)
     void fill(Precision x, Precision y, Precision weight = 1.0) {
         int bin = this->axis_->index(x);
@@ -105,12 +105,12 @@ void RootEventHelper::process_dl2_rec_data(ArrayEvent& event)
 TelescopeDescription RootConfigHelper::get_telescope_description(int ientry)
 {
     auto root_optics_description_entry = root_optics_description->get_entry(ientry);
-    auto root_camera_geometry_entry = root_camera_geometry->get_entry(ientry);
+    auto root_camera_geometry_entry = root_camera_geometry->get_entry(ientry, root_optics_description_entry.get_focal_length());
     auto root_camera_readout_entry = root_camera_readout->get_entry(ientry);
 
     return TelescopeDescription{
         .camera_description = CameraDescription{
-            .camera_name = root_camera_geometry_entry.camera_name,
+            .camera_name = root_camera_geometry_entry->camera_name,
             .camera_geometry = root_camera_geometry_entry,
             .camera_readout = root_camera_readout_entry
         },
@@ -190,7 +190,7 @@ void RootWriter::write_subarray()
         if(!source.subarray->tels.count(id))
             continue;
             
-        const auto& camera_geom = source.subarray->tels.at(id).camera_description.camera_geometry;
+        const auto& camera_geom = *source.subarray->tels.at(id).camera_description.camera_geometry;
         const auto& camera_readout = source.subarray->tels.at(id).camera_description.camera_readout;
 
         root_camera_readout.tel_id = id;
@@ -331,11 +331,19 @@ void RootWriter::write_simulated_camera(const ArrayEvent& event, bool write_imag
         {
             sim_tree->Branch("true_image", &helper.root_simulation_camera->true_image);
             sim_tree->Branch("fake_image", &helper.root_simulation_camera->fake_image);
-            sim_tree->Branch("fake_image_mask", &helper.root_simulation_camera->fake_image_mask);
+            if(pack_masks)
+            {
+                sim_tree->Branch("fake_image_mask_bits", &helper.root_simulation_camera->fake_image_mask_bits);
+            }
+            else
+            {
+                sim_tree->Branch("fake_image_mask", &helper.root_simulation_camera->fake_image_mask);
+            }
         }
 
     }
     auto& root_simulated_camera = helper.root_simulation_camera.value();
+    root_simulated_camera.pack_masks = pack_masks;
     const auto& sim = event.simulation.value();
     root_simulated_camera.event_id = event.event_id;
     for(const auto& [tel_id,camera] : event.simulation->tels)
@@ -556,29 +564,73 @@ void RootWriter::write_dl1(const ArrayEvent& event, bool write_image)
         spdlog::debug("initialize dl1");
         initialize_data_level("dl1", helper.root_dl1_camera);
         dl1_tree = get_tree("dl1");
-        if(write_image)
+        if(write_image && sparse_images)
+        {
+            dl1_tree->Branch("n_pixels", &helper.root_dl1_camera->n_pixels);
+            dl1_tree->Branch("pixel_id", &helper.root_dl1_camera->pixel_id);
+            dl1_tree->Branch("pixel_charge", &helper.root_dl1_camera->pixel_charge);
+            dl1_tree->Branch("pixel_peak_time", &helper.root_dl1_camera->pixel_peak_time);
+        }
+        else if(write_image)
         {
             dl1_tree->Branch("image", &helper.root_dl1_camera->image);
             dl1_tree->Branch("peak_time", &helper.root_dl1_camera->peak_time);
-            dl1_tree->Branch("mask", &helper.root_dl1_camera->mask);
+            if(pack_masks)
+            {
+                dl1_tree->Branch("mask_bits", &helper.root_dl1_camera->mask_bits);
+            }
+            else
+            {
+                dl1_tree->Branch("mask", &helper.root_dl1_camera->mask);
+            }
         }
     }
     
     const auto& dl1 = event.dl1.value();
     auto& root_dl1_camera = helper.root_dl1_camera.value();
+    root_dl1_camera.pack_masks = pack_masks;
     root_dl1_camera.event_id = event.event_id;
     for(const auto& [tid, camera] : dl1.tels)
     {
         root_dl1_camera.tel_id = tid;
-        if(write_image)
+        if(write_image && sparse_images)
+        {
+            root_dl1_camera.fill_sparse_image(camera->cleaned_image);
+        }
+        else if(write_image)
         {
             root_dl1_camera.image = std::move(RVecF(camera->image.data(), camera->image.size()));
             root_dl1_camera.peak_time = std::move(RVecF(camera->peak_time.data(), camera->peak_time.size()));
-            root_dl1_camera.mask = std::move(RVecB(camera->mask.data(), camera->mask.size()));
+            fill_pixel_mask(camera->mask, root_dl1_camera.pack_masks, root_dl1_camera.mask_bits, root_dl1_camera.mask);
         }
         root_dl1_camera.datalevels.image_parameters = camera->image_parameters;
         dl1_tree->Fill();
     }
+    if(dl1.rejected_tels.empty())
+    {
+        return;
+    }
+    // The reasons of the telescopes without DL1 parameters go to their own tree, the tels tree only has parameterised images
+    auto rejected_tree = get_tree("dl1_rejected");
+    if(!rejected_tree)
+    {
+        TDirectory* dir = get_or_create_directory("events/dl1");
+        dir->cd();
+        helper.root_dl1_rejection = RootDL1Rejection();
+        rejected_tree = new TTree("rejected", "Telescopes with a DL0 image and no DL1 parameters");
+        helper.root_dl1_rejection->initialize_write(rejected_tree);
+        trees["dl1_rejected"] = rejected_tree;
+        directories["dl1_rejected"] = dir;
+        build_index["dl1_rejected"] = true;
+    }
+    auto& root_dl1_rejection = helper.root_dl1_rejection.value();
+    root_dl1_rejection.event_id = event.event_id;
+    for(const auto& [tel_id, reason] : dl1.rejected_tels)
+    {
+        root_dl1_rejection.tel_id = tel_id;
+        root_dl1_rejection.reason = static_cast<int>(reason);
+        rejected_tree->Fill();
+    }
 }
 
 void RootWriter::write_dl2(const ArrayEvent& event)
@@ -701,7 +753,8 @@ void RootWriter::write_monitor(const ArrayEvent& event)
     for(const auto& [tid, tel_monitor] : monitor.tels)
     {
         root_tel_monitor.tel_id = tid;
-        root_tel_monitor = std::move(*tel_monitor);
+        // The TelMonitor is shared with other events, so it is copied instead of moved
+        root_tel_monitor = TelMonitor(**tel_monitor);
         monitor_tree->Fill();
     }
 }
@@ -12,11 +12,13 @@
 #pragma once
 #include "ArrayEvent.hh"
 #include "CameraGeometry.hh"
+#include "CameraGeometryRegistry.hh"
 #include "CameraReadout.hh"
 #include "Eigen/src/Core/Matrix.h"
 #include "OpticsDescription.hh"
 #include "Pointing.hh"
 #include "SubarrayDescription.hh"
+#include "TClass.h"
 #include "TString.h"
 #include "tree_gemini.hh"
 #include "ROOT/RVec.hxx"
@@ -33,6 +35,35 @@
 #include <iostream>
 using namespace ROOT;
 
+/**
+ * @brief Mask read back from either the packed words or the bool per pixel branch
+ */
+inline PixelMask read_pixel_mask(const RVec<ULong64_t>* mask_bits, const RVecB* mask, int n_pixels)
+{
+    if(mask_bits)
+    {
+        if(n_pixels == 0)
+        {
+            n_pixels = static_cast<int>(mask_bits->size()) * 64;
+        }
+        return PixelMask::from_words(mask_bits->data(), mask_bits->size(), n_pixels);
+    }
+    return PixelMask::from_bools(mask->data(), mask->size());
+}
+/**
+ * @brief Fill the branch buffers of a mask, only the one that is written
+ */
+inline void fill_pixel_mask(const PixelMask& pixel_mask, bool pack, RVec<ULong64_t>& mask_bits, RVecB& mask)
+{
+    if(pack)
+    {
+        mask_bits.assign(pixel_mask.words().begin(), pixel_mask.words().end());
+        return;
+    }
+    mask.assign(pixel_mask.size(), false);
+    pixel_mask.for_each([&mask](int i) { mask[i] = true; });
+}
+
 /**
  * @brief Index structure for telescope data in an event
  */
@@ -98,6 +129,23 @@ class RootSimulationShower
        
 };
 
+/**
+ * @brief Telescopes with a DL0 image but no DL1 parameters, one entry per telescope with the ImageRejection reason
+ */
+class RootDL1Rejection
+{
+   public:
+       int event_id;
+       int tel_id;
+       int reason;
+       void initialize_write(TTree* tree)
+       {
+              tree->Branch("event_id", &event_id);
+              tree->Branch("tel_id", &tel_id);
+              tree->Branch("reason", &reason);
+       }
+};
+
 class CameraGeometryHelper
 {
     public:
@@ -284,21 +332,20 @@ class RootCameraGeometry: public RootTelConfiguration<CameraGeometryHelper>
                 tree->SetBranchAddress("pix_type", &pix_type_ptr);
             }
         }
-        CameraGeometry get_entry(int ientry)
+        /**
+         * @brief Geometry of the entry, shared with the other telescopes having the same camera
+         */
+        std::shared_ptr<const CameraGeometry> get_entry(int ientry, double focal_length)
         {
             read_tree->GetEntry(ientry);
-            Eigen::VectorXd pix_x = Eigen::Map<Eigen::VectorXd>(pix_x_ptr->data(), pix_x_ptr->size());
-            Eigen::VectorXd pix_y = Eigen::Map<Eigen::VectorXd>(pix_y_ptr->data(), pix_y_ptr->size());
-            Eigen::VectorXd pix_area = Eigen::Map<Eigen::VectorXd>(pix_area_ptr->data(), pix_area_ptr->size());
-            Eigen::VectorXi pix_type = Eigen::Map<Eigen::VectorXi>(pix_type_ptr->data(), pix_type_ptr->size());
-            return CameraGeometry(
-                *camera_name_ptr, 
-                config.num_pixels, 
-                pix_x, 
-                pix_y, 
-                pix_area, 
-                pix_type, 
-                config.cam_rotation
+            return CameraGeometryRegistry::shared().get(
+                *camera_name_ptr,
+                Eigen::Map<const Eigen::VectorXd>(pix_x_ptr->data(), pix_x_ptr->size()),
+                Eigen::Map<const Eigen::VectorXd>(pix_y_ptr->data(), pix_y_ptr->size()),
+                Eigen::Map<const Eigen::VectorXd>(pix_area_ptr->data(), pix_area_ptr->size()),
+                Eigen::Map<const Eigen::VectorXi>(pix_type_ptr->data(), pix_type_ptr->size()),
+                config.cam_rotation,
+                focal_length
             );
         }
         
@@ -376,6 +423,8 @@ class RootSimulatedCamera: public NewRootDataLevels<SimulatedCamera>
         RVecI true_image;
         RVecD fake_image;
         RVecB fake_image_mask; 
+        RVec<ULong64_t> fake_image_mask_bits;
+        bool pack_masks = false;
         ImageParameters fake_image_parameters;
 
         RootSimulatedCamera& operator=(SimulatedCamera&& other) noexcept
@@ -383,7 +432,7 @@ class RootSimulatedCamera: public NewRootDataLevels<SimulatedCamera>
             datalevels = std::move(other);
             true_image = std::move(RVecI(datalevels.true_image.data(), datalevels.true_image.size()));
             fake_image = std::move(RVecD(datalevels.fake_image.data(), datalevels.fake_image.size()));
-            fake_image_mask = std::move(RVecB(datalevels.fake_image_mask.data(), datalevels.fake_image_mask.size()));
+            fill_pixel_mask(datalevels.fake_image_mask, pack_masks, fake_image_mask_bits, fake_image_mask);
             return *this;
         }
         void initialize_internal_structure(TTree* tree) override
@@ -412,6 +461,10 @@ class RootSimulatedCamera: public NewRootDataLevels<SimulatedCamera>
             {
                 tree->SetBranchAddress("fake_image_mask", &fake_image_mask_ptr);
             }
+            if(tree->GetBranch("fake_image_mask_bits") != nullptr)
+            {
+                tree->SetBranchAddress("fake_image_mask_bits", &fake_image_mask_bits_ptr);
+            }
             TTreeSerializer::set_branch_addresses(tree, fake_image_parameters.hillas, "hillas");
             TTreeSerializer::set_branch_addresses(tree, fake_image_parameters.leakage, "leakage");
             TTreeSerializer::set_branch_addresses(tree, fake_image_parameters.concentration, "concentration");
@@ -429,9 +482,9 @@ class RootSimulatedCamera: public NewRootDataLevels<SimulatedCamera>
             {
                 datalevels.fake_image = Eigen::Map<Eigen::VectorXd>(fake_image_ptr->data(), fake_image_ptr->size());
             }
-            if(fake_image_mask_ptr)
+            if(fake_image_mask_ptr || fake_image_mask_bits_ptr)
             {
-                datalevels.fake_image_mask = Eigen::Map<Eigen::Vector<bool, -1>>(fake_image_mask_ptr->data(), fake_image_mask_ptr->size());
+                datalevels.fake_image_mask = read_pixel_mask(fake_image_mask_bits_ptr, fake_image_mask_ptr, fake_image_ptr ? fake_image_ptr->size() : 0);
             }
             datalevels.fake_image_parameters = fake_image_parameters;
         }
@@ -440,6 +493,7 @@ class RootSimulatedCamera: public NewRootDataLevels<SimulatedCamera>
         RVecI* true_image_ptr = nullptr;
         RVecD* fake_image_ptr = nullptr;
         RVecB* fake_image_mask_ptr = nullptr;
+        RVec<ULong64_t>* fake_image_mask_bits_ptr = nullptr;
 
 };
 class RootR0Camera: public NewRootDataLevels<R0Camera>
@@ -516,13 +570,13 @@ class RootR0Camera: public NewRootDataLevels<R0Camera>
 class RootR1Camera: public NewRootDataLevels<R1Camera>
 {
     public:
-        RVecD waveform;
+        RVecF waveform;
         RVecI gain_selection;
 
         RootR1Camera& operator=(R1Camera&& other) noexcept
         {
             datalevels = std::move(other);
-            waveform = std::move(RVecD(datalevels.waveform.data(), datalevels.n_pixels * datalevels.n_samples));
+            waveform = std::move(RVecF(datalevels.waveform.data(), datalevels.n_pixels * datalevels.n_samples));
             gain_selection = std::move(RVecI(datalevels.gain_selection.data(), datalevels.n_pixels));
             return *this;
         }
@@ -533,9 +587,20 @@ class RootR1Camera: public NewRootDataLevels<R1Camera>
         }
         void initialize_read_pointer(TTree* tree) override
         {
-            if(tree->GetBranch("waveform") != nullptr)
+            if(auto* branch = tree->GetBranch("waveform"); branch != nullptr)
             {
-                tree->SetBranchAddress("waveform", &waveform_ptr);
+                // Files written before the R1 waveform became float store it as RVec<double>
+                TClass* branch_class = nullptr;
+                EDataType branch_type;
+                branch->GetExpectedType(branch_class, branch_type);
+                if(branch_class == TClass::GetClass<RVecD>())
+                {
+                    tree->SetBranchAddress("waveform", &waveform_double_ptr);
+                }
+                else
+                {
+                    tree->SetBranchAddress("waveform", &waveform_ptr);
+                }
             }
             if(tree->GetBranch("gain_selection") != nullptr)
             {
@@ -546,7 +611,12 @@ class RootR1Camera: public NewRootDataLevels<R1Camera>
         {
             if(waveform_ptr)
             {
-                datalevels.waveform = Eigen::Map<Eigen::Matrix<double, -1, -1, Eigen::RowMajor>>(waveform_ptr->data(), datalevels.n_pixels, datalevels.n_samples);
+                datalevels.waveform = Eigen::Map<R1WaveformMatrix>(waveform_ptr->data(), datalevels.n_pixels, datalevels.n_samples);
+            }
+            else if(waveform_double_ptr)
+            {
+                using R1WaveformMatrixD = Eigen::Matrix<double, -1, -1, Eigen::RowMajor>;
+                datalevels.waveform = Eigen::Map<R1WaveformMatrixD>(waveform_double_ptr->data(), datalevels.n_pixels, datalevels.n_samples).cast<float>();
             }
             if(gain_selection_ptr)
             {
@@ -554,7 +624,8 @@ class RootR1Camera: public NewRootDataLevels<R1Camera>
             }
         }
     private:
-        RVecD* waveform_ptr = nullptr;
+        RVecF* waveform_ptr = nullptr;
+        RVecD* waveform_double_ptr = nullptr;
         RVecI* gain_selection_ptr = nullptr;
 };
 
@@ -608,13 +679,20 @@ class RootDL1Camera: public NewRootDataLevels<DL1Camera>
         RVecF image;
         RVecF peak_time;
         RVecB mask;
+        RVec<ULong64_t> mask_bits;
+        bool pack_masks = false;
+        // The pixels surviving the cleaning, written instead of the camera sized vectors for sparse images
+        int n_pixels = 0;
+        RVecI pixel_id;
+        RVecF pixel_charge;
+        RVecF pixel_peak_time;
 
         RootDL1Camera& operator=(DL1Camera&& other) noexcept
         {
             datalevels = std::move(other);
             image = std::move(RVecF(datalevels.image.data(), datalevels.image.size()));
             peak_time = std::move(RVecF(datalevels.peak_time.data(), datalevels.peak_time.size()));
-            mask = std::move(RVecB(datalevels.mask.data(), datalevels.mask.size()));
+            fill_pixel_mask(datalevels.mask, pack_masks, mask_bits, mask);
             return *this;
         }
         void initialize_internal_structure(TTree* tree) override
@@ -644,6 +722,17 @@ class RootDL1Camera: public NewRootDataLevels<DL1Camera>
             {
                 tree->SetBranchAddress("mask", &mask_ptr);
             }
+            if(tree->GetBranch("mask_bits") != nullptr)
+            {
+                tree->SetBranchAddress("mask_bits", &mask_bits_ptr);
+            }
+            if(tree->GetBranch("pixel_id") != nullptr)
+            {
+                tree->SetBranchAddress("n_pixels", &n_pixels);
+                tree->SetBranchAddress("pixel_id", &pixel_id_ptr);
+                tree->SetBranchAddress("pixel_charge", &pixel_charge_ptr);
+                tree->SetBranchAddress("pixel_peak_time", &pixel_peak_time_ptr);
+            }
             TTreeSerializer::set_branch_addresses(tree, datalevels.image_parameters.hillas, "hillas");
             TTreeSerializer::set_branch_addresses(tree, datalevels.image_parameters.leakage, "leakage");
             TTreeSerializer::set_branch_addresses(tree, datalevels.image_parameters.concentration, "concentration");
@@ -661,16 +750,41 @@ class RootDL1Camera: public NewRootDataLevels<DL1Camera>
             {
                 datalevels.peak_time = Eigen::Map<Eigen::VectorXf>(peak_time_ptr->data(), peak_time_ptr->size());
             }
-            if(mask_ptr)
+            if(mask_ptr || mask_bits_ptr)
             {
-                datalevels.mask = Eigen::Map<Eigen::Vector<bool, -1>>(mask_ptr->data(), mask_ptr->size());
+                datalevels.mask = read_pixel_mask(mask_bits_ptr, mask_ptr, image_ptr ? image_ptr->size() : 0);
             }
+            if(pixel_id_ptr)
+            {
+                auto& cleaned_image = datalevels.cleaned_image;
+                cleaned_image.n_pixels = n_pixels;
+                cleaned_image.pixel_id.assign(pixel_id_ptr->begin(), pixel_id_ptr->end());
+                cleaned_image.charge.assign(pixel_charge_ptr->begin(), pixel_charge_ptr->end());
+                cleaned_image.peak_time.assign(pixel_peak_time_ptr->begin(), pixel_peak_time_ptr->end());
+                datalevels.image = cleaned_image.to_dense<Eigen::VectorXf>(cleaned_image.charge);
+                datalevels.peak_time = cleaned_image.to_dense<Eigen::VectorXf>(cleaned_image.peak_time);
+                datalevels.mask = cleaned_image.mask();
+            }
+        }
+        /**
+         * @brief Fill the branches of the sparse image from the pixels kept by the cleaning
+         */
+        void fill_sparse_image(const SparseImage& cleaned_image)
+        {
+            n_pixels = cleaned_image.n_pixels;
+            pixel_id.assign(cleaned_image.pixel_id.begin(), cleaned_image.pixel_id.end());
+            pixel_charge.assign(cleaned_image.charge.begin(), cleaned_image.charge.end());
+            pixel_peak_time.assign(cleaned_image.peak_time.begin(), cleaned_image.peak_time.end());
         }
         
     private:
         RVecF* image_ptr = nullptr;
         RVecF* peak_time_ptr = nullptr;
         RVecB* mask_ptr = nullptr;
+        RVec<ULong64_t>* mask_bits_ptr = nullptr;
+        RVecI* pixel_id_ptr = nullptr;
+        RVecF* pixel_charge_ptr = nullptr;
+        RVecF* pixel_peak_time_ptr = nullptr;
 };
 
 class RootDL2Camera: public NewRootDataLevels<TelReconstructedParameter>
@@ -912,6 +1026,7 @@ class RootEventHelper
         std::optional<RootR1Camera> root_r1_camera;
         std::optional<RootDL0Camera> root_dl0_camera;
         std::optional<RootDL1Camera> root_dl1_camera;
+        std::optional<RootDL1Rejection> root_dl1_rejection;
         std::optional<RootDL2Camera> root_dl2_camera;
         std::unordered_map<std::string, std::optional<RootDL2RecGeometry>> root_dl2_rec_geometry_map;
         std::unordered_map<std::string, std::optional<RootDL2RecEnergy>> root_dl2_rec_energy_map;
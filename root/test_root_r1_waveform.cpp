@@ -0,0 +1,96 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "RootDataLevels.hh"
+#include "TFile.h"
+#include "doctest/doctest.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace {
+constexpr int n_pixels = 3;
+constexpr int n_samples = 4;
+
+R1Camera make_r1_camera()
+{
+    R1Camera camera;
+    camera.n_pixels = n_pixels;
+    camera.n_samples = n_samples;
+    camera.waveform.resize(n_pixels, n_samples);
+    for(int pix = 0; pix < n_pixels; pix++)
+    {
+        for(int k = 0; k < n_samples; k++)
+        {
+            camera.waveform(pix, k) = 0.25f * (pix * n_samples + k) - 1.0f;
+        }
+    }
+    camera.gain_selection = Eigen::VectorXi::LinSpaced(n_pixels, 0, n_pixels - 1);
+    return camera;
+}
+
+// The R1 tree as written before the waveform became float
+void write_double_layout(TTree* tree, const R1Camera& camera)
+{
+    int event_id = 7;
+    int tel_id = 2;
+    int camera_n_pixels = camera.n_pixels;
+    int camera_n_samples = camera.n_samples;
+    RVecD waveform(camera.waveform.data(), camera.waveform.data() + camera.waveform.size());
+    RVecI gain_selection(camera.gain_selection.data(), camera.gain_selection.data() + camera.gain_selection.size());
+    tree->Branch("event_id", &event_id);
+    tree->Branch("tel_id", &tel_id);
+    tree->Branch("n_pixels", &camera_n_pixels);
+    tree->Branch("n_samples", &camera_n_samples);
+    tree->Branch("waveform", &waveform);
+    tree->Branch("gain_selection", &gain_selection);
+    tree->Fill();
+    tree->ResetBranchAddresses();
+}
+void write_float_layout(TTree* tree, const R1Camera& camera)
+{
+    RootR1Camera root_camera;
+    root_camera.initialize_write(tree);
+    root_camera.event_id = 7;
+    root_camera.tel_id = 2;
+    root_camera = R1Camera(camera);
+    tree->Fill();
+    tree->ResetBranchAddresses();
+}
+
+template<typename WriteFunction>
+void check_read_back(const std::string& filename, WriteFunction write)
+{
+    const auto camera = make_r1_camera();
+    {
+        TFile file(filename.c_str(), "RECREATE");
+        auto* tree = new TTree("r1", "r1");
+        write(tree, camera);
+        file.Write();
+    }
+    TFile file(filename.c_str(), "READ");
+    auto* tree = file.Get<TTree>("r1");
+    REQUIRE(tree);
+    RootR1Camera root_camera;
+    root_camera.initialize_read(tree);
+    const auto& read_camera = root_camera.get_entry(0);
+    CHECK(root_camera.event_id == 7);
+    CHECK(root_camera.tel_id == 2);
+    REQUIRE(read_camera.waveform.rows() == n_pixels);
+    REQUIRE(read_camera.waveform.cols() == n_samples);
+    CHECK(read_camera.waveform == camera.waveform);
+    CHECK(read_camera.gain_selection == camera.gain_selection);
+}
+}
+
+TEST_CASE("Read back R1 waveforms")
+{
+    auto filename = (std::filesystem::temp_directory_path() / "test_root_r1_waveform.root").string();
+    SUBCASE("test_float_branch")
+    {
+        check_read_back(filename, write_float_layout);
+    }
+    SUBCASE("test_double_branch")
+    {
+        check_read_back(filename, write_double_layout);
+    }
+    std::filesystem::remove(filename);
+}
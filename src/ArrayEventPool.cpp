@@ -0,0 +1,39 @@
+#include "ArrayEventPool.hh"
+
+ArrayEventPool::ArrayEventPool(size_t max_events): max_events(max_events)
+{
+    // Reserved up front, so recycling never allocates
+    events.reserve(max_events);
+}
+
+ArrayEvent ArrayEventPool::acquire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(events.empty())
+    {
+        return ArrayEvent();
+    }
+    ArrayEvent event = std::move(events.back());
+    events.pop_back();
+    return event;
+}
+
+void ArrayEventPool::recycle(ArrayEvent&& event)
+{
+    if(!event.has_levels())
+    {
+        return;
+    }
+    event.reset();
+    std::lock_guard<std::mutex> lock(mutex);
+    if(events.size() < max_events)
+    {
+        events.push_back(std::move(event));
+    }
+}
+
+size_t ArrayEventPool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return events.size();
+}
@@ -1,36 +1,17 @@
 #include "Calibration.hh"
 #include "Configurable.hh"
 #include "DL0Event.hh"
+#include "ThreadPool.hh"
+#include "Utils.hh"
 #include <stdexcept>
 
-Eigen::VectorXi select_gain_channel_by_threshold(const std::array<Eigen::Matrix<uint16_t, -1, -1, Eigen::RowMajor>, 2>& waveform, const double threshold)
-{
-    // Matrix is (n_pixels, n_samples)
-    // Vector returned is (n_pixels)
-    if(waveform[1].isZero())
-    {
-        return Eigen::VectorXi::Zero(waveform[0].rows());
-    }
-    else 
-    {
-        // If the high gain channel exceeds the threshold, select the low gain channel
-        Eigen::VectorXi gain_selector = Eigen::VectorXi::Zero(waveform[0].rows());
-        for(int i = 0; i < waveform[0].rows(); i++)
-        {
-            if((waveform[0].row(i).array() > threshold).any())
-            {
-                gain_selector(i) = 1;
-            }
-        }
-        return gain_selector;
-    }
-}
-
 json Calibrator::get_default_config()
 {
     std::string default_config = R"(
     {
-        "image_extractor_type": "LocalPeakExtractor"
+        "image_extractor_type": "LocalPeakExtractor",
+        "parallel_telescopes": false,
+        "min_parallel_telescopes": 4
     }
     )";
     json base_config = Configurable::from_string(default_config);
@@ -43,6 +24,8 @@ void Calibrator::configure(const json &config)
     try {
         const json& cfg = config.contains("Calibrator") ? config.at("Calibrator") : config;
         image_extractor_type = cfg["image_extractor_type"];
+        parallel_telescopes = cfg.value("parallel_telescopes", false);
+        min_parallel_telescopes = cfg.value("min_parallel_telescopes", 4);
         if(image_extractor_type == "LocalPeakExtractor")
         {
             image_extractor = ImageExtractorFactory::create<LocalPeakExtractor>(subarray, cfg);
@@ -59,15 +42,77 @@ void Calibrator::configure(const json &config)
         throw std::runtime_error("Error configuring Calibrator: " + std::string(e.what()));
     }
 }
-void Calibrator::operator()(ArrayEvent& event)
+void Calibrator::operator()(ArrayEvent& event) const
 {
-    if(!event.dl0)
+    event.emplace_level<DL0Event>();
+    // Without R1 computed by the source, the images are extracted from the R0 samples
+    bool from_r0 = !event.r1;
+    if(from_r0 && (!event.r0 || !event.monitor))
+    {
+        throw std::runtime_error("Calibrator needs the R1 waveform or the R0 waveform with monitor data");
+    }
+    // The DL0 slots are created first, so the telescopes can be extracted independently. They reuse the images
+    // a recycled event left. The slot list is kept by the calling thread from event to event, the tasks on the
+    // pool get it through the reference
+    thread_local std::vector<std::pair<int, DL0Camera*>> thread_dl0_slots;
+    auto& dl0_slots = thread_dl0_slots;
+    dl0_slots.clear();
+    auto add_slot = [&dl0_slots, &event](int tel_id) {
+        if(event.dl0->reuse_tel(tel_id))
+        {
+            dl0_slots.emplace_back(tel_id, nullptr);
+        }
+    };
+    if(from_r0)
+    {
+        for(const auto& [tel_id, r0_camera]: event.r0->tels)
+        {
+            add_slot(tel_id);
+        }
+    }
+    else
     {
-        event.dl0 = DL0Event();
+        for(const auto& [tel_id, r1_camera]: event.r1->tels)
+        {
+            add_slot(tel_id);
+        }
     }
-    for(const auto& [tel_id, r1_camera]: event.r1->tels)
+    // Adding a telescope may move the ones added before, so the slots are looked up once all are added
+    for(auto& [tel_id, dl0_camera]: dl0_slots)
     {
-        auto [charge, peak_time] = (*image_extractor)(r1_camera->waveform, r1_camera->gain_selection, tel_id);
-        event.dl0->add_tel(tel_id, DL0Camera{.image = std::move(charge), .peak_time=std::move(peak_time)});
+        dl0_camera = event.dl0->get_tel(tel_id);
     }
-}
\ No newline at end of file
+    auto extract_tel = [this, &dl0_slots, &event, from_r0](size_t i) {
+        auto [tel_id, dl0_camera] = dl0_slots[i];
+        if(from_r0)
+        {
+            const auto* r0_camera = event.r0->get_tel(tel_id);
+            const auto* tel_monitor = event.monitor->get_tel(tel_id);
+            if(!tel_monitor)
+            {
+                throw std::runtime_error("No monitor data for tel_id " + std::to_string(tel_id));
+            }
+            // Same gain selection as the source uses for R1
+            const auto& camera_readout = subarray.tels.at(tel_id).camera_description.camera_readout;
+            thread_local Eigen::VectorXi gain_selection;
+            Utils::select_gain_channel_by_threshold<uint16_t>(r0_camera->waveform, camera_readout.gain_selector_threshold, gain_selection);
+            image_extractor->extract_r0(r0_camera->waveform, gain_selection, *tel_monitor, tel_id, dl0_camera->image, dl0_camera->peak_time);
+        }
+        else
+        {
+            const auto* r1_camera = event.r1->get_tel(tel_id);
+            image_extractor->extract(r1_camera->waveform, r1_camera->gain_selection, tel_id, dl0_camera->image, dl0_camera->peak_time);
+        }
+    };
+    if(parallel_telescopes && dl0_slots.size() >= min_parallel_telescopes)
+    {
+        ThreadPool::shared().parallel_for(dl0_slots.size(), extract_tel);
+    }
+    else
+    {
+        for(size_t i = 0; i < dl0_slots.size(); i++)
+        {
+            extract_tel(i);
+        }
+    }
+}
@@ -9,5 +9,5 @@ const string CameraDescription::print() const
     "    camera_name: {}\n"
     "    camera_geometry: {}\n"
     "    camera_readout: {}\n"
-    ")", camera_name, camera_geometry.print(), camera_readout.print());
+    ")", camera_name, camera_geometry ? camera_geometry->print() : "None", camera_readout.print());
 }
@@ -4,6 +4,8 @@
 #include "nanoflann.hpp"
 #include <cstddef>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 CameraGeometry::CameraGeometry(std::string camera_name, int num_pixels, double* pix_x, double* pix_y, double* pix_area, int* pix_type, double cam_rotation):
     camera_name(camera_name), num_pixels(num_pixels), cam_rotation(cam_rotation)
 {
@@ -109,38 +111,90 @@ void CameraGeometry::compute_neighbor_matrix(bool diagnal )
         }
     }
     neigh_matrix.makeCompressed();
+    // The cleaning kernels walk the neighbor lists instead of multiplying with the sparse matrix
+    if(num_pixels > std::numeric_limits<int16_t>::max() + 1)
+    {
+        throw std::runtime_error("Too many pixels for the 16 bit neighbor lists: " + std::to_string(num_pixels));
+    }
+    neighbor_offsets.assign(neigh_matrix.outerIndexPtr(), neigh_matrix.outerIndexPtr() + num_pixels + 1);
+    neighbor_indices.assign(neigh_matrix.innerIndexPtr(), neigh_matrix.innerIndexPtr() + neigh_matrix.nonZeros());
+    // Every width is dilated from the previous one until the mask stops growing
+    border_pixel_mask.clear();
+    int width = 1;
+    PixelMask border_mask = compute_border_pixel_mask(1);
+    while(true)
+    {
+        int n_border = border_mask.count();
+        border_pixel_mask[width] = border_mask;
+        if(n_border == num_pixels)
+        {
+            break;
+        }
+        dilate(border_mask);
+        if(border_mask.count() == n_border)
+        {
+            break;
+        }
+        width++;
+    }
+    // The leakage parameters use width 1 and 2 even for cameras covered by the outermost ring
+    if(!border_pixel_mask.count(2))
+    {
+        border_pixel_mask[2] = border_pixel_mask.at(width);
+    }
+}
+PixelMask CameraGeometry::get_border_pixel_mask(int width) const
+{
+    auto it = border_pixel_mask.find(width);
+    if(it != border_pixel_mask.end())
+    {
+        return it->second;
+    }
+    if(width > 0 && !border_pixel_mask.empty())
+    {
+        // The widest mask already covers every pixel it can reach
+        return border_pixel_mask.at(static_cast<int>(border_pixel_mask.size()));
+    }
+    return compute_border_pixel_mask(width);
+}
+void CameraGeometry::compute_fov_coordinates(double focal_length)
+{
+    pix_x_fov = pix_x / focal_length;
+    pix_y_fov = pix_y / focal_length;
+    pix_width_fov = pix_width / focal_length;
 }
-Eigen::Vector<bool, -1> CameraGeometry::get_border_pixel_mask(int width)
+PixelMask CameraGeometry::compute_border_pixel_mask(int width) const
 {
-    try{
-        return border_pixel_mask.at(width);
+    spdlog::debug("Computing border pixel mask for width {}", width);
+    int max_neighbor_number = 0;
+    for(int i = 0; i < num_pixels; i++)
+    {
+        max_neighbor_number = std::max(max_neighbor_number, neighbor_offsets[i + 1] - neighbor_offsets[i]);
     }
-    catch(const std::out_of_range& e)
+    PixelMask border_mask(num_pixels);
+    for(int i = 0; i < num_pixels; i++)
     {
-        spdlog::debug("Computing border pixel mask for width {}", width);
-        Eigen::VectorXi neighbor_number = neigh_matrix * Eigen::VectorXi::Ones(neigh_matrix.cols());
-        double max_neighbor_number = neighbor_number.maxCoeff();
-        Eigen::Vector<bool, -1> outermost_pixel_mask = neighbor_number.array() < max_neighbor_number;
-        if(width == 1)
+        if(neighbor_offsets[i + 1] - neighbor_offsets[i] < max_neighbor_number)
         {
-            border_pixel_mask[width] = outermost_pixel_mask;
-            return outermost_pixel_mask;
+            border_mask.set(i);
         }
-        else
+    }
+    for(int i = 0; i < width - 1; i++)
+    {
+        dilate(border_mask);
+    }
+    return border_mask;
+}
+void CameraGeometry::dilate(PixelMask& mask) const
+{
+    PixelMask dilated = mask;
+    mask.for_each([this, &dilated](int pixel) {
+        for(int k = neighbor_offsets[pixel]; k < neighbor_offsets[pixel + 1]; k++)
         {
-            Eigen::Vector<bool, -1> border_mask;
-            Eigen::Vector<bool, -1> previous_border_mask = outermost_pixel_mask;
-            for(int i = 0; i < width - 1; i++)
-            {
-                border_mask = (neigh_matrix * previous_border_mask.cast<int>()).array() > 0;
-                border_mask = (border_mask.array() || previous_border_mask.array());
-                previous_border_mask = border_mask;
-            }
-            this->border_pixel_mask[width] = border_mask;
-            return border_mask;
+            dilated.set(neighbor_indices[k]);
         }
-        
-    }
+    });
+    mask = std::move(dilated);
 }
 const string CameraGeometry::print() const
 {
@@ -0,0 +1,90 @@
+#include "CameraGeometryRegistry.hh"
+#include "spdlog/spdlog.h"
+#include <functional>
+#include <stdexcept>
+
+namespace {
+// FNV-1a over the bytes of the pixel table
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t n_bytes)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < n_bytes; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+bool same_values(const Eigen::VectorXd& stored, const Eigen::Ref<const Eigen::VectorXd>& values)
+{
+    return stored.size() == values.size() && (stored.array() == values.array()).all();
+}
+}
+
+uint64_t CameraGeometryRegistry::hash_pixel_table(const Eigen::Ref<const Eigen::VectorXd>& pix_x, const Eigen::Ref<const Eigen::VectorXd>& pix_y, const Eigen::Ref<const Eigen::VectorXd>& pix_area, const Eigen::Ref<const Eigen::VectorXi>& pix_type, double cam_rotation)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const int64_t num_pixels = pix_x.size();
+    hash = hash_bytes(hash, &num_pixels, sizeof(num_pixels));
+    hash = hash_bytes(hash, pix_x.data(), pix_x.size() * sizeof(double));
+    hash = hash_bytes(hash, pix_y.data(), pix_y.size() * sizeof(double));
+    hash = hash_bytes(hash, pix_area.data(), pix_area.size() * sizeof(double));
+    hash = hash_bytes(hash, pix_type.data(), pix_type.size() * sizeof(int));
+    return hash_bytes(hash, &cam_rotation, sizeof(cam_rotation));
+}
+
+size_t CameraGeometryRegistry::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = std::hash<std::string>()(key.camera_name);
+    hash ^= std::hash<uint64_t>()(key.pixel_hash) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<double>()(key.focal_length) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+std::shared_ptr<const CameraGeometry> CameraGeometryRegistry::get(const std::string& camera_name, const Eigen::Ref<const Eigen::VectorXd>& pix_x, const Eigen::Ref<const Eigen::VectorXd>& pix_y, const Eigen::Ref<const Eigen::VectorXd>& pix_area, const Eigen::Ref<const Eigen::VectorXi>& pix_type, double cam_rotation, double focal_length)
+{
+    if(pix_y.size() != pix_x.size() || pix_area.size() != pix_x.size() || pix_type.size() != pix_x.size())
+    {
+        throw std::runtime_error("Pixel table of camera " + camera_name + " has columns of different lengths");
+    }
+    Key key{camera_name, hash_pixel_table(pix_x, pix_y, pix_area, pix_type, cam_rotation), focal_length};
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = geometries.find(key);
+    if(it != geometries.end())
+    {
+        if(auto geometry = it->second.lock())
+        {
+            if(same_values(geometry->pix_x, pix_x) && same_values(geometry->pix_y, pix_y) && same_values(geometry->pix_area, pix_area) && geometry->pix_type == pix_type && geometry->cam_rotation == cam_rotation)
+            {
+                return geometry;
+            }
+            // A hash collision, the geometry is built without sharing it
+            spdlog::warn("Camera {} has the pixel table hash of another camera, building it separately", camera_name);
+            auto separate_geometry = std::make_shared<CameraGeometry>(camera_name, static_cast<int>(pix_x.size()), pix_x, pix_y, pix_area, pix_type, cam_rotation);
+            separate_geometry->compute_fov_coordinates(focal_length);
+            return separate_geometry;
+        }
+    }
+    spdlog::debug("Building the geometry of camera {} with {} pixels", camera_name, pix_x.size());
+    auto geometry = std::make_shared<CameraGeometry>(camera_name, static_cast<int>(pix_x.size()), pix_x, pix_y, pix_area, pix_type, cam_rotation);
+    geometry->compute_fov_coordinates(focal_length);
+    geometries[key] = geometry;
+    return geometry;
+}
+
+size_t CameraGeometryRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n_alive = 0;
+    for(const auto& [key, geometry]: geometries)
+    {
+        n_alive += !geometry.expired();
+    }
+    return n_alive;
+}
+
+CameraGeometryRegistry& CameraGeometryRegistry::shared()
+{
+    static CameraGeometryRegistry registry;
+    return registry;
+}
@@ -10,5 +10,6 @@ const string CameraReadout::print() const
     "    n_channels: {}\n"
     "    n_pixels: {}\n"
     "    n_samples: {}\n"
-    ")", camera_name, sampling_rate, reference_pulse_sample_width, n_channels, n_pixels, n_samples);
+    "    gain_selector_threshold: {}\n"
+    ")", camera_name, sampling_rate, reference_pulse_sample_width, n_channels, n_pixels, n_samples, gain_selector_threshold);
 }
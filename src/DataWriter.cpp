@@ -15,6 +15,8 @@ json DataWriter::get_default_config()
         "write_dl0": true,
         "write_dl1": true,
         "write_dl1_image": false,
+        "pack_masks": false,
+        "sparse_dl1_image": false,
         "write_dl2": true,
         "write_monitor": true,
         "write_pointing": true,
@@ -37,6 +39,8 @@ void DataWriter::configure(const json& config)
     }
     file_writer = DataWriterFactory::instance().create(output_type, source, filename);
     file_writer->open(config.at("overwrite"));
+    file_writer->pack_masks = config.value("pack_masks", false);
+    file_writer->sparse_images = config.value("sparse_dl1_image", false);
     if(config.at("write_atmosphere_model"))
     {
         file_writer->write_atmosphere_model();
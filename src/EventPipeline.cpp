@@ -0,0 +1,184 @@
+#include "EventPipeline.hh"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+json EventPipeline::get_default_config()
+{
+    std::string default_config = R"(
+    {
+        "n_workers": 4,
+        "max_events_in_flight": 64
+    }
+    )";
+    json base_config = Configurable::from_string(default_config);
+    base_config["calibrator"] = Calibrator::get_default_config();
+    base_config["image_processor"] = ImageProcessor::get_default_config();
+    base_config["shower_processor"] = ShowerProcessor::get_default_config();
+    return base_config;
+}
+
+void EventPipeline::configure(const json& config)
+{
+    if(!source.subarray.has_value())
+    {
+        throw std::runtime_error("EventPipeline needs a source with a subarray description");
+    }
+    try {
+        n_workers = config.at("n_workers");
+        if(n_workers <= 0)
+        {
+            n_workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        max_events_in_flight = std::max<size_t>(config.at("max_events_in_flight").get<size_t>(), n_workers);
+        calibrator = std::make_unique<Calibrator>(*source.subarray, config.at("calibrator"));
+        image_processor = std::make_unique<ImageProcessor>(*source.subarray, config.at("image_processor"));
+        shower_processor = std::make_unique<ShowerProcessor>(*source.subarray, config.at("shower_processor"));
+    }
+    catch(const std::exception& e) {
+        throw std::runtime_error("Error configuring EventPipeline: " + std::string(e.what()));
+    }
+}
+
+EventPipeline::~EventPipeline()
+{
+    stop_workers();
+}
+
+void EventPipeline::run(DataWriter& data_writer)
+{
+    run([&data_writer](ArrayEvent& event) { data_writer(event); });
+}
+
+void EventPipeline::run(const std::function<void(ArrayEvent&)>& consumer)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop = false;
+        worker_error = nullptr;
+        input_queue.clear();
+        output_events.clear();
+    }
+    for(int i = 0; i < n_workers; i++)
+    {
+        threads.emplace_back(&EventPipeline::worker_loop, this);
+    }
+    size_t n_read = 0;
+    size_t n_written = 0;
+    // Write all processed events that are next in the order of the source, optionally waiting for the next one.
+    // Returns whether a worker failed, worker_error is only read under the lock while the workers run
+    auto write_ready_events = [&](bool wait) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if(wait)
+        {
+            output_ready.wait(lock, [&]() { return worker_error || output_events.count(n_written) > 0; });
+        }
+        while(!worker_error && !output_events.empty() && output_events.begin()->first == n_written)
+        {
+            auto event = std::move(output_events.begin()->second);
+            output_events.erase(output_events.begin());
+            lock.unlock();
+            consumer(event);
+            // The source reads the next events into the storage of the written ones
+            source.recycle_event(std::move(event));
+            n_written++;
+            lock.lock();
+        }
+        return worker_error != nullptr;
+    };
+    bool failed = false;
+    try {
+        for(auto& event: source)
+        {
+            while(!failed && n_read - n_written >= max_events_in_flight)
+            {
+                failed = write_ready_events(true);
+            }
+            if(failed)
+            {
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                input_queue.emplace_back(n_read, std::move(event));
+            }
+            input_not_empty.notify_one();
+            n_read++;
+            failed = write_ready_events(false);
+            if(failed)
+            {
+                break;
+            }
+        }
+        while(!failed && n_written < n_read)
+        {
+            failed = write_ready_events(true);
+        }
+    }
+    catch(...) {
+        stop_workers();
+        throw;
+    }
+    stop_workers();
+    // The workers are joined, so worker_error can be read without the lock
+    if(worker_error)
+    {
+        std::rethrow_exception(worker_error);
+    }
+    spdlog::debug("EventPipeline processed {} events with {} workers", n_written, n_workers);
+}
+
+void EventPipeline::worker_loop()
+{
+    while(true)
+    {
+        std::pair<size_t, ArrayEvent> item;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            input_not_empty.wait(lock, [this]() { return stop || !input_queue.empty(); });
+            if(stop)
+            {
+                return;
+            }
+            item = std::move(input_queue.front());
+            input_queue.pop_front();
+        }
+        try {
+            (*calibrator)(item.second);
+            (*image_processor)(item.second);
+            (*shower_processor)(item.second);
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if(!worker_error)
+            {
+                worker_error = std::current_exception();
+            }
+            output_ready.notify_all();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            output_events.emplace(item.first, std::move(item.second));
+        }
+        output_ready.notify_all();
+    }
+}
+
+void EventPipeline::stop_workers()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop = true;
+    }
+    input_not_empty.notify_all();
+    for(auto& thread: threads)
+    {
+        if(thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
@@ -24,52 +24,53 @@ void GeometryReconstructor::configure(const json& config)
         use_fake_hillas = config["use_fake_hillas"];
     }
 }
-void GeometryReconstructor::operator()(ArrayEvent& event)
+void GeometryReconstructor::operator()(ArrayEvent& event) const
+{
+    select_telescopes(event);
+}
+GeometryReconstructionInput GeometryReconstructor::select_telescopes(ArrayEvent& event) const
 {
     if(!event.dl1.has_value())
     {
         throw std::runtime_error("dl1  level event not found");
     }
-    if(!event.dl2.has_value())
-    {
-        event.dl2 = DL2Event();
-    }
-    hillas_dicts.clear();
-    telescopes.clear();
-    array_pointing_direction = SphericalRepresentation(event.pointing->array_azimuth, event.pointing->array_altitude);
-    nominal_frame = std::make_unique<TelescopeFrame>(SphericalRepresentation(event.pointing->array_azimuth, event.pointing->array_altitude));
+    event.emplace_level<DL2Event>();
+    GeometryReconstructionInput input;
+    input.array_pointing_direction = SphericalRepresentation(event.pointing->array_azimuth, event.pointing->array_altitude);
+    input.nominal_frame = std::make_unique<TelescopeFrame>(SphericalRepresentation(event.pointing->array_azimuth, event.pointing->array_altitude));
     if(use_fake_hillas)
     {
         for(const auto tel_id: event.simulation->triggered_tels)
         {
-            if((*query_)(event.simulation->tels[tel_id]->fake_image_parameters))
+            if((*query_)(event.simulation->tels.at(tel_id)->fake_image_parameters))
             {
-                hillas_dicts[tel_id] = event.simulation->tels[tel_id]->fake_image_parameters.hillas;
-                telescope_pointing[tel_id] = SphericalRepresentation(event.pointing->tels[tel_id]->azimuth, event.pointing->tels[tel_id]->altitude);
-                telescopes.push_back(tel_id);
+                input.hillas_dicts[tel_id] = event.simulation->tels.at(tel_id)->fake_image_parameters.hillas;
+                input.telescope_pointing[tel_id] = SphericalRepresentation(event.pointing->tels.at(tel_id)->azimuth, event.pointing->tels.at(tel_id)->altitude);
+                input.telescopes.push_back(tel_id);
             }
         }
-        return;
+        return input;
     }
     for(const auto& [tel_id, dl1]: event.dl1->tels)
     {
         if((*query_)(dl1->image_parameters))
         {
-            hillas_dicts[tel_id] = dl1->image_parameters.hillas;
-            telescope_pointing[tel_id] = SphericalRepresentation(event.pointing->tels[tel_id]->azimuth, event.pointing->tels[tel_id]->altitude);
-            telescopes.push_back(tel_id);
+            input.hillas_dicts[tel_id] = dl1->image_parameters.hillas;
+            input.telescope_pointing[tel_id] = SphericalRepresentation(event.pointing->tels.at(tel_id)->azimuth, event.pointing->tels.at(tel_id)->altitude);
+            input.telescopes.push_back(tel_id);
         }
     }
+    return input;
 }
-std::pair<double, double> GeometryReconstructor::convert_to_sky(double fov_x, double fov_y)
+std::pair<double, double> GeometryReconstructor::convert_to_sky(const TelescopeFrame& nominal_frame, double fov_x, double fov_y)
 {
-    auto rec_direction = SkyDirection(*nominal_frame, fov_x, fov_y).transform_to(AltAzFrame());
+    auto rec_direction = SkyDirection(nominal_frame, fov_x, fov_y).transform_to(AltAzFrame());
     return std::make_pair(rec_direction->azimuth, rec_direction->altitude);
 }
 
-std::pair<double, double> GeometryReconstructor::convert_to_fov(double alt, double az)
+std::pair<double, double> GeometryReconstructor::convert_to_fov(const TelescopeFrame& nominal_frame, double alt, double az)
 {
-    auto camera_position = SkyDirection(AltAzFrame(), az, alt).transform_to(*nominal_frame);
+    auto camera_position = SkyDirection(AltAzFrame(), az, alt).transform_to(nominal_frame);
     return std::make_pair(camera_position->x(), camera_position->y());
 }
 double GeometryReconstructor::compute_angle_separation(double az1, double alt1, double az2, double alt2)
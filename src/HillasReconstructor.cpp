@@ -3,26 +3,27 @@
 #include "Coordinates.hh"
 #include "Utils.hh"
 
-void HillasReconstructor::fill_nominal_hillas_dicts(const std::unordered_map<int, HillasParameter>& hillas_dicts)
+HillasReconstructor::HillasDicts HillasReconstructor::get_nominal_hillas_dicts(const GeometryReconstructionInput& input)
 {
-    nominal_hillas_dicts.clear();
-    for(const auto& [tel_id, hillas]: hillas_dicts)
+    HillasDicts nominal_hillas_dicts;
+    for(const auto& [tel_id, hillas]: input.hillas_dicts)
     {
         HillasParameter nominal_hillas = hillas;
-        auto tel_frame = TelescopeFrame(telescope_pointing[tel_id]);
+        auto tel_frame = TelescopeFrame(input.telescope_pointing.at(tel_id));
         // Point1 is the center of the image
         auto point1 = SkyDirection(tel_frame, hillas.x, hillas.y);
         // Point2 is along the major axis of the hillas ellipse
         auto point2 = SkyDirection(tel_frame, hillas.x + cos(hillas.psi), hillas.y + sin(hillas.psi));
 
-        auto nominal_center = point1.transform_to(AltAzFrame()).transform_to(*nominal_frame);
-        auto nominal_point2 = point2.transform_to(AltAzFrame()).transform_to(*nominal_frame);
+        auto nominal_center = point1.transform_to(AltAzFrame()).transform_to(*input.nominal_frame);
+        auto nominal_point2 = point2.transform_to(AltAzFrame()).transform_to(*input.nominal_frame);
         nominal_hillas.x = nominal_center->x();
         nominal_hillas.y = nominal_center->y();
         nominal_hillas.phi = atan2(nominal_center->y(), nominal_center->x());
         nominal_hillas.psi = atan2(nominal_point2->y() - nominal_center->y(), nominal_point2->x() - nominal_center->x());
         nominal_hillas_dicts[tel_id] = nominal_hillas;
     }
+    return nominal_hillas_dicts;
 }
 
 std::pair<double, double> HillasReconstructor::project_to_ground(Eigen::Vector3d intersection_position, const SkyDirection<AltAzFrame>& direction)
@@ -44,7 +45,7 @@ std::pair<double, double> HillasReconstructor::project_to_ground(Eigen::Vector3d
     return {ground_x, ground_y};
 
 }
-std::vector<std::pair<int, int>> HillasReconstructor::get_tel_pairs()
+std::vector<std::pair<int, int>> HillasReconstructor::get_tel_pairs(const std::vector<int>& telescopes)
 {
     std::vector<std::pair<int, int>> tel_pairs;
     for(size_t i = 0; i < telescopes.size(); i++)
@@ -56,35 +57,35 @@ std::vector<std::pair<int, int>> HillasReconstructor::get_tel_pairs()
     }
     return tel_pairs;
 }
-void HillasReconstructor::operator()(ArrayEvent& event)
+void HillasReconstructor::operator()(ArrayEvent& event) const
 {
-    GeometryReconstructor::operator()(event);
-    if(hillas_dicts.size() < 2)
+    auto input = select_telescopes(event);
+    auto geometry = reconstruct(input);
+    if(geometry.is_valid)
     {
-        // Set dl2 to Is_valid = false
-        geometry.is_valid = false;
-        event.dl2->geometry[this->name()] = geometry;
-        return;
+        geometry.direction_error = compute_angle_separation(event.simulation->shower.az, event.simulation->shower.alt, geometry.az, geometry.alt);
     }
-    reconstruct(hillas_dicts);
-    geometry.direction_error = compute_angle_separation(event.simulation->shower.az, event.simulation->shower.alt, geometry.az, geometry.alt);
-    event.dl2->geometry[this->name()] = geometry;
+    event.dl2->add_geometry(this->name(), geometry);
 }
-bool HillasReconstructor::reconstruct(const std::unordered_map<int, HillasParameter>& hillas_dicts)
+ReconstructedGeometry HillasReconstructor::reconstruct(const GeometryReconstructionInput& input) const
 {
-    if(hillas_dicts.size() < 2)
+    ReconstructedGeometry geometry{};
+    if(input.hillas_dicts.size() < 2)
     {
-        return false;
+        geometry.is_valid = false;
+        return geometry;
     }
-    tilted_frame = std::make_unique<TiltedGroundFrame>(array_pointing_direction);
-    fill_nominal_hillas_dicts(hillas_dicts);
-    auto [fov_x, fov_y, sigma_x, sigma_y] = reconstruction_nominal_intersection();
-    auto [rec_az, rec_alt] = convert_to_sky(fov_x, fov_y);
-    auto [tilted_x, tilted_y, tilted_sigma_x, tilted_sigma_y] = reconstruction_tilted_intersection();
+    const auto& telescopes = input.telescopes;
+    auto tilted_frame = TiltedGroundFrame(input.array_pointing_direction);
+    auto nominal_hillas_dicts = get_nominal_hillas_dicts(input);
+    auto [fov_x, fov_y, sigma_x, sigma_y] = reconstruction_nominal_intersection(telescopes, nominal_hillas_dicts);
+    auto [rec_az, rec_alt] = convert_to_sky(*input.nominal_frame, fov_x, fov_y);
+    auto [tilted_x, tilted_y, tilted_sigma_x, tilted_sigma_y] = reconstruction_tilted_intersection(telescopes, nominal_hillas_dicts, tilted_frame);
     auto tilted_core_position = CartesianPoint(tilted_x, tilted_y, 0);
-    auto intersection_position = tilted_core_position.transform_to_ground(*tilted_frame);
-    auto [core_x, core_y] = project_to_ground(intersection_position, SkyDirection(AltAzFrame(), array_pointing_direction.azimuth, array_pointing_direction.altitude));
+    auto intersection_position = tilted_core_position.transform_to_ground(tilted_frame);
+    auto [core_x, core_y] = project_to_ground(intersection_position, SkyDirection(AltAzFrame(), input.array_pointing_direction.azimuth, input.array_pointing_direction.altitude));
 
+    std::unordered_map<int, double> impact_parameters;
     for(const auto tel_id: telescopes)
     {
         auto tel_coord = subarray.tel_positions.at(tel_id);
@@ -98,7 +99,7 @@ bool HillasReconstructor::reconstruct(const std::unordered_map<int, HillasParame
     geometry.alt_uncertainty = sigma_x;
     geometry.az_uncertainty = sigma_y;
 
-    geometry.hmax = reconstruction_hmax(fov_x, fov_y,rec_alt);
+    geometry.hmax = reconstruction_hmax(input, nominal_hillas_dicts, impact_parameters, fov_x, fov_y, rec_alt);
     geometry.core_x = core_x;
     geometry.core_y = core_y;
     geometry.tilted_core_x = tilted_x;
@@ -106,19 +107,19 @@ bool HillasReconstructor::reconstruct(const std::unordered_map<int, HillasParame
     geometry.tilted_core_uncertainty_x = tilted_sigma_x;
     geometry.tilted_core_uncertainty_y = tilted_sigma_y;
     geometry.telescopes = telescopes;
-    return true;
+    return geometry;
 }
 
-std::tuple<double, double, double, double> HillasReconstructor::reconstruction_nominal_intersection()
+std::tuple<double, double, double, double> HillasReconstructor::reconstruction_nominal_intersection(const std::vector<int>& telescopes, const HillasDicts& nominal_hillas_dicts)
 {
-    auto tel_pairs = get_tel_pairs();
+    auto tel_pairs = get_tel_pairs(telescopes);
     std::vector<double> intersection_x;
     std::vector<double> intersection_y;
     std::vector<double> weight;
     for(const auto& [tel_id1, tel_id2]: tel_pairs)
     {
-        auto hillas1 = nominal_hillas_dicts[tel_id1];
-        auto hillas2 = nominal_hillas_dicts[tel_id2];
+        const auto& hillas1 = nominal_hillas_dicts.at(tel_id1);
+        const auto& hillas2 = nominal_hillas_dicts.at(tel_id2);
         auto line1 = Line2D({hillas1.x, hillas1.y}, {cos(hillas1.psi), sin(hillas1.psi)});
         auto line2 = Line2D({hillas2.x, hillas2.y}, {cos(hillas2.psi), sin(hillas2.psi)});
         auto intersection = line1.intersection(line2);
@@ -143,28 +144,28 @@ std::tuple<double, double, double, double> HillasReconstructor::reconstruction_n
     return std::make_tuple(mean_x, mean_y, sigma_x, sigma_y);
 }
 
-std::unordered_map<int, Point2D> HillasReconstructor::get_tiled_tel_position()
+std::unordered_map<int, Point2D> HillasReconstructor::get_tiled_tel_position(const std::vector<int>& telescopes, const TiltedGroundFrame& tilted_frame) const
 {
     std::unordered_map<int, Point2D> tiled_tel_positions;
     for(const auto tel_id: telescopes)
     {
         auto tel_pos = CartesianPoint(subarray.tel_positions.at(tel_id));
-        auto tilted_tel_pos = tel_pos.transform_to_tilted(*tilted_frame);
+        auto tilted_tel_pos = tel_pos.transform_to_tilted(tilted_frame);
         tiled_tel_positions.emplace(tel_id, Point2D(tilted_tel_pos.x(), tilted_tel_pos.y()));
     }
     return tiled_tel_positions;
 }
-std::tuple<double, double, double, double> HillasReconstructor::reconstruction_tilted_intersection()
+std::tuple<double, double, double, double> HillasReconstructor::reconstruction_tilted_intersection(const std::vector<int>& telescopes, const HillasDicts& nominal_hillas_dicts, const TiltedGroundFrame& tilted_frame) const
 {
-    auto tel_pairs = get_tel_pairs();
-    auto tilted_tel_positions = get_tiled_tel_position();
+    auto tel_pairs = get_tel_pairs(telescopes);
+    auto tilted_tel_positions = get_tiled_tel_position(telescopes, tilted_frame);
     std::vector<double> intersection_x;
     std::vector<double> intersection_y;
     std::vector<double> weight;
     for(const auto& [tel_id1, tel_id2]: tel_pairs)
     {
-        auto hillas1 = nominal_hillas_dicts[tel_id1];
-        auto hillas2 = nominal_hillas_dicts[tel_id2];
+        const auto& hillas1 = nominal_hillas_dicts.at(tel_id1);
+        const auto& hillas2 = nominal_hillas_dicts.at(tel_id2);
         auto line1 = Line2D({tilted_tel_positions.at(tel_id1), {cos(hillas1.psi), sin(hillas1.psi)}});
         auto line2 = Line2D({tilted_tel_positions.at(tel_id2), {cos(hillas2.psi), sin(hillas2.psi)}});
         auto intersection = line1.intersection(line2);
@@ -193,19 +194,20 @@ double HillasReconstructor::knonrad_weight(double reduced_amplitude, double delt
     return reduced_amplitude * delta_1 * delta_2 * pow(sin_part, 2);
 }
 
-double HillasReconstructor::reconstruction_hmax(double fov_x, double fov_y,double altitude)
+double HillasReconstructor::reconstruction_hmax(const GeometryReconstructionInput& input, const HillasDicts& nominal_hillas_dicts, const std::unordered_map<int, double>& impact_parameters, double fov_x, double fov_y, double altitude)
 {
-    
+    const auto& telescopes = input.telescopes;
     Eigen::VectorXd hmax_v = Eigen::VectorXd::Zero(telescopes.size());
     Eigen::VectorXd weights = Eigen::VectorXd::Zero(telescopes.size());
     for(int i = 0; i < telescopes.size(); i++)
     {
         int tel_id = telescopes[i];
-        double r = sqrt(pow(fov_x - hillas_dicts[tel_id].x, 2) + pow(fov_y - hillas_dicts[tel_id].y, 2));
-        auto impact_parameter = impact_parameters[tel_id];
+        const auto& hillas = input.hillas_dicts.at(tel_id);
+        double r = sqrt(pow(fov_x - hillas.x, 2) + pow(fov_y - hillas.y, 2));
+        auto impact_parameter = impact_parameters.at(tel_id);
         auto hmax_estimate = impact_parameter/r;
         hmax_v(i) = hmax_estimate;
-        weights(i) = nominal_hillas_dicts[tel_id].intensity;
+        weights(i) = nominal_hillas_dicts.at(tel_id).intensity;
     }
     double hmax = hmax_v.dot(weights) / weights.sum() * sin(altitude) + 4400;
     if(hmax > 100000)
@@ -1,5 +1,9 @@
 #include "ImageCleaner.hh"
 #include "spdlog/spdlog.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
 json TailcutsCleaner::default_config() const
 {
     return get_default_config();
@@ -11,7 +15,8 @@ json TailcutsCleaner::get_default_config()
         "picture_thresh": 10,
         "boundary_thresh": 5,
         "keep_isolated_pixels": false,
-        "min_number_picture_neighbors": 2
+        "min_number_picture_neighbors": 2,
+        "picture_neighbor_passes": 1
     }
     )");
 }
@@ -28,40 +33,130 @@ void TailcutsCleaner::configure(const json& config)
         boundary_thresh = cfg.at("boundary_thresh"); 
         keep_isolated_pixels = cfg.at("keep_isolated_pixels");
         min_number_picture_neighbors = cfg.at("min_number_picture_neighbors");
+        picture_neighbor_passes = cfg.at("picture_neighbor_passes");
+        if(picture_neighbor_passes < 0)
+        {
+            throw std::invalid_argument("picture_neighbor_passes must not be negative");
+        }
     }
     catch(const std::exception& e) {
         throw std::runtime_error("Error configuring TailcutsCleaner: " + std::string(e.what()));
     }
 }
 
-Eigen::Vector<bool, -1> TailcutsCleaner::operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const
+PixelMask TailcutsCleaner::operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image) const
+{
+    return tailcuts_clean(camera_geometry, image, picture_thresh, boundary_thresh, keep_isolated_pixels, min_number_picture_neighbors, picture_neighbor_passes);
+}
+void TailcutsCleaner::operator()(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, PixelMask& mask) const
+{
+    tailcuts_clean(camera_geometry, image, mask, picture_thresh, boundary_thresh, keep_isolated_pixels, min_number_picture_neighbors, picture_neighbor_passes);
+}
+
+namespace {
+// Whether any neighbor of the pixel is set in flags
+inline bool any_neighbor(const CameraGeometry& camera_geometry, const uint8_t* flags, int pixel)
 {
-    return tailcuts_clean(camera_geometry, image, picture_thresh, boundary_thresh, keep_isolated_pixels, min_number_picture_neighbors);
+    const int16_t* neighbor = camera_geometry.neighbor_indices.data() + camera_geometry.neighbor_offsets[pixel];
+    const int16_t* last = camera_geometry.neighbor_indices.data() + camera_geometry.neighbor_offsets[pixel + 1];
+    for(; neighbor != last; ++neighbor)
+    {
+        if(flags[*neighbor])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+// Whether at least min_count neighbors of the pixel are set in flags
+inline bool enough_neighbors(const CameraGeometry& camera_geometry, const uint8_t* flags, int pixel, int min_count)
+{
+    const int16_t* neighbor = camera_geometry.neighbor_indices.data() + camera_geometry.neighbor_offsets[pixel];
+    const int16_t* last = camera_geometry.neighbor_indices.data() + camera_geometry.neighbor_offsets[pixel + 1];
+    int count = 0;
+    for(; neighbor != last; ++neighbor)
+    {
+        count += flags[*neighbor];
+        if(count >= min_count)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 }
 
-Eigen::Vector<bool, -1> TailcutsCleaner::tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors)
+PixelMask TailcutsCleaner::tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors, int picture_neighbor_passes)
 {
-    Eigen::Vector<bool, -1> pixel_above_picture = (image.array() >= picture_thresh);
-    Eigen::Vector<bool, -1> pixel_in_picture;
-    if(keep_isolated_pixels or min_number_picture_neighbors == 0)
+    PixelMask mask;
+    tailcuts_clean(camera_geometry, image, mask, picture_thresh, boundary_thresh, keep_isolated_pixels, min_number_picture_neighbors, picture_neighbor_passes);
+    return mask;
+}
+void TailcutsCleaner::tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, PixelMask& mask, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors, int picture_neighbor_passes)
+{
+    const int n_pixels = image.size();
+    if(static_cast<int>(camera_geometry.neighbor_offsets.size()) != n_pixels + 1)
+    {
+        throw std::runtime_error("Image with " + std::to_string(n_pixels) + " pixels does not match the neighbor lists of camera " + camera_geometry.camera_name);
+    }
+    mask.assign(n_pixels);
+    // Byte flags per pixel, reused by the calls on the same thread
+    thread_local std::vector<uint8_t> above_picture, in_picture, next_picture, above_boundary;
+    above_picture.resize(n_pixels);
+    int n_above_picture = 0;
+    for(int i = 0; i < n_pixels; i++)
+    {
+        above_picture[i] = image[i] >= picture_thresh;
+        n_above_picture += above_picture[i];
+    }
+    // Without picture pixels there is neither a picture nor a boundary
+    if(n_above_picture == 0)
     {
-        pixel_in_picture = pixel_above_picture;
+        return;
     }
-    else 
+    const uint8_t* picture = above_picture.data();
+    if(!keep_isolated_pixels && min_number_picture_neighbors > 0)
     {
-        Eigen::VectorXi num_neighbors_above_picture = camera_geometry.neigh_matrix * pixel_above_picture.cast<int>();
-        Eigen::Vector<bool, -1> have_enough_neighbors = (num_neighbors_above_picture.array() >= min_number_picture_neighbors);
-        pixel_in_picture = (pixel_above_picture.array() && have_enough_neighbors.array()).matrix();
+        // Each pass counts the neighbors among the picture pixels kept by the previous one
+        int n_picture = n_above_picture;
+        for(int pass = 0; pass < picture_neighbor_passes; pass++)
+        {
+            auto& kept = (pass % 2 == 0) ? in_picture : next_picture;
+            kept.assign(n_pixels, 0);
+            int n_kept = 0;
+            for(int i = 0; i < n_pixels; i++)
+            {
+                if(picture[i] && enough_neighbors(camera_geometry, picture, i, min_number_picture_neighbors))
+                {
+                    kept[i] = 1;
+                    n_kept++;
+                }
+            }
+            if(n_kept == 0)
+            {
+                return;
+            }
+            picture = kept.data();
+            // Nothing was removed, so the next passes would not remove anything either
+            if(n_kept == n_picture)
+            {
+                break;
+            }
+            n_picture = n_kept;
+        }
     }
-    Eigen::Vector<bool, -1> pixel_above_boundary = (image.array() >= boundary_thresh);
-    Eigen::Vector<bool, -1> pixel_with_picture_neighbors = (camera_geometry.neigh_matrix * pixel_in_picture.cast<int>()).array() > 0;
-    if(keep_isolated_pixels)
+    above_boundary.resize(n_pixels);
+    for(int i = 0; i < n_pixels; i++)
     {
-        return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || pixel_in_picture.array();
+        above_boundary[i] = image[i] >= boundary_thresh;
     }
-    else 
+    for(int i = 0; i < n_pixels; i++)
     {
-        Eigen::Vector<bool, -1> pixel_with_boundary_neighbors = (camera_geometry.neigh_matrix * pixel_above_boundary.cast<int>()).array() > 0;
-        return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || (pixel_in_picture.array() && pixel_with_boundary_neighbors.array());
+        // Picture pixels are kept if isolated ones are allowed or they have a boundary neighbor
+        bool keep = picture[i] && (keep_isolated_pixels || any_neighbor(camera_geometry, above_boundary.data(), i));
+        if(keep || (above_boundary[i] && any_neighbor(camera_geometry, picture, i)))
+        {
+            mask.set(i);
+        }
     }
-}
\ No newline at end of file
+}
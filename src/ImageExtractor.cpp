@@ -1,5 +1,11 @@
 #include "ImageExtractor.hh"
+#include "R1Calibration.hh"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 ImageExtractor::ImageExtractor(const SubarrayDescription& subarray):
     subarray(subarray)
 {
@@ -25,16 +31,24 @@ Eigen::VectorXd ImageExtractor::compute_integration_correction(const Eigen::Matr
         int n_sampled_edges = static_cast<int>(std::ceil(max_pulse_time / sample_width_ns)) + 1;
         Eigen::VectorXd sampled_edges = Eigen::VectorXd::LinSpaced(n_sampled_edges, 0, max_pulse_time);
 
-        // Simulate histogram using manual binning
-        Eigen::VectorXd sampled_pulse = Eigen::VectorXd::Zero(n_sampled_edges - 1);
+        // Simulate histogram using manual binning. The edges are evenly spaced, the bin of a time is guessed from
+        // its value and moved to the edges around it, so the bins are the ones a search over all the edges finds
+        int n_bins = n_sampled_edges - 1;
+        Eigen::VectorXd sampled_pulse = Eigen::VectorXd::Zero(n_bins);
+        double bin_width = n_bins > 0 ? sampled_edges(n_bins) / n_bins : 0.0;
         for (int i = 0; i < pulse.size(); ++i) {
             double time = pulse_shape_x(i);
-            for (int j = 0; j < n_sampled_edges - 1; ++j) {
-                if (time >= sampled_edges(j) && time < sampled_edges(j + 1)) {
-                    sampled_pulse(j) += pulse(i);
-                    break;
-                }
+            if (n_bins <= 0 || time < sampled_edges(0) || time >= sampled_edges(n_bins)) {
+                continue;
+            }
+            int j = std::clamp(static_cast<int>(time / bin_width), 0, n_bins - 1);
+            while (time < sampled_edges(j)) {
+                --j;
+            }
+            while (time >= sampled_edges(j + 1)) {
+                ++j;
             }
+            sampled_pulse(j) += pulse(i);
         }
         
         // Normalize to get density
@@ -77,40 +91,268 @@ FullWaveFormExtractor::FullWaveFormExtractor(const SubarrayDescription& subarray
 {
 }
 
-std::pair<Eigen::VectorXd, Eigen::VectorXd>  extract_around_peak(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform, const Eigen::VectorXi& peak_index, const Eigen::VectorXi& window_width, const Eigen::VectorXi& window_shift, double sampling_rate_ghz)
+namespace {
+// Pixels extracted together: the samples of a tile are transposed to sample major order, so every loop over
+// the pixels of a tile reads contiguous values without a dependency between iterations and the prefix sums stay in L1
+constexpr int pixel_tile = 16;
+struct PrefixScratch
+{
+    // samples[s * pixel_tile + k] is sample s of the k-th pixel of the tile, zero past the last pixel
+    std::vector<float> samples;
+    // charge[s * pixel_tile + k] is the sum of the samples before s of the k-th pixel of the tile
+    std::vector<double> charge;
+    // Same for the positive samples weighted by their index
+    std::vector<double> weighted_time;
+};
+thread_local PrefixScratch prefix_scratch;
+
+/**
+ * @brief One pass over the samples of the pixels [first_pixel, first_pixel + n_tile_pixels). With search_peak the
+ *        index of the first maximum of each pixel is written to peak_index, with prefix_sums the prefix sums of the
+ *        tile are filled
+ */
+template<bool search_peak, bool prefix_sums>
+void scan_tile(const R1WaveformMatrix& waveform, int first_pixel, int n_tile_pixels, int* peak_index)
+{
+    const int n_samples = waveform.cols();
+    auto& scratch = prefix_scratch;
+    const size_t prefix_size = static_cast<size_t>(n_samples + 1) * pixel_tile;
+    if(scratch.charge.size() < prefix_size)
+    {
+        scratch.samples.resize(prefix_size);
+        scratch.charge.resize(prefix_size);
+        scratch.weighted_time.resize(prefix_size);
+    }
+    float* samples = scratch.samples.data();
+    double* charge_prefix = scratch.charge.data();
+    double* time_prefix = scratch.weighted_time.data();
+    for(int k = 0; k < n_tile_pixels; k++)
+    {
+        const float* row = waveform.data() + static_cast<Eigen::Index>(first_pixel + k) * n_samples;
+        for(int isample = 0; isample < n_samples; isample++)
+        {
+            samples[isample * pixel_tile + k] = row[isample];
+        }
+    }
+    for(int k = n_tile_pixels; k < pixel_tile; k++)
+    {
+        for(int isample = 0; isample < n_samples; isample++)
+        {
+            samples[isample * pixel_tile + k] = 0.0f;
+        }
+    }
+    float peak_value[pixel_tile];
+    int peak_sample[pixel_tile];
+    // Running sums kept in local arrays, the compiler holds them in registers instead of reloading the last prefix
+    double run_charge[pixel_tile];
+    double run_time[pixel_tile];
+    for(int k = 0; k < pixel_tile; k++)
+    {
+        charge_prefix[k] = 0;
+        time_prefix[k] = 0;
+        run_charge[k] = 0;
+        run_time[k] = 0;
+        peak_value[k] = n_samples > 0 ? samples[k] : 0.0f;
+        peak_sample[k] = 0;
+    }
+    for(int isample = 0; isample < n_samples; isample++)
+    {
+        const float* values = samples + isample * pixel_tile;
+        if constexpr(prefix_sums)
+        {
+            double* charge_after = charge_prefix + (isample + 1) * pixel_tile;
+            double* time_after = time_prefix + (isample + 1) * pixel_tile;
+            const double weight = isample;
+            for(int k = 0; k < pixel_tile; k++)
+            {
+                const double value = values[k];
+                run_charge[k] += value;
+                // Written as a max instead of a branch on the sign so the loop stays vectorized
+                run_time[k] += weight * std::max(value, 0.0);
+                charge_after[k] = run_charge[k];
+                time_after[k] = run_time[k];
+            }
+        }
+        if constexpr(search_peak)
+        {
+            for(int k = 0; k < pixel_tile; k++)
+            {
+                // Strictly greater keeps the first maximum, as maxCoeff does
+                peak_sample[k] = values[k] > peak_value[k] ? isample : peak_sample[k];
+                peak_value[k] = std::max(peak_value[k], values[k]);
+            }
+        }
+    }
+    if constexpr(search_peak)
+    {
+        std::copy_n(peak_sample, n_tile_pixels, peak_index);
+    }
+}
+/**
+ * @brief Charge and peak time of the pixels of a tile from the differences of the prefix sums at the window edges
+ */
+void tile_window_sums(int n_samples, int first_pixel, int n_tile_pixels, const int* peak_index, const int* window_width, const int* window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time)
+{
+    const double* charge_prefix = prefix_scratch.charge.data();
+    const double* time_prefix = prefix_scratch.weighted_time.data();
+    for(int k = 0; k < n_tile_pixels; k++)
+    {
+        const int window_start = peak_index[k] - window_shift[k];
+        const int start = std::clamp(window_start, 0, n_samples);
+        const int end = std::clamp(window_start + window_width[k], start, n_samples);
+        const double window_charge = charge_prefix[end * pixel_tile + k] - charge_prefix[start * pixel_tile + k];
+        const double time_sum = time_prefix[end * pixel_tile + k] - time_prefix[start * pixel_tile + k];
+        charge(first_pixel + k) = window_charge;
+        peak_time(first_pixel + k) = time_sum / window_charge / sampling_rate_ghz;
+    }
+}
+/**
+ * @brief Same as tile_window_sums, summing the window samples of each pixel directly from its row
+ */
+void tile_window_sums(const R1WaveformMatrix& waveform, int first_pixel, int n_tile_pixels, const int* peak_index, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time)
+{
+    const int n_samples = waveform.cols();
+    for(int k = 0; k < n_tile_pixels; k++)
+    {
+        const float* row = waveform.data() + static_cast<Eigen::Index>(first_pixel + k) * n_samples;
+        const int window_start = peak_index[k] - window_shift;
+        const int start = std::clamp(window_start, 0, n_samples);
+        const int end = std::clamp(window_start + window_width, start, n_samples);
+        double window_charge = 0;
+        double time_sum = 0;
+        for(int isample = start; isample < end; isample++)
+        {
+            const double value = row[isample];
+            window_charge += value;
+            time_sum += isample * std::max(value, 0.0);
+        }
+        charge(first_pixel + k) = window_charge;
+        peak_time(first_pixel + k) = time_sum / window_charge / sampling_rate_ghz;
+    }
+}
+}
+
+std::pair<Eigen::VectorXd, Eigen::VectorXd>  extract_around_peak(const R1WaveformMatrix& waveform, const Eigen::VectorXi& peak_index, const Eigen::VectorXi& window_width, const Eigen::VectorXi& window_shift, double sampling_rate_ghz)
 {
-    auto window_start = peak_index.array() - window_shift.array();
-    auto window_end = window_start.array() + window_width.array();
     int n_pixels = waveform.rows();
     Eigen::VectorXd charge = Eigen::VectorXd::Zero(n_pixels);
     Eigen::VectorXd peak_time = Eigen::VectorXd::Zero(n_pixels);
+    for(int first_pixel = 0; first_pixel < n_pixels; first_pixel += pixel_tile)
+    {
+        const int n_tile_pixels = std::min(pixel_tile, n_pixels - first_pixel);
+        scan_tile<false, true>(waveform, first_pixel, n_tile_pixels, nullptr);
+        tile_window_sums(waveform.cols(), first_pixel, n_tile_pixels, peak_index.data() + first_pixel, window_width.data() + first_pixel, window_shift.data() + first_pixel, sampling_rate_ghz, charge, peak_time);
+    }
+    return std::make_pair(charge, peak_time);
+}
+
+std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_around_local_peak(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz)
+{
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> extracted;
+    extract_around_local_peak(waveform, window_width, window_shift, sampling_rate_ghz, extracted.first, extracted.second);
+    return extracted;
+}
+
+void extract_around_local_peak(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time)
+{
+    int n_pixels = waveform.rows();
+    int n_samples = waveform.cols();
+    // Every pixel is written below
+    charge.resize(n_pixels);
+    peak_time.resize(n_pixels);
+    int peak_index[pixel_tile];
+    int tile_window_width[pixel_tile];
+    int tile_window_shift[pixel_tile];
+    std::fill_n(tile_window_width, pixel_tile, window_width);
+    std::fill_n(tile_window_shift, pixel_tile, window_shift);
+    // The prefix sums cost two double additions per sample whatever the window, summing the window directly is
+    // cheaper up to about a quarter of the readout (bench_image_extractor)
+    const bool narrow_window = 4 * window_width < n_samples;
+    for(int first_pixel = 0; first_pixel < n_pixels; first_pixel += pixel_tile)
+    {
+        const int n_tile_pixels = std::min(pixel_tile, n_pixels - first_pixel);
+        if(narrow_window)
+        {
+            scan_tile<true, false>(waveform, first_pixel, n_tile_pixels, peak_index);
+            tile_window_sums(waveform, first_pixel, n_tile_pixels, peak_index, window_width, window_shift, sampling_rate_ghz, charge, peak_time);
+        }
+        else
+        {
+            scan_tile<true, true>(waveform, first_pixel, n_tile_pixels, peak_index);
+            tile_window_sums(n_samples, first_pixel, n_tile_pixels, peak_index, tile_window_width, tile_window_shift, sampling_rate_ghz, charge, peak_time);
+        }
+    }
+}
+
+std::pair<Eigen::VectorXd, Eigen::VectorXd> extract_around_peak_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int window_width, int window_shift, double sampling_rate_ghz)
+{
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> extracted;
+    extract_around_peak_r0(waveform, gain_selection, monitor, window_width, window_shift, sampling_rate_ghz, extracted.first, extracted.second);
+    return extracted;
+}
 
-    // For each pixel, sum the waveform values within the window
+void extract_around_peak_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time)
+{
+    int n_pixels = waveform[0].rows();
+    int n_samples = waveform[0].cols();
+    // Every pixel is written below
+    charge.resize(n_pixels);
+    peak_time.resize(n_pixels);
     for(int ipix = 0; ipix < n_pixels; ipix++) {
-        int start = std::max(0, window_start(ipix));
-        int end = std::min((int)waveform.cols(), window_end(ipix));
-        
-        // Sum the waveform values in the window
-        charge(ipix) = waveform.block(ipix, start, 1, end - start).sum();
-        
-        // Calculate weighted time average
-        double time_sum = 0;
+        int gain = gain_selection(ipix);
+        const uint16_t* adc = waveform[gain].data() + static_cast<Eigen::Index>(ipix) * n_samples;
+        double pedestal = monitor.pedestal_per_sample(gain, ipix);
+        double dc_to_pe = monitor.dc_to_pe(gain, ipix);
+
+        int peak_index = 0;
+        for(int i = 1; i < n_samples; i++) {
+            if(adc[i] > adc[peak_index]) {
+                peak_index = i;
+            }
+        }
+        int start = std::max(0, peak_index - window_shift);
+        int end = std::min(n_samples, peak_index - window_shift + window_width);
+
+        // A calibrated sample is positive if its ADC count is above the pedestal
+        int64_t positive_threshold = static_cast<int64_t>(std::floor(pedestal));
+        int64_t adc_sum = 0;
+        int64_t positive_weighted_sum = 0;
+        int64_t positive_index_sum = 0;
         for(int i = start; i < end; i++) {
-            if(waveform(ipix, i) > 0) {
-                time_sum += i * waveform(ipix, i);
+            adc_sum += adc[i];
+            if(adc[i] > positive_threshold) {
+                positive_weighted_sum += static_cast<int64_t>(i) * adc[i];
+                positive_index_sum += i;
             }
         }
+        charge(ipix) = (adc_sum - (end - start) * pedestal) * dc_to_pe;
+        double time_sum = (positive_weighted_sum - positive_index_sum * pedestal) * dc_to_pe;
         peak_time(ipix) = time_sum / charge(ipix) / sampling_rate_ghz;
     }
-
-    return std::make_pair(charge, peak_time);
 }
-
-Eigen::VectorXi ImageExtractor::get_peak_index(const Eigen::Matrix<double, -1, -1, Eigen::RowMajor>& waveform)
+std::pair<Eigen::VectorXd, Eigen::VectorXd> ImageExtractor::extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id) const
+{
+    R1WaveformMatrix r1_waveform;
+    R1Calibration::calibrate(waveform, gain_selection, monitor, r1_waveform);
+    return (*this)(r1_waveform, gain_selection, tel_id);
+}
+void ImageExtractor::extract(const R1WaveformMatrix& waveform, const Eigen::VectorXi& gain_selection, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const
+{
+    auto extracted = (*this)(waveform, gain_selection, tel_id);
+    charge = std::move(extracted.first);
+    peak_time = std::move(extracted.second);
+}
+void ImageExtractor::extract_r0(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, int tel_id, Eigen::VectorXd& charge, Eigen::VectorXd& peak_time) const
+{
+    auto extracted = extract_r0(waveform, gain_selection, monitor, tel_id);
+    charge = std::move(extracted.first);
+    peak_time = std::move(extracted.second);
+}
+Eigen::VectorXi ImageExtractor::get_peak_index(const R1WaveformMatrix& waveform)
 {
     Eigen::VectorXi peak_index = Eigen::VectorXi::Zero(waveform.rows());
     for(int ipix = 0; ipix < waveform.rows(); ipix++) {
-        Eigen::MatrixXd::Index maxIndex;
+        Eigen::Index maxIndex;
         waveform.row(ipix).maxCoeff(&maxIndex);
         peak_index(ipix) = maxIndex;
     }
@@ -134,27 +376,61 @@ void LocalPeakExtractor::configure(const json& config)
         window_width = cfg["window_width"];
         window_shift = cfg["window_shift"];
         apply_correction = cfg["apply_correction"];
+        integration_corrections.clear();
+        correction_index.clear();
+        if(apply_correction)
+        {
+            // The correction only depends on the readout of the camera, it is computed once for each distinct readout
+            std::vector<const CameraReadout*> correction_readouts;
+            for(const auto& [tel_id, tel_config]: subarray.tels)
+            {
+                const auto& readout = tel_config.camera_description.camera_readout;
+                auto same_readout = [&readout](const CameraReadout* other) {
+                    return other->camera_name == readout.camera_name
+                        && other->sampling_rate == readout.sampling_rate
+                        && other->reference_pulse_sample_width == readout.reference_pulse_sample_width
+                        && other->reference_pulse_shape.rows() == readout.reference_pulse_shape.rows()
+                        && other->reference_pulse_shape.cols() == readout.reference_pulse_shape.cols()
+                        && other->reference_pulse_shape == readout.reference_pulse_shape;
+                };
+                auto it = std::find_if(correction_readouts.begin(), correction_readouts.end(), same_readout);
+                int index = static_cast<int>(it - correction_readouts.begin());
+                if(it == correction_readouts.end())
+                {
+                    correction_readouts.push_back(&readout);
+                    integration_corrections.push_back(compute_integration_correction(
+                        readout.reference_pulse_shape,
+                        readout.reference_pulse_sample_width,
+                        1/sampling_rate_ghz.at(tel_id),
+                        window_width,
+                        window_shift
+                    ));
+                }
+                if(tel_id >= static_cast<int>(correction_index.size()))
+                {
+                    correction_index.resize(tel_id + 1, -1);
+                }
+                correction_index[tel_id] = index;
+            }
+        }
     }
     catch(const std::exception& e) {
         throw std::runtime_error("Error configuring LocalPeakExtractor: " + std::string(e.what()));
     }
 }
-void LocalPeakExtractor::correction(Eigen::VectorXd& charge, const Eigen::VectorXi& gain_selection, const CameraReadout& readout, double sampling_rate_ghz)
+const Eigen::VectorXd& LocalPeakExtractor::get_integration_correction(int tel_id) const
 {
-    if(!this->cached_correction.has_value())
+    if(tel_id < 0 || tel_id >= static_cast<int>(correction_index.size()) || correction_index[tel_id] < 0)
     {
-        Eigen::VectorXd correction = this->compute_integration_correction(
-            readout.reference_pulse_shape,
-            readout.reference_pulse_sample_width,
-            1/sampling_rate_ghz,
-            this->window_width,
-            this->window_shift
-        );
-        this->cached_correction = std::move(correction);
+        throw std::out_of_range("No integration correction for telescope " + std::to_string(tel_id));
     }
-    
+    return integration_corrections[correction_index[tel_id]];
+}
+void LocalPeakExtractor::correction(Eigen::VectorXd& charge, const Eigen::VectorXi& gain_selection, int tel_id) const
+{
+    const auto& correction = get_integration_correction(tel_id);
     for(int ipix = 0; ipix < charge.size(); ipix++)
     {
-        charge(ipix) = charge(ipix) * (*this->cached_correction)[gain_selection[ipix]];
+        charge(ipix) = charge(ipix) * correction[gain_selection[ipix]];
     }
 }
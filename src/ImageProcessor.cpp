@@ -4,39 +4,16 @@
 #include "Eigen/Dense"
 #include "Eigen/src/Core/Matrix.h"
 #include "ImageParameters.hh"
+#include "ThreadPool.hh"
 #include "spdlog/spdlog.h"
-#include <queue>
+#include <algorithm>
 #include <iostream>
-#include <random>
+#include <limits>
+#include <stdexcept>
 
-std::random_device rd;
-std::mt19937 gen(rd());
-
-Eigen::Vector<bool, -1> ImageProcessor::tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors)
+PixelMask ImageProcessor::tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors, int picture_neighbor_passes)
 {
-    Eigen::Vector<bool, -1> pixel_above_picture = (image.array() >= picture_thresh);
-    Eigen::Vector<bool, -1> pixel_in_picture;
-    if(keep_isolated_pixels or min_number_picture_neighbors == 0)
-    {
-        pixel_in_picture = pixel_above_picture;
-    }
-    else 
-    {
-        Eigen::VectorXi num_neighbors_above_picture = camera_geometry.neigh_matrix * pixel_above_picture.cast<int>();
-        Eigen::Vector<bool, -1> have_enough_neighbors = (num_neighbors_above_picture.array() >= min_number_picture_neighbors);
-        pixel_in_picture = (pixel_above_picture.array() && have_enough_neighbors.array()).matrix();
-    }
-    Eigen::Vector<bool, -1> pixel_above_boundary = (image.array() >= boundary_thresh);
-    Eigen::Vector<bool, -1> pixel_with_picture_neighbors = (camera_geometry.neigh_matrix * pixel_in_picture.cast<int>()).array() > 0 ;
-    if(keep_isolated_pixels)
-    {
-        return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || pixel_in_picture.array();
-    }
-    else 
-    {
-        Eigen::Vector<bool, -1> pixel_with_boundary_neighbors = (camera_geometry.neigh_matrix * pixel_above_boundary.cast<int>()).array() > 0;
-        return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || (pixel_in_picture.array() && pixel_with_boundary_neighbors.array());
-    }
+    return TailcutsCleaner::tailcuts_clean(camera_geometry, image, picture_thresh, boundary_thresh, keep_isolated_pixels, min_number_picture_neighbors, picture_neighbor_passes);
 }
 void ImageProcessor::configure(const json& config)
 {
@@ -50,107 +27,309 @@ void ImageProcessor::configure(const json& config)
     {
         poisson_noise = config["poisson_noise"];
     }
+    if(poisson_noise > 0)
+    {
+        poisson_sampler = PoissonSampler(poisson_noise);
+    }
+    random_seed = config.value("random_seed", 0u);
+    min_intensity = config.value("min_intensity", 50.0);
+    // The cuts follow the cleaning, the cuts of other cleaners are not known
+    ImagePreScreen cleaning_pre_screen;
+    cleaning_pre_screen.enabled = false;
+    if(auto* tailcuts_cleaner = dynamic_cast<const TailcutsCleaner*>(image_cleaner.get()))
+    {
+        cleaning_pre_screen = ImagePreScreen::from_cleaning(*tailcuts_cleaner, min_intensity);
+    }
+    pre_screen = cleaning_pre_screen;
+    if(config.contains("pre_screen"))
+    {
+        const json& pre_screen_config = config["pre_screen"];
+        pre_screen.enabled = cleaning_pre_screen.enabled && pre_screen_config.value("enabled", true);
+        pre_screen.picture_thresh = pre_screen_config.value("picture_thresh", pre_screen.picture_thresh);
+        pre_screen.boundary_thresh = pre_screen_config.value("boundary_thresh", pre_screen.boundary_thresh);
+        pre_screen.min_picture_pixels = pre_screen_config.value("min_picture_pixels", pre_screen.min_picture_pixels);
+        pre_screen.min_max_charge = pre_screen_config.value("min_max_charge", pre_screen.min_max_charge);
+        pre_screen.min_total_charge = pre_screen_config.value("min_total_charge", pre_screen.min_total_charge);
+        if(pre_screen.enabled && !pre_screen.looser_than(cleaning_pre_screen))
+        {
+            throw std::runtime_error("The pre_screen cuts are tighter than the cleaning and min_intensity, they would reject images the cleaning keeps");
+        }
+    }
+    parallel_telescopes = config.value("parallel_telescopes", false);
+    min_parallel_telescopes = config.value("min_parallel_telescopes", 4);
 
 }
 // First is clean the image , then extractor the parameter
-void ImageProcessor::operator()(ArrayEvent& event)
+void ImageProcessor::operator()(ArrayEvent& event) const
 {
-    if(!event.dl1)
+    event.emplace_level<DL1Event>();
+    // Every telescope gets a DL1 slot with the buffers a recycled event left, so the telescopes can be processed
+    // independently. The slot list is kept by the calling thread from event to event
+    struct TelSlot
     {
-        event.dl1 = DL1Event();
-    }
+        int tel_id;
+        const DL0Camera* dl0_camera;
+        DL1Camera* dl1_camera;
+        ImageRejection rejection;
+    };
+    thread_local std::vector<TelSlot> thread_slots;
+    auto& slots = thread_slots;
+    slots.clear();
     for(const auto& [tel_id, dl0_camera]: event.dl0->tels)
     {
-        DL1Camera dl1_camera;
-        // Mask for the image 
-        auto image_mask = (*image_cleaner)(subarray.tels.at(tel_id).camera_description.camera_geometry, dl0_camera->image);
-        Eigen::VectorXd masked_image = image_mask.select(dl0_camera->image, Eigen::VectorXd::Zero(dl0_camera->image.size()));
-        if(masked_image.sum() < 50)
+        if(event.dl1->reuse_tel(tel_id))
         {
-            continue;
+            slots.push_back({tel_id, dl0_camera, nullptr, ImageRejection::none});
+        }
+    }
+    // Adding a telescope may move the ones added before, so the slots are looked up once all are added
+    for(auto& slot: slots)
+    {
+        slot.dl1_camera = event.dl1->get_tel(slot.tel_id);
+    }
+    auto process_tel = [this, &slots](size_t i) {
+        auto& slot = slots[i];
+        slot.rejection = process_telescope(slot.tel_id, *slot.dl0_camera, *slot.dl1_camera);
+    };
+    if(parallel_telescopes && slots.size() >= min_parallel_telescopes)
+    {
+        ThreadPool::shared().parallel_for(slots.size(), process_tel);
+    }
+    else
+    {
+        for(size_t i = 0; i < slots.size(); i++)
+        {
+            process_tel(i);
+        }
+    }
+    for(const auto& slot: slots)
+    {
+        if(slot.rejection != ImageRejection::none)
+        {
+            // The buffers stay in the slot for the next event
+            event.dl1->release_tel(slot.tel_id);
+            event.dl1->reject_tel(slot.tel_id, slot.rejection);
         }
-        HillasParameter hillas_parameter = ImageProcessor::hillas_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, masked_image);
-        LeakageParameter leakage_parameter = ImageProcessor::leakage_parameter(const_cast<CameraGeometry&>(subarray.tels.at(tel_id).camera_description.camera_geometry), masked_image);
-        ConcentrationParameter concentration_parameter = ImageProcessor::concentration_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, masked_image, hillas_parameter);
-        MorphologyParameter morphology_parameter = ImageProcessor::morphology_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, image_mask);
-        IntensityParameter intensity_parameter = ImageProcessor::intensity_parameter(masked_image);
-        // Tempory image are copyed from dl0_camera
-        Eigen::VectorXf image = dl0_camera->image.cast<float>();
-        Eigen::VectorXf peak_time = dl0_camera->peak_time.cast<float>();
-        Eigen::Vector<bool, -1> mask = std::move(image_mask);
-        event.dl1->add_tel(tel_id, 
-            DL1Camera{ 
-             .image_parameters = ImageParameters{hillas_parameter, leakage_parameter, concentration_parameter, morphology_parameter, intensity_parameter}, 
-             .image = std::move(image), 
-             .peak_time = std::move(peak_time), 
-             .mask = std::move(mask)
-            }
-        );
     }
 
     handle_simulation_level(event);
 
 }
+ImageRejection ImagePreScreen::operator()(const Eigen::VectorXd& image) const
+{
+    if(!enabled)
+    {
+        return ImageRejection::none;
+    }
+    int n_picture_pixels = 0;
+    double max_charge = -std::numeric_limits<double>::infinity();
+    double total_charge = 0;
+    for(Eigen::Index i = 0; i < image.size(); i++)
+    {
+        const double charge = image[i];
+        n_picture_pixels += (charge >= picture_thresh);
+        max_charge = std::max(max_charge, charge);
+        // Only the positive charges, so the sum bounds the intensity of any subset of these pixels
+        total_charge += (charge >= boundary_thresh) ? std::max(charge, 0.0) : 0.0;
+    }
+    if(n_picture_pixels < min_picture_pixels)
+    {
+        return ImageRejection::too_few_picture_pixels;
+    }
+    if(max_charge < min_max_charge)
+    {
+        return ImageRejection::max_charge_too_low;
+    }
+    if(total_charge < min_total_charge)
+    {
+        return ImageRejection::total_charge_too_low;
+    }
+    return ImageRejection::none;
+}
+ImagePreScreen ImagePreScreen::from_cleaning(const TailcutsCleaner& cleaner, double min_intensity)
+{
+    ImagePreScreen pre_screen;
+    pre_screen.enabled = min_intensity > 0;
+    pre_screen.picture_thresh = cleaner.get_picture_thresh();
+    pre_screen.boundary_thresh = std::min(cleaner.get_picture_thresh(), cleaner.get_boundary_thresh());
+    const bool needs_picture_neighbors = !cleaner.get_keep_isolated_pixels() && cleaner.get_min_number_picture_neighbors() > 0 && cleaner.get_picture_neighbor_passes() > 0;
+    pre_screen.min_picture_pixels = needs_picture_neighbors ? cleaner.get_min_number_picture_neighbors() + 1 : 1;
+    pre_screen.min_max_charge = cleaner.get_picture_thresh();
+    pre_screen.min_total_charge = min_intensity;
+    return pre_screen;
+}
+bool ImagePreScreen::looser_than(const ImagePreScreen& other) const
+{
+    return picture_thresh <= other.picture_thresh
+        && boundary_thresh <= other.boundary_thresh
+        && min_picture_pixels <= other.min_picture_pixels
+        && min_max_charge <= other.min_max_charge
+        && min_total_charge <= other.min_total_charge;
+}
+ImageRejection ImageProcessor::process_telescope(int tel_id, const DL0Camera& dl0_camera, DL1Camera& dl1_camera) const
+{
+    ImageRejection rejection = pre_screen(dl0_camera.image);
+    if(rejection != ImageRejection::none)
+    {
+        return rejection;
+    }
+    const auto& camera_geometry = *subarray.tels.at(tel_id).camera_description.camera_geometry;
+    // Only the pixels surviving the cleaning are used for the image parameters
+    image_cleaner->clean(camera_geometry, dl0_camera.image, dl0_camera.peak_time, dl1_camera.mask, dl1_camera.cleaned_image);
+    const auto& cleaned_image = dl1_camera.cleaned_image;
+    if(cleaned_image.sum() < min_intensity)
+    {
+        return ImageRejection::intensity_too_low;
+    }
+    dl1_camera.image_parameters = ImageProcessor::moment_parameters(camera_geometry, cleaned_image);
+    dl1_camera.image_parameters.leakage = ImageProcessor::leakage_parameter(camera_geometry, cleaned_image);
+    dl1_camera.image_parameters.morphology = ImageProcessor::morphology_parameter(camera_geometry, cleaned_image);
+    // Tempory image are copyed from dl0_camera
+    dl1_camera.image = dl0_camera.image.cast<float>();
+    dl1_camera.peak_time = dl0_camera.peak_time.cast<float>();
+    return ImageRejection::none;
+}
 // TODO: Add the unit test for the hillas parameter
 HillasParameter ImageProcessor::hillas_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image)
 {
-    // Use the mask to get the image
-    double intensity = masked_image.sum();
-    Eigen::MatrixXd cov_matrix{2, 2};
-    double x = camera_geometry.get_pix_x_fov().dot(masked_image)/intensity;
-    double y = camera_geometry.get_pix_y_fov().dot(masked_image)/intensity;
-    double r = std::sqrt(x*x + y*y);
-    double phi = std::atan2(y, x);
-    Eigen::VectorXd delta_x = camera_geometry.get_pix_x_fov().array() - x;
-    Eigen::VectorXd delta_y = camera_geometry.get_pix_y_fov().array() - y;
-    cov_matrix(0, 0) = (delta_x.array().square() * masked_image.array()).sum()/(intensity - 1);
-    cov_matrix(1, 1) = (delta_y.array().square() * masked_image.array()).sum()/(intensity - 1);
-    cov_matrix(0, 1) = (delta_x.array() * delta_y.array() * masked_image.array()).sum()/(intensity - 1);
-    cov_matrix(1, 0) = cov_matrix(0, 1);
-    double length,width, psi = 0;
-    double skewness = 0, kurtosis = 0;
-    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(cov_matrix);
-    if(eigensolver.info() != Eigen::Success) {
-        spdlog::warn("Eigenvalue decomposition failed");
-        psi = length = width = skewness = kurtosis = std::numeric_limits<double>::quiet_NaN();
+    // The mask is taken from the pixels with signal
+    Eigen::Vector<bool, -1> image_mask = masked_image.array() != 0;
+    return moment_parameters(camera_geometry, masked_image, PixelMask::from_bools(image_mask)).hillas;
+}
+ImageParameters ImageProcessor::moment_parameters(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, const PixelMask& image_mask)
+{
+    return moment_parameters(camera_geometry, SparseImage::from_mask(image_mask, image));
+}
+ImageParameters ImageProcessor::moment_parameters(const CameraGeometry& camera_geometry, const SparseImage& image)
+{
+    const double* pix_x = camera_geometry.pix_x_fov.size() ? camera_geometry.pix_x_fov.data() : camera_geometry.pix_x.data();
+    const double* pix_y = camera_geometry.pix_y_fov.size() ? camera_geometry.pix_y_fov.data() : camera_geometry.pix_y.data();
+    const int n_kept = image.size();
+    // First pass: raw moments, the maximum and the number of pixels with signal
+    double intensity = 0, sum_x = 0, sum_y = 0, sum_xx = 0, sum_yy = 0, sum_xy = 0;
+    double intensity_max = n_kept < image.n_pixels ? 0 : -std::numeric_limits<double>::infinity();
+    int n_signal = 0;
+    for(int k = 0; k < n_kept; k++)
+    {
+        const int i = image.pixel_id[k];
+        const double w = image.charge[k];
+        const double wx = w * pix_x[i];
+        const double wy = w * pix_y[i];
+        intensity += w;
+        sum_x += wx;
+        sum_y += wy;
+        sum_xx += wx * pix_x[i];
+        sum_yy += wy * pix_y[i];
+        sum_xy += wx * pix_y[i];
+        intensity_max = std::max(intensity_max, w);
+        n_signal += (w != 0);
     }
-    else
+    const double x = sum_x / intensity;
+    const double y = sum_y / intensity;
+    const double cov_xx = (sum_xx - intensity * x * x) / (intensity - 1);
+    const double cov_yy = (sum_yy - intensity * y * y) / (intensity - 1);
+    const double cov_xy = (sum_xy - intensity * x * y) / (intensity - 1);
+    // Closed form eigen decomposition of the 2x2 covariance matrix
+    const double half_trace = 0.5 * (cov_xx + cov_yy);
+    const double root = std::hypot(0.5 * (cov_xx - cov_yy), cov_xy);
+    const double length = std::sqrt(half_trace + root);
+    const double width = std::sqrt(std::max(half_trace - root, 0.0));
+    double psi = 0;
+    if(cov_xy != 0)
     {
-        Eigen::VectorXd eigen_values = eigensolver.eigenvalues();
-        Eigen::MatrixXd eigen_vectors = eigensolver.eigenvectors();
-        length = std::sqrt(eigen_values(1));
-        width = std::sqrt(eigen_values(0));
-        if(eigen_vectors.col(1)[0] != 0)
+        psi = std::atan((half_trace + root - cov_xx) / cov_xy);
+    }
+    else if(cov_yy > cov_xx)
+    {
+        psi = M_PI / 2;
+    }
+    const double cos_psi = std::cos(psi);
+    const double sin_psi = std::sin(psi);
+
+    // Second pass: moments along the major axis, the concentration and the spread of the pixel intensities
+    const double intensity_mean = intensity / n_signal;
+    const double cog_radius2 = camera_geometry.pix_width_fov.size() ? camera_geometry.pix_width_fov[0] * camera_geometry.pix_width_fov[0] : 0;
+    const double length2 = length * length;
+    const double width2 = width * width;
+    double sum_long3 = 0, sum_long4 = 0, intensity_cog = 0, intensity_core = 0;
+    double sum_dev2 = 0, sum_dev3 = 0, sum_dev4 = 0;
+    for(int k = 0; k < n_kept; k++)
+    {
+        const int i = image.pixel_id[k];
+        const double w = image.charge[k];
+        const double dx = pix_x[i] - x;
+        const double dy = pix_y[i] - y;
+        const double longitudinal = dx * cos_psi + dy * sin_psi;
+        const double transverse = -dx * sin_psi + dy * cos_psi;
+        const double longitudinal2 = longitudinal * longitudinal;
+        sum_long3 += w * longitudinal2 * longitudinal;
+        sum_long4 += w * longitudinal2 * longitudinal2;
+        if(dx * dx + dy * dy < cog_radius2)
         {
-            psi = std::atan2(eigen_vectors.col(1)[1], eigen_vectors.col(1)[0]);
+            intensity_cog += w;
         }
-        else
+        if(longitudinal2 / length2 + transverse * transverse / width2 < 1)
+        {
+            intensity_core += w;
+        }
+        if(w > 0)
         {
-            psi = M_PI/2;
+            const double dev = w - intensity_mean;
+            const double dev2 = dev * dev;
+            sum_dev2 += dev2;
+            sum_dev3 += dev2 * dev;
+            sum_dev4 += dev2 * dev2;
         }
     }
-    // Uint vector along the major axis is (cos(psi), sin(psi))
-    Eigen::VectorXd longitudinal = delta_x.array() * std::cos(psi) + delta_y.array() * std::sin(psi);
-    double m3_long = pow(longitudinal.array(), 3).matrix().dot(masked_image)/intensity;
-    double m4_long = pow(longitudinal.array(), 4).matrix().dot(masked_image)/intensity;
-    skewness = m3_long/pow(length, 3);
-    kurtosis = m4_long/pow(length, 4);
-
-    return HillasParameter{length, width, psi, x, y, skewness, kurtosis, intensity, r, phi};
+    const double length3 = length2 * length;
+    ImageParameters parameters;
+    parameters.hillas = HillasParameter{length, width, psi, x, y, sum_long3 / intensity / length3, sum_long4 / intensity / (length2 * length2), intensity, std::sqrt(x * x + y * y), std::atan2(y, x)};
+    parameters.concentration = ConcentrationParameter{intensity_cog / intensity, intensity_core / intensity, intensity_max / intensity};
+    const double intensity_std = std::sqrt(sum_dev2 / n_signal);
+    double intensity_skewness = 0;
+    double intensity_kurtosis = 0;
+    if(n_signal > 0)
+    {
+        const double std3 = intensity_std * intensity_std * intensity_std;
+        intensity_skewness = sum_dev3 / std3 / n_signal;
+        intensity_kurtosis = sum_dev4 / (std3 * intensity_std) / n_signal - 3; // Excess kurtosis
+    }
+    parameters.intensity = IntensityParameter{intensity_max, intensity_mean, intensity_std, intensity_skewness, intensity_kurtosis};
+    return parameters;
 }
-LeakageParameter ImageProcessor::leakage_parameter(CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image)
+LeakageParameter ImageProcessor::leakage_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image)
 {
-    // Use the mask to get the image
-    auto  outermost_pixel_mask = camera_geometry.get_border_pixel_mask(1);
-    auto  second_outermost_pixel_mask = camera_geometry.get_border_pixel_mask(2);
-    int   image_pixels = (masked_image.array() > 0).count();
-    double intensity = masked_image.sum();
-    double intensity_width_1 = outermost_pixel_mask.cast<double>().dot(masked_image)/intensity;
-    double intensity_width_2 = second_outermost_pixel_mask.cast<double>().dot(masked_image)/intensity;
-    double pixel_width_1 = 1.0 * (outermost_pixel_mask.array() && (masked_image.array() > 0)).count() / image_pixels;
-    double pixel_width_2 = 1.0 * (second_outermost_pixel_mask.array() && (masked_image.array() > 0)).count()/ image_pixels;
-    return LeakageParameter{pixel_width_1, pixel_width_2, intensity_width_1, intensity_width_2};
-
+    // The mask is taken from the pixels with signal
+    Eigen::Vector<bool, -1> image_mask = masked_image.array() > 0;
+    return leakage_parameter(camera_geometry, masked_image, PixelMask::from_bools(image_mask));
+}
+LeakageParameter ImageProcessor::leakage_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image, const PixelMask& image_mask)
+{
+    return leakage_parameter(camera_geometry, SparseImage::from_mask(image_mask, masked_image));
+}
+LeakageParameter ImageProcessor::leakage_parameter(const CameraGeometry& camera_geometry, const SparseImage& image)
+{
+    const auto& outermost_pixel_mask = camera_geometry.border_pixel_mask.at(1);
+    const auto& second_outermost_pixel_mask = camera_geometry.border_pixel_mask.at(2);
+    double intensity = 0, intensity_width_1 = 0, intensity_width_2 = 0;
+    int n_width_1 = 0, n_width_2 = 0;
+    for(int k = 0; k < image.size(); k++)
+    {
+        const int pixel = image.pixel_id[k];
+        intensity += image.charge[k];
+        if(outermost_pixel_mask[pixel])
+        {
+            intensity_width_1 += image.charge[k];
+            n_width_1++;
+        }
+        if(second_outermost_pixel_mask[pixel])
+        {
+            intensity_width_2 += image.charge[k];
+            n_width_2++;
+        }
+    }
+    const int image_pixels = image.size();
+    return LeakageParameter{1.0 * n_width_1 / image_pixels, 1.0 * n_width_2 / image_pixels, intensity_width_1 / intensity, intensity_width_2 / intensity};
 }
 // TODO: Add the unit test for the concentration parameter
 ConcentrationParameter ImageProcessor::concentration_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image, const HillasParameter& hillas_parameter)
@@ -170,48 +349,92 @@ ConcentrationParameter ImageProcessor::concentration_parameter(const CameraGeome
     double concentration_core = masked_image.dot(mask_core.cast<double>().matrix()) / hillas_parameter.intensity;
     return ConcentrationParameter{concentration_cog, concentration_core, concentration_pixel};
 }
-MorphologyParameter ImageProcessor::morphology_parameter(const CameraGeometry& camera_geometry, const Eigen::Vector<bool, -1>& image_mask)
+namespace {
+// Scratch arrays of the island labelling, one set per thread so the shared geometry stays const.
+// They only grow, so labelling the images of a camera allocates nothing after the first image.
+struct IslandScratch
+{
+    // Index of a pixel in the list of kept pixels, -1 for the pixels not kept
+    std::vector<int> index_of_pixel;
+    std::vector<int> parent;
+    std::vector<int> island_size;
+    std::vector<int> pixel_ids;
+};
+thread_local IslandScratch island_scratch;
+
+int find_root(std::vector<int>& parent, int k)
+{
+    while(parent[k] != k)
+    {
+        // Path halving
+        parent[k] = parent[parent[k]];
+        k = parent[k];
+    }
+    return k;
+}
+// Two pass union-find over the kept pixels: join the kept neighbors, then count the pixels of every root
+MorphologyParameter label_islands(const CameraGeometry& camera_geometry, const int* pixel_ids, int n_kept)
 {
-    std::unordered_map<size_t, std::vector<size_t>> island_map;
-    Eigen::Vector<bool, -1> pixel_in_island = Eigen::Vector<bool, -1>::Zero(image_mask.size());
-    size_t island_id = 0;
-    for(size_t i = 0; i < image_mask.size(); ++i)
+    auto& scratch = island_scratch;
+    if(static_cast<int>(scratch.index_of_pixel.size()) < camera_geometry.num_pixels)
     {
-        std::queue<size_t> queue;
-        if(image_mask[i] && !pixel_in_island[i])
+        scratch.index_of_pixel.resize(camera_geometry.num_pixels, -1);
+    }
+    if(static_cast<int>(scratch.parent.size()) < n_kept)
+    {
+        scratch.parent.resize(n_kept);
+        scratch.island_size.resize(n_kept);
+    }
+    auto& index_of_pixel = scratch.index_of_pixel;
+    auto& parent = scratch.parent;
+    auto& island_size = scratch.island_size;
+    for(int k = 0; k < n_kept; k++)
+    {
+        index_of_pixel[pixel_ids[k]] = k;
+        parent[k] = k;
+        island_size[k] = 0;
+    }
+    for(int k = 0; k < n_kept; k++)
+    {
+        const int pixel = pixel_ids[k];
+        for(int32_t j = camera_geometry.neighbor_offsets[pixel]; j < camera_geometry.neighbor_offsets[pixel + 1]; j++)
         {
-            queue.push(i);
-            pixel_in_island[i] = true;
-            island_map[island_id].push_back(i);
-            while(!queue.empty())
+            const int neighbor = index_of_pixel[camera_geometry.neighbor_indices[j]];
+            if(neighbor < 0)
             {
-                auto pixel = queue.front();
-                queue.pop();
-                for(Eigen::SparseMatrix<int, Eigen::RowMajor>::InnerIterator it(camera_geometry.neigh_matrix, pixel); it; ++it)
-                {
-                    if(it.value() > 0 && !pixel_in_island[it.col()] && image_mask[it.col()])
-                    {
-                        queue.push(it.col());
-                        pixel_in_island[it.col()] = true;
-                        island_map[island_id].push_back(it.col());
-                    }
-                }
+                continue;
+            }
+            int root = find_root(parent, k);
+            int neighbor_root = find_root(parent, neighbor);
+            if(root != neighbor_root)
+            {
+                // The smaller index becomes the root, so the labels follow the pixel order
+                parent[std::max(root, neighbor_root)] = std::min(root, neighbor_root);
             }
-            island_id++;
         }
     }
-    int num_island = island_map.size();
-    int n_pixels = image_mask.count();
+    int n_islands = 0;
+    for(int k = 0; k < n_kept; k++)
+    {
+        const int root = find_root(parent, k);
+        n_islands += (root == k);
+        island_size[root]++;
+        index_of_pixel[pixel_ids[k]] = -1;
+    }
     int n_small_islands = 0;
     int n_medium_islands = 0;
     int n_large_islands = 0;
-    for(const auto& [island_id, island_pixels]: island_map)
+    for(int k = 0; k < n_kept; k++)
     {
-        if(island_pixels.size() < 10)
+        if(parent[k] != k)
+        {
+            continue;
+        }
+        if(island_size[k] < 10)
         {
             n_small_islands++;
         }
-        else if(island_pixels.size() < 30)
+        else if(island_size[k] < 30)
         {
             n_medium_islands++;
         }
@@ -220,8 +443,19 @@ MorphologyParameter ImageProcessor::morphology_parameter(const CameraGeometry& c
             n_large_islands++;
         }
     }
-    return MorphologyParameter{n_pixels, num_island, n_small_islands, n_medium_islands, n_large_islands};
-
+    return MorphologyParameter{n_kept, n_islands, n_small_islands, n_medium_islands, n_large_islands};
+}
+}
+MorphologyParameter ImageProcessor::morphology_parameter(const CameraGeometry& camera_geometry, const SparseImage& image)
+{
+    return label_islands(camera_geometry, image.pixel_id.data(), image.size());
+}
+MorphologyParameter ImageProcessor::morphology_parameter(const CameraGeometry& camera_geometry, const PixelMask& image_mask)
+{
+    auto& pixel_ids = island_scratch.pixel_ids;
+    pixel_ids.clear();
+    image_mask.for_each([&pixel_ids](int pixel) { pixel_ids.push_back(pixel); });
+    return label_islands(camera_geometry, pixel_ids.data(), pixel_ids.size());
 }
 IntensityParameter ImageProcessor::intensity_parameter(const Eigen::VectorXd& masked_image)
 {
@@ -258,13 +492,12 @@ IntensityParameter ImageProcessor::intensity_parameter(const Eigen::VectorXd& ma
     return IntensityParameter{intensity_max, intensity_mean, intensity_std, intensity_skewness, intensity_kurtosis};
 }
 
-void ImageProcessor::dilate_image(const CameraGeometry& camera_geometry, Eigen::Vector<bool, -1>& image_mask)
+void ImageProcessor::dilate_image(const CameraGeometry& camera_geometry, PixelMask& image_mask)
 {
-    Eigen::SparseMatrix<int, Eigen::RowMajor> dilated_matrix = camera_geometry.neigh_matrix;
-    image_mask = (dilated_matrix * image_mask.cast<int>().matrix()).cast<bool>() || image_mask;
+    camera_geometry.dilate(image_mask);
 }
 
-void ImageProcessor::handle_simulation_level(ArrayEvent& event)
+void ImageProcessor::handle_simulation_level(ArrayEvent& event) const
 {
     if(!event.simulation)
     {
@@ -277,8 +510,8 @@ void ImageProcessor::handle_simulation_level(ArrayEvent& event)
         {
             if(poisson_noise > 0)
             {
-                auto noise_image = adding_poisson_noise(simulated_camera->true_image, poisson_noise);
-                if(fake_trigger(subarray.tels.at(tel_id).camera_description.camera_geometry, noise_image, 5.0, 4))
+                auto noise_image = adding_poisson_noise(simulated_camera->true_image, event.run_id, event.event_id, tel_id);
+                if(fake_trigger(*subarray.tels.at(tel_id).camera_description.camera_geometry, noise_image, 5.0, 4))
                 {
                     event.simulation->triggered_tels.push_back(tel_id);
                 }
@@ -296,41 +529,40 @@ void ImageProcessor::handle_simulation_level(ArrayEvent& event)
 
     for(const auto tel_id: event.simulation->triggered_tels)
     {
-        auto& simulated_camera = event.simulation->tels.at(tel_id);
-        auto image_mask = (*image_cleaner)(subarray.tels.at(tel_id).camera_description.camera_geometry, simulated_camera->fake_image);
-        Eigen::VectorXd masked_image = image_mask.select(simulated_camera->fake_image, Eigen::VectorXd::Zero(simulated_camera->fake_image.size()));
-
-        if(masked_image.sum() < 50)
+        auto* simulated_camera = event.simulation->tels.at(tel_id);
+        if(pre_screen(simulated_camera->fake_image) != ImageRejection::none)
         {
             simulated_camera->fake_image_parameters = ImageParameters();
             continue;
         }
-        HillasParameter hillas_parameter = ImageProcessor::hillas_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, masked_image);
-        LeakageParameter leakage_parameter = ImageProcessor::leakage_parameter(const_cast<CameraGeometry&>(subarray.tels.at(tel_id).camera_description.camera_geometry), masked_image);
-        ConcentrationParameter concentration_parameter = ImageProcessor::concentration_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, masked_image, hillas_parameter);
-        MorphologyParameter morphology_parameter = ImageProcessor::morphology_parameter(subarray.tels.at(tel_id).camera_description.camera_geometry, image_mask);
-        IntensityParameter intensity_parameter = ImageProcessor::intensity_parameter(masked_image);
-
-        simulated_camera->fake_image_mask = image_mask;
-        simulated_camera->fake_image_parameters.hillas = hillas_parameter;
-        simulated_camera->fake_image_parameters.leakage = leakage_parameter;
-        simulated_camera->fake_image_parameters.concentration = concentration_parameter;
-        simulated_camera->fake_image_parameters.morphology = morphology_parameter;
-        simulated_camera->fake_image_parameters.intensity = intensity_parameter;
+        const auto& camera_geometry = *subarray.tels.at(tel_id).camera_description.camera_geometry;
+        // Buffers of the thread, only the parameters of the fake image are kept
+        thread_local PixelMask image_mask;
+        thread_local SparseImage cleaned_image;
+        image_cleaner->clean(camera_geometry, simulated_camera->fake_image, Eigen::VectorXd(), image_mask, cleaned_image);
+        if(cleaned_image.sum() < min_intensity)
+        {
+            simulated_camera->fake_image_parameters = ImageParameters();
+            continue;
+        }
+        auto image_parameters = ImageProcessor::moment_parameters(camera_geometry, cleaned_image);
+        simulated_camera->fake_image_parameters.hillas = image_parameters.hillas;
+        simulated_camera->fake_image_parameters.leakage = ImageProcessor::leakage_parameter(camera_geometry, cleaned_image);
+        simulated_camera->fake_image_parameters.concentration = image_parameters.concentration;
+        simulated_camera->fake_image_parameters.morphology = ImageProcessor::morphology_parameter(camera_geometry, cleaned_image);
+        simulated_camera->fake_image_parameters.intensity = image_parameters.intensity;
+        simulated_camera->fake_image_mask = std::move(image_mask);
     }
 }
-Eigen::VectorXd ImageProcessor::adding_poisson_noise(Eigen::VectorXi true_image, double poisson_noise)
+Eigen::VectorXd ImageProcessor::adding_poisson_noise(const Eigen::VectorXi& true_image, int run_id, int event_id, int tel_id) const
 {
-    std::poisson_distribution<int> poisson_dist(poisson_noise);
-    Eigen::VectorXd noisy_image(true_image.size());
-    for(int i = 0; i < true_image.size(); ++i)
-    {
-        noisy_image[i] = poisson_dist(gen) + true_image[i];
-    }
-    return noisy_image;
+    Philox4x32 generator({random_seed, static_cast<uint32_t>(run_id)});
+    Eigen::VectorXi noise(true_image.size());
+    poisson_sampler.fill(noise, generator, {static_cast<uint32_t>(event_id), static_cast<uint32_t>(tel_id)});
+    return (noise + true_image).cast<double>();
 }
 
-bool ImageProcessor::fake_trigger(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double threshold, int min_pixels_above_threshold)
+bool ImageProcessor::fake_trigger(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double threshold, int min_pixels_above_threshold) const
 {
     // Check if the image has enough pixels above the threshold
     Eigen::Vector<bool, -1> above_threshold_pixels = image.array() > threshold;
@@ -352,7 +584,14 @@ json ImageProcessor::get_default_config()
 {
     std::string default_config = R"(
     {
-        "image_cleaner_type": "Tailcuts_cleaner"
+        "image_cleaner_type": "Tailcuts_cleaner",
+        "parallel_telescopes": false,
+        "min_parallel_telescopes": 4,
+        "random_seed": 0,
+        "min_intensity": 50,
+        "pre_screen": {
+            "enabled": true
+        }
     }
     )";
     json base_config = Configurable::from_string(default_config);
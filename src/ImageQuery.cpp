@@ -1,31 +1,42 @@
 #include "ImageQuery.hh"
+#include <unordered_map>
 
-void ImageQuery::init_variables()
+ImageQuery::Evaluator::Evaluator(const std::string& expr)
 {
-    init_hillas_parameter();
-    init_leakage_parameter();
-    init_morphology_parameter();
+    parser.DefineVar("hillas_length", &hillas_parameter.length);
+    parser.DefineVar("hillas_width", &hillas_parameter.width);
+    parser.DefineVar("hillas_psi", &hillas_parameter.psi);
+    parser.DefineVar("hillas_x", &hillas_parameter.x);
+    parser.DefineVar("hillas_y", &hillas_parameter.y);
+    parser.DefineVar("hillas_intensity", &hillas_parameter.intensity);
+    parser.DefineVar("leakage_pixels_width_1", &leakage_parameter.pixels_width_1);
+    parser.DefineVar("leakage_pixels_width_2", &leakage_parameter.pixels_width_2);
+    parser.DefineVar("leakage_intensity_width_1", &leakage_parameter.intensity_width_1);
+    parser.DefineVar("leakage_intensity_width_2", &leakage_parameter.intensity_width_2);
+    parser.DefineVar("morphology_n_pixels", &morphology_n_pixels);
+    parser.SetExpr(expr);
 }
 
-void ImageQuery::init_hillas_parameter()
+ImageQuery::Evaluator& ImageQuery::thread_evaluator() const
 {
-    parser_.DefineVar("hillas_length", &hillas_parameter_.length);
-    parser_.DefineVar("hillas_width", &hillas_parameter_.width);
-    parser_.DefineVar("hillas_psi", &hillas_parameter_.psi);
-    parser_.DefineVar("hillas_x", &hillas_parameter_.x);
-    parser_.DefineVar("hillas_y", &hillas_parameter_.y);
-    parser_.DefineVar("hillas_intensity", &hillas_parameter_.intensity);
-}
-void ImageQuery::init_leakage_parameter()
-{
-    parser_.DefineVar("leakage_pixels_width_1", &leakage_parameter_.pixels_width_1);
-    parser_.DefineVar("leakage_pixels_width_2", &leakage_parameter_.pixels_width_2);
-    parser_.DefineVar("leakage_intensity_width_1", &leakage_parameter_.intensity_width_1);
-    parser_.DefineVar("leakage_intensity_width_2", &leakage_parameter_.intensity_width_2);
-}
-void ImageQuery::init_morphology_parameter()
-{
-    parser_.DefineVar("morphology_n_pixels", &morphology_n_pixels_);
+    struct ThreadEvaluator
+    {
+        std::weak_ptr<const std::string> expression;
+        std::unique_ptr<Evaluator> evaluator;
+    };
+    // Keyed by the address of the expression, an expired entry may belong to an earlier query at the same address
+    thread_local std::unordered_map<const std::string*, ThreadEvaluator> evaluators;
+    auto it = evaluators.find(expression.get());
+    if(it != evaluators.end() && !it->second.expression.expired())
+    {
+        return *it->second.evaluator;
+    }
+    auto evaluator = std::make_unique<Evaluator>(*expression);
+    std::erase_if(evaluators, [](const auto& entry) { return entry.second.expression.expired(); });
+    auto& entry = evaluators[expression.get()];
+    entry.expression = expression;
+    entry.evaluator = std::move(evaluator);
+    return *entry.evaluator;
 }
 
 void ImageQuery::configure(const json& config)
@@ -42,13 +53,14 @@ void ImageQuery::configure(const json& config)
     }
 }
 
-bool ImageQuery::operator()(const ImageParameters &image_parameter)
+bool ImageQuery::operator()(const ImageParameters &image_parameter) const
 {
-    hillas_parameter_ = image_parameter.hillas;
-    leakage_parameter_ = image_parameter.leakage;
-    morphology_n_pixels_ = image_parameter.morphology.n_pixels;
+    auto& evaluator = thread_evaluator();
+    evaluator.hillas_parameter = image_parameter.hillas;
+    evaluator.leakage_parameter = image_parameter.leakage;
+    evaluator.morphology_n_pixels = image_parameter.morphology.n_pixels;
     try {
-        return parser_.Eval();
+        return evaluator.parser.Eval();
     }
     catch(mu::Parser::exception_type& e) {
         printf("Error evaluating ImageQuery:\n");
@@ -0,0 +1,269 @@
+#include "MultiSimtelEventSource.hh"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <glob.h>
+#include <stdexcept>
+
+MultiSimtelEventSource::MultiSimtelEventSource(const std::vector<std::string>& filenames, int n_readers, bool ordered, int64_t max_events, std::vector<int> subarray, bool load_simulated_showers, int gain_selector_threshold, SimtelReadOptions read_options):
+    EventSource(filenames.empty() ? "" : filenames.front(), max_events, subarray, load_simulated_showers),
+    filenames(filenames),
+    n_readers(std::max(n_readers, 1)),
+    ordered(ordered),
+    gain_selector_threshold(gain_selector_threshold),
+    read_options(read_options)
+{
+    initialize();
+}
+MultiSimtelEventSource::~MultiSimtelEventSource()
+{
+    stop_readers();
+}
+std::vector<std::string> MultiSimtelEventSource::expand_glob(const std::string& pattern)
+{
+    glob_t glob_result;
+    std::vector<std::string> filenames;
+    if(glob(pattern.c_str(), 0, nullptr, &glob_result) == 0)
+    {
+        for(size_t i = 0; i < glob_result.gl_pathc; i++)
+        {
+            filenames.emplace_back(glob_result.gl_pathv[i]);
+        }
+    }
+    globfree(&glob_result);
+    if(filenames.empty())
+    {
+        throw std::runtime_error("No file matches " + pattern);
+    }
+    std::sort(filenames.begin(), filenames.end());
+    return filenames;
+}
+void MultiSimtelEventSource::open_file()
+{
+    if(filenames.empty())
+    {
+        throw std::runtime_error("MultiSimtelEventSource needs at least one file");
+    }
+    is_stream = true;
+    // The file handler keeps its eventio state per thread, so every SimtelEventSource lives on a single thread
+    std::exception_ptr error;
+    std::thread header_reader([this, &error]() {
+        try
+        {
+            SimtelEventSource first_source(filenames.front(), -1, allowed_tels, false, gain_selector_threshold, read_options);
+            simulation_config = first_source.simulation_config;
+            atmosphere_model = first_source.atmosphere_model;
+            metaparam = first_source.metaparam;
+            subarray = first_source.subarray;
+            allowed_tels = first_source.allowed_tels;
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+    });
+    header_reader.join();
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+    start_readers();
+}
+void MultiSimtelEventSource::start_readers()
+{
+    auto n_files = filenames.size();
+    file_shower_arrays.resize(n_files);
+    file_statistics.resize(n_files);
+    if(ordered)
+    {
+        queues.resize(n_files);
+    }
+    else
+    {
+        queues.resize(1);
+        queues.front().expected_files = n_files;
+    }
+    auto n_threads = std::min<size_t>(n_readers, n_files);
+    for(size_t i = 0; i < n_threads; i++)
+    {
+        readers.emplace_back(&MultiSimtelEventSource::reader_loop, this);
+    }
+}
+void MultiSimtelEventSource::stop_readers()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stop = true;
+    }
+    queue_not_full.notify_all();
+    for(auto& reader: readers)
+    {
+        if(reader.joinable())
+        {
+            reader.join();
+        }
+    }
+    readers.clear();
+}
+void MultiSimtelEventSource::reader_loop()
+{
+    while(true)
+    {
+        size_t file_index;
+        {
+            // After a stop the remaining files are not opened
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if(stop || next_file >= filenames.size())
+            {
+                return;
+            }
+            file_index = next_file++;
+        }
+        try
+        {
+            read_file(file_index);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if(!reader_error)
+            {
+                reader_error = std::current_exception();
+            }
+            stop = true;
+            queue_not_empty.notify_all();
+            queue_not_full.notify_all();
+            return;
+        }
+    }
+}
+void MultiSimtelEventSource::read_file(size_t file_index)
+{
+    const auto& filename = filenames[file_index];
+    SimtelEventSource source(filename, -1, allowed_tels, load_simulated_showers, gain_selector_threshold, read_options);
+    if(!source.subarray->is_compatible(*subarray))
+    {
+        throw std::runtime_error("The subarray of " + filename + " is not compatible with the one of " + filenames.front());
+    }
+    // The events given back to this source are reused by the readers
+    source.event_pool = event_pool;
+    for(auto& event: source)
+    {
+        if(!push_event(file_index, std::move(event)))
+        {
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    file_shower_arrays[file_index] = std::move(source.shower_array);
+    file_statistics[file_index] = std::move(source.statistics);
+    queues[queue_index(file_index)].done_files++;
+    completed_files++;
+    queue_not_empty.notify_all();
+}
+bool MultiSimtelEventSource::push_event(size_t file_index, ArrayEvent&& event)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    auto& queue = queues[queue_index(file_index)];
+    queue_not_full.wait(lock, [this, &queue]() { return stop || queue.events.size() < queue_capacity; });
+    if(stop)
+    {
+        return false;
+    }
+    queue.events.push_back(std::move(event));
+    queue_not_empty.notify_all();
+    return true;
+}
+ArrayEvent MultiSimtelEventSource::get_event()
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while(current_queue < queues.size())
+    {
+        auto& queue = queues[current_queue];
+        queue_not_empty.wait(lock, [this, &queue]() {
+            return reader_error || !queue.events.empty() || queue.done_files == queue.expected_files;
+        });
+        if(reader_error)
+        {
+            finished = true;
+            std::rethrow_exception(reader_error);
+        }
+        if(!queue.events.empty())
+        {
+            auto event = std::move(queue.events.front());
+            queue.events.pop_front();
+            queue_not_full.notify_all();
+            return event;
+        }
+        current_queue++;
+    }
+    finished = true;
+    return ArrayEvent();
+}
+void MultiSimtelEventSource::on_iteration_end()
+{
+    stop_readers();
+    // The readers are joined, so reader_error can be read without the lock
+    if(finished && !reader_error)
+    {
+        for(auto& file_stat: file_statistics)
+        {
+            if(file_stat.has_value())
+            {
+                if(!statistics.has_value())
+                {
+                    statistics = Statistics();
+                }
+                *statistics += *file_stat;
+            }
+        }
+    }
+    if(load_simulated_showers && !shower_array.has_value())
+    {
+        load_all_simulated_showers();
+    }
+}
+void MultiSimtelEventSource::load_all_simulated_showers()
+{
+    if(shower_array.has_value())
+    {
+        return;
+    }
+    SimulatedShowerArray merged_shower_array;
+    bool collected;
+    {
+        // Once all files are completed the readers no longer touch file_shower_arrays
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        collected = load_simulated_showers && completed_files == filenames.size();
+    }
+    for(size_t i = 0; i < filenames.size(); i++)
+    {
+        if(collected && file_shower_arrays[i].has_value())
+        {
+            merged_shower_array.append(*file_shower_arrays[i]);
+            continue;
+        }
+        // The readers did not see the whole file, read its showers on a separate thread
+        std::exception_ptr error;
+        std::thread shower_reader([this, i, &merged_shower_array, &error]() {
+            try
+            {
+                SimtelEventSource source(filenames[i], -1, allowed_tels, false, gain_selector_threshold, read_options);
+                merged_shower_array.append(source.get_shower_array());
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+        });
+        shower_reader.join();
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    shower_array = std::move(merged_shower_array);
+}
+const std::string MultiSimtelEventSource::print() const
+{
+    return spdlog::fmt_lib::format("MultiSimtelEventSource: {} files, first file {}", filenames.size(), input_filename);
+}
@@ -0,0 +1,33 @@
+#include "R1Calibration.hh"
+
+namespace R1Calibration {
+void calibrate(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, R1WaveformMatrix& r1_waveform)
+{
+    const int n_pixels = waveform[0].rows();
+    const int n_samples = waveform[0].cols();
+    r1_waveform.resize(n_pixels, n_samples);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        const int gain = gain_selection(ipix);
+        // (adc - pedestal) * dc_to_pe folded into one multiply-add per sample
+        const float scale = static_cast<float>(monitor.dc_to_pe(gain, ipix));
+        const float offset = static_cast<float>(-monitor.pedestal_per_sample(gain, ipix) * monitor.dc_to_pe(gain, ipix));
+        const uint16_t* adc = waveform[gain].data() + static_cast<Eigen::Index>(ipix) * n_samples;
+        float* r1 = r1_waveform.data() + static_cast<Eigen::Index>(ipix) * n_samples;
+        for(int isample = 0; isample < n_samples; isample++) {
+            r1[isample] = static_cast<float>(adc[isample]) * scale + offset;
+        }
+    }
+}
+void calibrate_reference(const std::array<WaveformMatrix, 2>& waveform, const Eigen::VectorXi& gain_selection, const TelMonitor& monitor, R1WaveformMatrix& r1_waveform)
+{
+    const int n_pixels = waveform[0].rows();
+    const int n_samples = waveform[0].cols();
+    r1_waveform.resize(n_pixels, n_samples);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        int gain = gain_selection(ipix);
+        for(int isample = 0; isample < n_samples; isample++) {
+            r1_waveform(ipix, isample) = static_cast<float>((waveform[gain](ipix, isample) - monitor.pedestal_per_sample(gain, ipix)) * monitor.dc_to_pe(gain, ipix));
+        }
+    }
+}
+}
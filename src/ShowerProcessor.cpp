@@ -36,13 +36,10 @@ json ShowerProcessor::get_default_config()
     return defualt_json;
 }
 
-void ShowerProcessor::operator()(ArrayEvent& event)
+void ShowerProcessor::operator()(ArrayEvent& event) const
 {
-    if(!event.dl2)
-    {
-        event.dl2 = DL2Event();
-    }
-    for(auto& geometry_reconstructor: geometry_reconstructors)
+    event.emplace_level<DL2Event>();
+    for(const auto& geometry_reconstructor: geometry_reconstructors)
     {
         (*geometry_reconstructor)(event);
         // Only store the geometry for the telescopes that were used in the reconstruction
@@ -65,7 +62,7 @@ void ShowerProcessor::operator()(ArrayEvent& event)
     {
 
                 auto true_direction = SkyDirection(AltAzFrame(), event.simulation->shower.az, event.simulation->shower.alt);
-                auto telescope_frame = TelescopeFrame(SphericalRepresentation(event.pointing->tels[tel_id]->azimuth, event.pointing->tels[tel_id]->altitude));
+                auto telescope_frame = TelescopeFrame(SphericalRepresentation(event.pointing->tels.at(tel_id)->azimuth, event.pointing->tels.at(tel_id)->altitude));
                 auto tillted_frame =TiltedGroundFrame(telescope_frame.pointing_direction);
                 auto fov_direction = true_direction.transform_to(telescope_frame);
 
@@ -114,7 +111,7 @@ void ShowerProcessor::operator()(ArrayEvent& event)
             continue;
         }
         auto true_direction = SkyDirection(AltAzFrame(), event.simulation->shower.az, event.simulation->shower.alt);
-        auto telescope_frame = TelescopeFrame(SphericalRepresentation(event.pointing->tels[tel_id]->azimuth, event.pointing->tels[tel_id]->altitude));
+        auto telescope_frame = TelescopeFrame(SphericalRepresentation(event.pointing->tels.at(tel_id)->azimuth, event.pointing->tels.at(tel_id)->altitude));
         auto fov_direction = true_direction.transform_to(telescope_frame);
         auto core_pos = CartesianPoint(event.simulation->shower.core_x, event.simulation->shower.core_y, 0);
         auto tel_pos = CartesianPoint(subarray.tel_positions.at(tel_id)[0], subarray.tel_positions.at(tel_id)[1], 0);
@@ -0,0 +1,93 @@
+#include "SimtelEventIndex.hh"
+#include "nlohmann_json/json.hpp"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using json = nlohmann::json;
+
+void SimtelEventIndex::add_event(const SimtelEventIndexEntry& entry)
+{
+    event_id_to_number.try_emplace(entry.event_id, entries.size());
+    entries.push_back(entry);
+}
+std::optional<size_t> SimtelEventIndex::find_event_id(int event_id) const
+{
+    auto it = event_id_to_number.find(event_id);
+    if(it == event_id_to_number.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+std::vector<SimtelCalibrationBlock> SimtelEventIndex::calibration_blocks_before(size_t event_number) const
+{
+    std::map<std::pair<unsigned long, long>, const SimtelCalibrationBlock*> last_blocks;
+    const auto n_blocks = std::min(entries[event_number].n_calibration_blocks, calibration_blocks.size());
+    for(size_t iblock = 0; iblock < n_blocks; iblock++) {
+        const auto& block = calibration_blocks[iblock];
+        last_blocks[{block.type, block.ident}] = &block;
+    }
+    std::vector<SimtelCalibrationBlock> blocks;
+    blocks.reserve(last_blocks.size());
+    for(const auto& [key, block]: last_blocks) {
+        blocks.push_back(*block);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+    return blocks;
+}
+int64_t SimtelEventIndex::modification_time(const std::string& filename)
+{
+    return static_cast<int64_t>(std::filesystem::last_write_time(filename).time_since_epoch().count());
+}
+void SimtelEventIndex::set_file(const std::string& simtel_filename)
+{
+    file_size = std::filesystem::file_size(simtel_filename);
+    file_mtime = modification_time(simtel_filename);
+}
+std::optional<SimtelEventIndex> SimtelEventIndex::load(const std::string& index_path, uint64_t expected_file_size, int64_t expected_file_mtime)
+{
+    std::ifstream input(index_path);
+    if(!input.is_open()) {
+        return std::nullopt;
+    }
+    try {
+        auto index_json = json::parse(input);
+        // A file rewritten with the same size still has another modification time
+        if(index_json.at("file_size").get<uint64_t>() != expected_file_size || index_json.at("file_mtime").get<int64_t>() != expected_file_mtime) {
+            spdlog::warn("Ignore outdated event index {}", index_path);
+            return std::nullopt;
+        }
+        SimtelEventIndex index(expected_file_size, expected_file_mtime);
+        for(const auto& block: index_json.at("calibration_blocks")) {
+            index.add_calibration_block({block.at(0).get<unsigned long>(), block.at(1).get<long>(), block.at(2).get<int64_t>()});
+        }
+        for(const auto& event: index_json.at("events")) {
+            index.add_event({event.at(0).get<int>(), event.at(1).get<int64_t>(), event.at(2).get<int64_t>(), event.at(3).get<int64_t>(), event.at(4).get<size_t>()});
+        }
+        return index;
+    }
+    catch(const json::exception& e) {
+        spdlog::warn("Failed to parse event index {}: {}", index_path, e.what());
+        return std::nullopt;
+    }
+}
+bool SimtelEventIndex::save(const std::string& index_path) const
+{
+    json events = json::array();
+    for(const auto& entry: entries) {
+        events.push_back({entry.event_id, entry.shower_offset, entry.mc_event_offset, entry.event_offset, entry.n_calibration_blocks});
+    }
+    json blocks = json::array();
+    for(const auto& block: calibration_blocks) {
+        blocks.push_back({block.type, block.ident, block.offset});
+    }
+    std::ofstream output(index_path);
+    if(!output.is_open()) {
+        spdlog::warn("Can not write event index {}", index_path);
+        return false;
+    }
+    output << json{{"file_size", file_size}, {"file_mtime", file_mtime}, {"calibration_blocks", blocks}, {"events", events}};
+    return output.good();
+}
@@ -2,11 +2,13 @@
 #include "ArrayEvent.hh"
 #include "CameraDescription.hh"
 #include "CameraGeometry.hh"
+#include "CameraGeometryRegistry.hh"
 #include "LACT_hessioxxx/include/io_basic.h"
 #include "LACT_hessioxxx/include/io_hess.h"
 #include "Pointing.hh"
 #include "R0Event.hh"
 #include "R1Event.hh"
+#include "R1Calibration.hh"
 #include "SimtelFileHandler.hh"
 #include "SimulatedCamera.hh"
 #include "SimulatedShowerArray.hh"
@@ -19,20 +21,38 @@
 #include "LACT_hessioxxx/include/mc_tel.h"
 #include "LACT_hessioxxx/include/mc_atmprof.h"
 #include "Utils.hh"
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <thread>
+#include <filesystem>
 #include "Utils.hh"
-SimtelEventSource::SimtelEventSource(const std::string& filename, int64_t max_events, std::vector<int> subarray, bool load_simulated_showers, int gain_selector_threshold):
+SimtelEventSource::SimtelEventSource(const std::string& filename, int64_t max_events, std::vector<int> subarray, bool load_simulated_showers, int gain_selector_threshold, SimtelReadOptions read_options):
     EventSource(filename, max_events, subarray, load_simulated_showers),
-    gain_selector_threshold(gain_selector_threshold)
+    gain_selector_threshold(gain_selector_threshold),
+    read_options(read_options)
 {
     initialize();
+    init_statistics();
 }
 
 void SimtelEventSource::open_file()
 {
-    simtel_file_handler = std::make_unique<SimtelFileHandler>(input_filename);
+    simtel_file_handler = std::make_unique<SimtelFileHandler>(input_filename, read_options);
     is_stream = true;
+    // Random access needs an uncompressed local file and its event index
+    if(simtel_file_handler->is_seekable() && std::filesystem::is_regular_file(input_filename))
+    {
+        event_index = SimtelEventIndex::load(SimtelEventIndex::sidecar_path(input_filename), std::filesystem::file_size(input_filename), SimtelEventIndex::modification_time(input_filename));
+        if(event_index.has_value())
+        {
+            is_stream = false;
+        }
+        else
+        {
+            simtel_file_handler->start_recording_event_index();
+        }
+    }
     simtel_file_handler->read_until_event();
 }
 void SimtelEventSource::init_metaparam()
@@ -46,10 +66,16 @@ void SimtelEventSource::init_atmosphere_model()
 void SimtelEventSource::init_simulation_config()
 {
     set_simulation_config();
+    if(load_simulated_showers)
+    {
+        simtel_file_handler->shower_array.resize(simulation_config->n_showers * 20);
+    }
 }
 void SimtelEventSource::init_subarray()
 {
     subarray = SubarrayDescription();
+    // Only decode the selected telescopes of each event
+    simtel_file_handler->set_telescope_selection(allowed_tels);
     //Mean we will read all telescopes in the file
     if(allowed_tels.empty())
     {
@@ -62,6 +88,11 @@ void SimtelEventSource::init_subarray()
         set_telescope_settings(tel_id);
     }
 }
+void SimtelEventSource::init_statistics()
+{
+    statistics = Statistics();
+    statistics->add_histogram(event_energy_histogram, make_regular_histogram<float>(-1, 3, 60));
+}
 void SimtelEventSource::set_simulation_config()
 {
     simulation_config = SimulationConfiguration();
@@ -125,36 +156,29 @@ void SimtelEventSource::set_telescope_settings(int tel_id)
     }
     int itel = it->second;
     camera_name = fmt::format("{}_{}", metaparam->tel_metadata[tel_id]["CAMERA_CONFIG_NAME"], metaparam->tel_metadata[tel_id]["CAMERA_CONFIG_VERSION"]);
-    auto camera_geometry = get_telescope_camera_geometry(itel);
     auto camera_readout = get_telescope_camera_readout(itel);
     auto optics = get_telescope_optics(itel);
-    if(optics.effective_focal_length != 0)
-    {
-        camera_geometry.pix_x_fov = camera_geometry.pix_x / optics.effective_focal_length;
-        camera_geometry.pix_y_fov = camera_geometry.pix_y / optics.effective_focal_length;
-        camera_geometry.pix_width_fov = camera_geometry.pix_width / optics.effective_focal_length;
-    }
-    else
+    if(optics.effective_focal_length == 0)
     {
         spdlog::warn("Effective focal length is not available, so using the equivalent focal length");
-        camera_geometry.pix_x_fov = camera_geometry.pix_x / optics.equivalent_focal_length;
-        camera_geometry.pix_y_fov = camera_geometry.pix_y / optics.equivalent_focal_length;
-        camera_geometry.pix_width_fov = camera_geometry.pix_width / optics.equivalent_focal_length;
     }
+    auto camera_geometry = get_telescope_camera_geometry(itel, optics.get_focal_length());
     auto camera_description = CameraDescription{camera_name, std::move(camera_geometry), std::move(camera_readout)};
     auto telescope_description = TelescopeDescription{.camera_description = std::move(camera_description), .optics_description = std::move(optics)};
     auto telescope_position = get_telescope_position(itel);
     subarray->add_telescope(tel_id, std::move(telescope_description), telescope_position);
 }
-CameraGeometry SimtelEventSource::get_telescope_camera_geometry(int tel_index)
-{
-    int num_pixels = simtel_file_handler->hsdata->camera_set[tel_index].num_pixels;
-    double* pix_x = simtel_file_handler->hsdata->camera_set[tel_index].xpix;
-    double* pix_y = simtel_file_handler->hsdata->camera_set[tel_index].ypix;
-    double* pix_area = simtel_file_handler->hsdata->camera_set[tel_index].area;
-    int* pix_type = simtel_file_handler->hsdata->camera_set[tel_index].pixel_shape;
-    double cam_rotation = simtel_file_handler->hsdata->camera_set[tel_index].cam_rot;
-    return CameraGeometry(camera_name, num_pixels, pix_x, pix_y, pix_area, pix_type, cam_rotation);
+std::shared_ptr<const CameraGeometry> SimtelEventSource::get_telescope_camera_geometry(int tel_index, double focal_length)
+{
+    const auto& camera_set = simtel_file_handler->hsdata->camera_set[tel_index];
+    const int num_pixels = camera_set.num_pixels;
+    // The telescopes with the same camera share one geometry
+    return CameraGeometryRegistry::shared().get(camera_name,
+        Eigen::Map<const Eigen::VectorXd>(camera_set.xpix, num_pixels),
+        Eigen::Map<const Eigen::VectorXd>(camera_set.ypix, num_pixels),
+        Eigen::Map<const Eigen::VectorXd>(camera_set.area, num_pixels),
+        Eigen::Map<const Eigen::VectorXi>(camera_set.pixel_shape, num_pixels),
+        camera_set.cam_rot, focal_length);
 }
 
 CameraReadout SimtelEventSource::get_telescope_camera_readout(int tel_index)
@@ -172,7 +196,7 @@ CameraReadout SimtelEventSource::get_telescope_camera_readout(int tel_index)
             reference_pulse_shape(i, j) = simtel_file_handler->hsdata->pixel_set[tel_index].refshape[i][j];
         }
     }
-    return CameraReadout{.camera_name = camera_name, .sampling_rate = sampling_rate, .reference_pulse_sample_width = reference_pulse_sample_width, .n_channels = n_channels, .n_pixels = num_pixels,.n_samples= n_samples, .reference_pulse_shape = std::move(reference_pulse_shape)};
+    return CameraReadout{.camera_name = camera_name, .sampling_rate = sampling_rate, .reference_pulse_sample_width = reference_pulse_sample_width, .n_channels = n_channels, .n_pixels = num_pixels,.n_samples= n_samples, .reference_pulse_shape = std::move(reference_pulse_shape), .gain_selector_threshold = static_cast<double>(gain_selector_threshold)};
 }
 OpticsDescription SimtelEventSource::get_telescope_optics(int tel_index)
 {
@@ -191,28 +215,41 @@ std::array<double, 3> SimtelEventSource::get_telescope_position(int tel_index)
 }
 void SimtelEventSource::load_all_simulated_showers()
 {
-    // Create a temporary shower array in a new thread
+    if(shower_array.has_value())
+    {
+        return;
+    }
+    if(is_iteration_done())
+    {
+        collect_remaining_showers();
+    }
+    else
+    {
+        read_all_showers_separately();
+    }
+}
+void SimtelEventSource::on_iteration_end()
+{
+    if(load_simulated_showers && !shower_array.has_value())
+    {
+        collect_remaining_showers();
+    }
+}
+void SimtelEventSource::collect_remaining_showers()
+{
+    simtel_file_handler->read_remaining_showers();
+    shower_array = SimulatedShowerArray(std::move(simtel_file_handler->shower_array));
+    // The whole file is read now, so the recorded offsets are complete
+    finish_recorded_index();
+}
+void SimtelEventSource::read_all_showers_separately()
+{
+    // The file handler keeps its eventio state per thread, so the second handler is used in a new thread
     auto load_showers = [this]() {
-        auto temp_file_handler = std::make_unique<SimtelFileHandler>(input_filename);
-        SimulatedShowerArray temp_shower_array(simulation_config->n_showers * 20);
-        
-        while(temp_file_handler->only_read_mc_event()) {
-            SimulatedShower shower;
-            shower.energy = temp_file_handler->hsdata->mc_shower.energy;
-            shower.alt = temp_file_handler->hsdata->mc_shower.altitude;
-            shower.az = temp_file_handler->hsdata->mc_shower.azimuth;
-            shower.core_x = temp_file_handler->hsdata->mc_event.xcore;
-            shower.core_y = temp_file_handler->hsdata->mc_event.ycore;
-            shower.h_first_int = temp_file_handler->hsdata->mc_shower.h_first_int;
-            shower.x_max = temp_file_handler->hsdata->mc_shower.xmax;
-            shower.starting_grammage = temp_file_handler->hsdata->mc_shower.depth_start;
-            shower.shower_primary_id = temp_file_handler->hsdata->mc_shower.primary_id;
-            shower.h_max = temp_file_handler->hsdata->mc_shower.hmax;
-            temp_shower_array.push_back(shower);
-        }
-        
-        // Copy the temporary shower array to the main shower array
-        shower_array = std::move(temp_shower_array);
+        auto temp_file_handler = std::make_unique<SimtelFileHandler>(input_filename, read_options);
+        temp_file_handler->shower_array.resize(simulation_config->n_showers * 20);
+        temp_file_handler->read_remaining_showers();
+        shower_array = SimulatedShowerArray(std::move(temp_file_handler->shower_array));
     };
 
     // Launch the loading in a separate thread
@@ -221,14 +258,98 @@ void SimtelEventSource::load_all_simulated_showers()
 }
 bool SimtelEventSource::_load_next_event()
 {
-    return simtel_file_handler->load_next_event();
+    if(simtel_file_handler->load_next_event())
+    {
+        return true;
+    }
+    finish_recorded_index();
+    return false;
+}
+void SimtelEventSource::finish_recorded_index()
+{
+    if(!simtel_file_handler->recorded_index.has_value())
+    {
+        return;
+    }
+    event_index = std::move(*simtel_file_handler->recorded_index);
+    simtel_file_handler->recorded_index.reset();
+    event_index->set_file(input_filename);
+    // Reading a file does not write next to it unless asked for
+    if(read_options.save_event_index)
+    {
+        event_index->save(SimtelEventIndex::sidecar_path(input_filename));
+    }
+    is_stream = false;
+}
+void SimtelEventSource::build_event_index(bool save_sidecar)
+{
+    if(!simtel_file_handler->is_seekable() || !std::filesystem::is_regular_file(input_filename))
+    {
+        throw std::runtime_error("Only uncompressed local simtel files can be indexed: " + input_filename);
+    }
+    event_index = simtel_file_handler->scan_event_index();
+    event_index->set_file(input_filename);
+    simtel_file_handler->recorded_index.reset();
+    if(save_sidecar)
+    {
+        event_index->save(SimtelEventIndex::sidecar_path(input_filename));
+    }
+    is_stream = false;
+}
+std::optional<int> SimtelEventSource::get_event_number(int event_id) const
+{
+    if(!event_index.has_value())
+    {
+        return std::nullopt;
+    }
+    auto event_number = event_index->find_event_id(event_id);
+    if(!event_number.has_value())
+    {
+        return std::nullopt;
+    }
+    return static_cast<int>(*event_number);
+}
+ArrayEvent SimtelEventSource::get_event(int index)
+{
+    if(!event_index.has_value())
+    {
+        throw std::runtime_error("Random access needs an event index, call build_event_index first");
+    }
+    if(index < 0 || static_cast<size_t>(index) >= event_index->size())
+    {
+        throw std::out_of_range("Index out of range");
+    }
+    const auto& entry = (*event_index)[index];
+    // The monitor and calibration blocks before the event are read again unless they are already loaded
+    std::vector<SimtelCalibrationBlock> calibration_blocks;
+    if(loaded_calibration_blocks != static_cast<int64_t>(entry.n_calibration_blocks))
+    {
+        calibration_blocks = event_index->calibration_blocks_before(index);
+    }
+    loaded_calibration_blocks = -1;
+    if(!simtel_file_handler->load_event_at(entry, calibration_blocks))
+    {
+        throw std::runtime_error(fmt::format("Failed to load event {} from {}", index, input_filename));
+    }
+    loaded_calibration_blocks = static_cast<int64_t>(entry.n_calibration_blocks);
+    return read_loaded_event();
 }
 ArrayEvent SimtelEventSource::get_event()
 {
+    // A sequential read may pass new calibration blocks
+    loaded_calibration_blocks = -1;
     if (!_load_next_event()) {
         return ArrayEvent(); // If no more events, return an empty event
     }
-    ArrayEvent event;
+    auto event = read_loaded_event();
+    // Randomly accessed events are not counted, they may be read more than once
+    statistics->fill_1d(event_energy_histogram, std::log10(event.simulation->shower.energy));
+    return event;
+}
+ArrayEvent SimtelEventSource::read_loaded_event()
+{
+    // The levels and telescopes of a recycled event are filled in place
+    ArrayEvent event = acquire_event();
     read_simulated_showers(event);
     if(simtel_file_handler->have_true_image)
     {
@@ -237,105 +358,97 @@ ArrayEvent SimtelEventSource::get_event()
     read_monitor(event);
     read_pointing(event);
     read_adc_samples(event);
-    apply_simtel_calibration(event);
+    if(read_options.compute_r1)
+    {
+        apply_simtel_calibration(event);
+    }
     return event;
 }
 void SimtelEventSource::read_adc_samples(ArrayEvent& event)
 {
-    if(!event.r0) {
-        event.r0 = R0Event();
-    }
+    event.emplace_level<R0Event>();
     for(const  auto tel_id: allowed_tels) {
         auto tel_index = simtel_file_handler->tel_id_to_index[tel_id];
-        if(!simtel_file_handler->hsdata->event.teldata[tel_index].known)
+        const auto& teldata = simtel_file_handler->hsdata->event.teldata[tel_index];
+        if(!teldata.known)
         {
             continue;
         }
-        if(simtel_file_handler->hsdata->event.teldata[tel_index].raw->known)
+        const auto* raw = teldata.raw;
+        if(raw->known)
         {
-            WaveformSumVector high_gain_waveform_sum;
-            WaveformSumVector low_gain_waveform_sum;
-            WaveformMatrix high_gain_waveform;
-            WaveformMatrix low_gain_waveform;
-            // Read ADC samples
-            if(simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_known[0][0] & (1L<<1))
+            const int n_pixels = raw->num_pixels;
+            const int n_samples = raw->num_samples;
+            if(!(raw->adc_known[0][0] & (1L<<1)))
             {
-                high_gain_waveform.resize(simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels, simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_samples);
-                for(int ipixel = 0; ipixel < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels; ipixel++) {
-                    for(int isample = 0; isample < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_samples; isample++) {
-                        high_gain_waveform(ipixel, isample) = simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_sample[0][ipixel][isample];
-                    }
-                }
-                spdlog::debug("ADC samples are available for tel_id: {} for first gain", tel_id);
+                return; // We hope to get the adc samples now(maybe in the future we cam get sum or peak), so now if don't have adc samples just return
             }
-            else 
+            // The buffers of a recycled event are reused, resize keeps the allocation for the same shape
+            auto* r0_camera = event.r0->reuse_tel(tel_id);
+            if(!r0_camera)
             {
-                return; // We hope to get the adc samples now(maybe in the future we cam get sum or peak), so now if don't have adc samples just return
+                continue;
             }
-            if(simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_known[1][0] & (1L<<1))
+            r0_camera->n_pixels = n_pixels;
+            r0_camera->n_samples = n_samples;
+            auto& waveform = r0_camera->waveform;
+            auto& waveform_sum = r0_camera->waveform_sum;
+            // The samples of one pixel are contiguous in hessio, so they are copied row by row
+            auto copy_samples = [&](int igain) {
+                waveform[igain].resize(n_pixels, n_samples);
+                for(int ipixel = 0; ipixel < n_pixels; ipixel++) {
+                    std::memcpy(waveform[igain].row(ipixel).data(), &raw->adc_sample[igain][ipixel][0], n_samples * sizeof(uint16_t));
+                }
+            };
+            // Read ADC samples
+            copy_samples(0);
+            spdlog::debug("ADC samples are available for tel_id: {} for first gain", tel_id);
+            if(raw->adc_known[1][0] & (1L<<1))
             {
-                low_gain_waveform.resize(simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels, simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_samples);
                 spdlog::debug("ADC samples are available for tel_id: {} for second gain", tel_id);
-                for(int ipixel = 0; ipixel < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels; ipixel++) {
-                    for(int isample = 0; isample < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_samples; isample++) {
-                        low_gain_waveform(ipixel, isample) = simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_sample[1][ipixel][isample];
-                    }
-                }
+                copy_samples(1);
+            }
+            else
+            {
+                waveform[1].resize(0, 0);
             }
-            if(simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_known[0][0] & (1L))
+            waveform_sum[0].resize(0);
+            waveform_sum[1].resize(0);
+            if(raw->adc_known[0][0] & (1L))
             {
-                high_gain_waveform_sum.resize(simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels);
+                waveform_sum[0].resize(n_pixels);
                 spdlog::debug("ADC sums are available for tel_id: {} for first gain", tel_id);
-                for(int ipixel = 0;ipixel < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels; ipixel++) {
-                    high_gain_waveform_sum(ipixel) = simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_sum[0][ipixel];
-                }
-                if(simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_known[1][0] & (1L))
+                std::copy(raw->adc_sum[0], raw->adc_sum[0] + n_pixels, waveform_sum[0].data());
+                if(raw->adc_known[1][0] & (1L))
                 {
                     spdlog::debug("ADC sums are available for tel_id: {} for second gain", tel_id);
-                    low_gain_waveform_sum.resize(simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels);
-                    for(int ipixel = 0; ipixel < simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels; ipixel++) {
-                        low_gain_waveform_sum(ipixel) = simtel_file_handler->hsdata->event.teldata[tel_index].raw->adc_sum[1][ipixel];
-                    }
+                    waveform_sum[1].resize(n_pixels);
+                    std::copy(raw->adc_sum[1], raw->adc_sum[1] + n_pixels, waveform_sum[1].data());
                 }
             }
-            // If no adc_sums, it will be nullptr
-            event.r0->add_tel(tel_id,
-                    R0Camera
-                    {
-                        .n_pixels = simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels,
-                        .n_samples = simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_samples,
-                        .waveform = std::array<WaveformMatrix, 2> {std::move(high_gain_waveform), std::move(low_gain_waveform)},
-                        .waveform_sum = std::array<WaveformSumVector, 2> {std::move(high_gain_waveform_sum), std::move(low_gain_waveform_sum)}
-                    }
-                );
         }
     }
 }
 void SimtelEventSource::apply_simtel_calibration(ArrayEvent& event)
 {
-    if(!event.r1) {
-        event.r1 = R1Event();
-    }
+    event.emplace_level<R1Event>();
     for (const auto& [tel_id, r0_tel]: event.r0->tels) {
-        Eigen::Matrix<double, -1, -1, Eigen::RowMajor> r1_waveform;
-        auto gain_selection = Utils::select_gain_channel_by_threshold<uint16_t>(r0_tel->waveform, gain_selector_threshold);
-        int n_pixels = r0_tel->waveform[0].rows();
-        int n_samples = r0_tel->waveform[0].cols();         
-        r1_waveform.resize(n_pixels, n_samples);
-        for(int ipix = 0; ipix < n_pixels; ipix++) {
-            int selected_gain_channel = gain_selection[ipix];
-            for(int isample = 0; isample < n_samples; isample++) {
-                r1_waveform(ipix, isample) = (r0_tel->waveform[selected_gain_channel](ipix, isample) - event.monitor->tels[tel_id]->pedestal_per_sample(selected_gain_channel, ipix)) * event.monitor->tels[tel_id]->dc_to_pe(selected_gain_channel, ipix);
-            }
+        const auto* tel_monitor = event.monitor->get_tel(tel_id);
+        if(!tel_monitor) {
+            throw std::runtime_error("No monitor data for tel_id " + std::to_string(tel_id));
         }
-        event.r1->add_tel(tel_id, R1Camera{n_pixels, n_samples, std::move(r1_waveform), std::move(gain_selection)});
+        // Calibrated into the buffers of a recycled event
+        auto* r1_camera = event.r1->reuse_tel(tel_id);
+        r1_camera->n_pixels = r0_tel->waveform[0].rows();
+        r1_camera->n_samples = r0_tel->waveform[0].cols();
+        const auto& camera_readout = subarray->tels.at(tel_id).camera_description.camera_readout;
+        Utils::select_gain_channel_by_threshold<uint16_t>(r0_tel->waveform, camera_readout.gain_selector_threshold, r1_camera->gain_selection);
+        R1Calibration::calibrate(r0_tel->waveform, r1_camera->gain_selection, *tel_monitor, r1_camera->waveform);
     }
 }
 void SimtelEventSource::read_monitor(ArrayEvent& event)
 {
-    if(!event.monitor) {
-        event.monitor = EventMonitor();
-    }
+    event.emplace_level<EventMonitor>();
     for(const auto& tel_id: allowed_tels) {
         auto tel_index = simtel_file_handler->tel_id_to_index[tel_id];
         if(!simtel_file_handler->hsdata->event.teldata[tel_index].known)
@@ -346,27 +459,33 @@ void SimtelEventSource::read_monitor(ArrayEvent& event)
         {
             auto n_channels = simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_gains;
             auto n_pixels = simtel_file_handler->hsdata->event.teldata[tel_index].raw->num_pixels;
-            Eigen::Matrix<double, -1, -1, Eigen::RowMajor> pedestal_per_sample(n_channels, n_pixels);
-            for(int ich = 0; ich < n_channels; ich++) {
-                for(int ipix = 0; ipix < n_pixels; ipix++) {
-                    pedestal_per_sample(ich, ipix) = simtel_file_handler->hsdata->tel_moni[tel_index].pedsamp[ich][ipix];
+            auto version = simtel_file_handler->monitor_version[tel_index];
+            // Only build a new TelMonitor if the monitor or calibration blocks changed
+            auto& cached = monitor_cache[tel_id];
+            if(!cached.monitor || cached.version != version || cached.monitor->n_channels != n_channels || cached.monitor->n_pixels != n_pixels)
+            {
+                Eigen::Matrix<double, -1, -1, Eigen::RowMajor> pedestal_per_sample(n_channels, n_pixels);
+                for(int ich = 0; ich < n_channels; ich++) {
+                    for(int ipix = 0; ipix < n_pixels; ipix++) {
+                        pedestal_per_sample(ich, ipix) = simtel_file_handler->hsdata->tel_moni[tel_index].pedsamp[ich][ipix];
+                    }
                 }
-            }
-            Eigen::Matrix<double, -1, -1, Eigen::RowMajor> dc_to_pe(n_channels, n_pixels);
-            for(int ich = 0; ich < n_channels; ich++) {
-                for(int ipix = 0; ipix < n_pixels; ipix++) {
-                    dc_to_pe(ich, ipix) = simtel_file_handler->hsdata->tel_lascal[tel_index].calib[ich][ipix];
+                Eigen::Matrix<double, -1, -1, Eigen::RowMajor> dc_to_pe(n_channels, n_pixels);
+                for(int ich = 0; ich < n_channels; ich++) {
+                    for(int ipix = 0; ipix < n_pixels; ipix++) {
+                        dc_to_pe(ich, ipix) = simtel_file_handler->hsdata->tel_lascal[tel_index].calib[ich][ipix];
+                    }
                 }
+                cached.monitor = std::make_shared<const TelMonitor>(TelMonitor{.n_channels = n_channels, .n_pixels = n_pixels, .pedestal_per_sample = std::move(pedestal_per_sample), .dc_to_pe = std::move(dc_to_pe)});
+                cached.version = version;
             }
-            event.monitor->add_tel(tel_id, TelMonitor{.n_channels = n_channels, .n_pixels = n_pixels, .pedestal_per_sample = std::move(pedestal_per_sample), .dc_to_pe = std::move(dc_to_pe)});
+            event.monitor->add_tel(tel_id, cached.monitor);
         }
     }
 }
 void SimtelEventSource::read_pointing(ArrayEvent& event)
 {
-    if(!event.pointing) {
-        event.pointing = Pointing();
-    }
+    event.emplace_level<Pointing>();
     for(const auto& tel_id: allowed_tels) {
         auto tel_index = simtel_file_handler->tel_id_to_index[tel_id];
         if(simtel_file_handler->hsdata->event.trackdata[tel_index].cor_known)
@@ -390,7 +509,7 @@ void SimtelEventSource::read_true_image(ArrayEvent& event)
 {
     for(const auto& tel_id: allowed_tels) {
             auto tel_index = simtel_file_handler->tel_id_to_index[tel_id];
-            auto tel_position = subarray->tel_positions[tel_id];
+            auto tel_position = subarray->tel_positions.at(tel_id);
             auto shower_core = std::array<double, 3>{event.simulation->shower.core_x, event.simulation->shower.core_y, 0};
             double cos_alt = cos(event.simulation->shower.alt);
             double sin_alt = sin(event.simulation->shower.alt);
@@ -409,9 +528,16 @@ void SimtelEventSource::read_true_image(ArrayEvent& event)
             {
                 continue;
             }
-            Eigen::VectorXi true_image = Eigen::VectorXi{Eigen::Map<Eigen::VectorXi>(simtel_file_handler->hsdata->mc_event.mc_pe_list[tel_index].pe_count, n_pixels)};
+            auto* simulated_camera = event.simulation->reuse_tel(tel_id);
+            if(!simulated_camera)
+            {
+                continue;
+            }
+            // Only the true image buffer is reused, the rest is filled later by the ImageProcessor
+            Eigen::VectorXi true_image = std::move(simulated_camera->true_image);
+            true_image = Eigen::Map<Eigen::VectorXi>(simtel_file_handler->hsdata->mc_event.mc_pe_list[tel_index].pe_count, n_pixels);
             int image_sum = true_image.sum();
-            event.simulation->add_tel(tel_id, SimulatedCamera{.true_image_sum = image_sum, .true_image= std::move(true_image), .impact_parameter = impact_parameter}); 
+            *simulated_camera = SimulatedCamera{.true_image_sum = image_sum, .true_image= std::move(true_image), .impact_parameter = impact_parameter};
             /*
             event.simulation->tels.at(tel_id)->pe_amplitude = Eigen::VectorXd(Eigen::Map<Eigen::VectorXd>(simtel_file_handler->hsdata->mc_event.mc_pe_list[tel_index].amplitudes, npe));
             event.simulation->tels.at(tel_id)->pe_time = Eigen::VectorXd(Eigen::Map<Eigen::VectorXd>(simtel_file_handler->hsdata->mc_event.mc_pe_list[tel_index].atimes, npe));
@@ -433,9 +559,7 @@ void SimtelEventSource::read_true_image(ArrayEvent& event)
 }
 void SimtelEventSource::read_simulated_showers(ArrayEvent& event)
 {
-    if(!event.simulation) {
-        event.simulation = SimulatedEvent();
-    }
+    event.emplace_level<SimulatedEvent>();
     event.run_id = simtel_file_handler->hsdata->run_header.run;
     event.event_id = simtel_file_handler->hsdata->mc_event.event;
     event.simulation->shower.shower_primary_id = simtel_file_handler->hsdata->mc_shower.primary_id;
@@ -27,7 +27,7 @@ Finally<Func> finally(Func func) { return {func}; }
 
 const std::string ihep_url = "root://eos01.ihep.ac.cn:/";
 using std::string;
-SimtelFileHandler::SimtelFileHandler(const std::string& filename) : filename(filename) {
+SimtelFileHandler::SimtelFileHandler(const std::string& filename, SimtelReadOptions options) : filename(filename), read_options(options) {
     SPDLOG_TRACE("SimtelFileHandler constructor ");
     if((iobuf = allocate_io_buffer(5000000L)) == NULL) {
         throw std::runtime_error("Cannot allocate I/O buffer");
@@ -92,12 +92,13 @@ void SimtelFileHandler::open_file(const std::string& filename) {
     int res;
     if (filename.substr(0, 4) == "/eos") {
         // If filename starts with "eos", prepend the IHEP URL
-        res = EventIOHandler_init(filename.c_str(), 'r', ihep_url.c_str());
+        res = EventIOHandler_init_prefetch(filename.c_str(), 'r', ihep_url.c_str(), read_options.prefetch_depth,
+                                           read_options.prefetch_buffer_size, read_options.max_prefetch_memory);
     }
     else
     {
-        
-        res = EventIOHandler_init(filename.c_str(), 'r', "");
+        res = EventIOHandler_init_prefetch(filename.c_str(), 'r', "", read_options.prefetch_depth,
+                                           read_options.prefetch_buffer_size, read_options.max_prefetch_memory);
     }
     if(res != 0)
     {
@@ -119,11 +120,117 @@ std::optional<int> SimtelFileHandler::get_tel_index (int tel_id) const
 }
 void SimtelFileHandler::find_block() {
     if(no_more_blocks) return;
+    int64_t offset = recorded_index.has_value() ? tell() : -1;
     if(find_io_block(iobuf, &item_header) != 0) {
         SPDLOG_DEBUG("No more blocks");
         no_more_blocks = true;
         return;
     }
+    if(recorded_index.has_value()) {
+        record_block_offset(*recorded_index, offset);
+    }
+}
+bool SimtelFileHandler::is_seekable() const {
+    return tell() >= 0;
+}
+int64_t SimtelFileHandler::tell() const {
+#ifndef HAVE_EVENTIO_EXTENSION
+    // ftell fails for the pipes used by fileopen for compressed files
+    return input_file != NULL ? ftell(input_file) : -1;
+#else
+    return EventIOHandler_tell();
+#endif
+}
+void SimtelFileHandler::seek(int64_t offset) {
+#ifndef HAVE_EVENTIO_EXTENSION
+    int rc = input_file != NULL ? fseek(input_file, offset, SEEK_SET) : -1;
+#else
+    int rc = EventIOHandler_seek(offset);
+#endif
+    if(rc != 0) {
+        throw std::runtime_error(spdlog::fmt_lib::format("Failed to seek to offset {} in {}", offset, filename));
+    }
+    no_more_blocks = false;
+}
+void SimtelFileHandler::record_block_offset(SimtelEventIndex& index, int64_t offset) {
+    switch(static_cast<BlockType>(item_header.type)) {
+        case BlockType::Mc_Shower:
+            pending_index_entry.shower_offset = offset;
+            break;
+        case BlockType::Mc_Event:
+            pending_index_entry.mc_event_offset = offset;
+            break;
+        case BlockType::TelescopeMonitor:
+        case BlockType::LaserCalibration:
+        case BlockType::PixelMonitor:
+            index.add_calibration_block({item_header.type, item_header.ident, offset});
+            break;
+        case BlockType::SimtelEvent:
+            pending_index_entry.event_id = item_header.ident;
+            pending_index_entry.event_offset = offset;
+            pending_index_entry.n_calibration_blocks = index.n_calibration_blocks();
+            index.add_event(pending_index_entry);
+            break;
+        default:
+            break;
+    }
+}
+void SimtelFileHandler::start_recording_event_index() {
+    recorded_index = SimtelEventIndex();
+    pending_index_entry = SimtelEventIndexEntry();
+}
+SimtelEventIndex SimtelFileHandler::scan_event_index() {
+    auto position = tell();
+    if(position < 0) {
+        throw std::runtime_error("Can not index a file that is not seekable: " + filename);
+    }
+    bool saved_no_more_blocks = no_more_blocks;
+    auto saved_entry = pending_index_entry;
+    SimtelEventIndex index;
+    pending_index_entry = SimtelEventIndexEntry();
+    seek(0);
+    while(true) {
+        auto offset = tell();
+        if(find_io_block(iobuf, &item_header) != 0) {
+            break;
+        }
+        record_block_offset(index, offset);
+        skip_block();
+        if(no_more_blocks) {
+            break;
+        }
+    }
+    seek(position);
+    no_more_blocks = saved_no_more_blocks;
+    pending_index_entry = saved_entry;
+    return index;
+}
+bool SimtelFileHandler::load_event_at(const SimtelEventIndexEntry& entry, const std::vector<SimtelCalibrationBlock>& calibration_blocks) {
+    if(entry.shower_offset < 0 || entry.mc_event_offset < 0 || entry.event_offset < 0) {
+        return false;
+    }
+    // The offsets recorded from here on would not follow the file order
+    recorded_index.reset();
+    for(const auto& block: calibration_blocks) {
+        seek(block.offset);
+        find_block();
+        if(no_more_blocks || item_header.type != block.type) {
+            return false;
+        }
+        read_block();
+        block_handler[static_cast<BlockType>(item_header.type)]();
+    }
+    // Reading the shower again must not add it to the shower_array
+    bool saved_collect_showers = collect_showers;
+    collect_showers = false;
+    auto restore = finally([this, saved_collect_showers](){collect_showers = saved_collect_showers;});
+    seek(entry.shower_offset);
+    read_until_event();
+    if(no_more_blocks) {
+        return false;
+    }
+    seek(entry.mc_event_offset);
+    return load_next_event();
 }
 void SimtelFileHandler::skip_block() {
     if(no_more_blocks) return;
@@ -193,6 +300,10 @@ bool SimtelFileHandler::only_read_mc_event() {
     if(no_more_blocks) return false;
     return true;
 }
+void SimtelFileHandler::read_remaining_showers() {
+    while(only_read_mc_event()) {
+    }
+}
 void SimtelFileHandler::read_until_event() {
     read_until_block(BlockType::Mc_Shower);
     read_block();
@@ -463,7 +574,9 @@ void SimtelFileHandler::_read_mc_event() {
             shower.starting_grammage = hsdata->mc_shower.depth_start;
             shower.shower_primary_id = hsdata->mc_shower.primary_id;
             shower.h_max = hsdata->mc_shower.hmax;
-    shower_array.push_back(shower);
+    if(collect_showers) {
+        shower_array.push_back(shower);
+    }
 }
 void SimtelFileHandler::_read_pixel_monitor() {
     LOG_SCOPE("Read pixel monitor block");
@@ -495,6 +608,7 @@ void SimtelFileHandler::_read_telescope_monitor() {
         spdlog::error("Failed to read telescope monitor");
         throw std::runtime_error("Failed to read telescope monitor");
     }
+    monitor_version[itel]++;
 }
 void SimtelFileHandler::_read_true_image() {
     if(!have_true_image)
@@ -523,6 +637,7 @@ void SimtelFileHandler::_read_laser_calibration() {
         spdlog::error("Failed to read laser calibration");
         throw std::runtime_error("Failed to read laser calibration");
     }
+    monitor_version[itel]++;
 }
 void SimtelFileHandler::_read_mc_pesum() {
     LOG_SCOPE("Read mc pesum block");
@@ -537,13 +652,105 @@ void SimtelFileHandler::_read_simtel_event() {
     LOG_SCOPE("Read simtel event block");
     int event_id = item_header.ident;
     spdlog::debug("Read simtel event for event_id: {}", event_id);
-    // One should known that all telescopes are read out here, 
-    // so we should skip afterwards
-    if(read_simtel_event(iobuf, &hsdata->event, -1) != 0) {
+    // Without a telescope selection all telescopes are read out here
+    int rc = selected_tel_index.empty() ? read_simtel_event(iobuf, &hsdata->event, -1) : read_selected_simtel_event();
+    if(rc != 0) {
         spdlog::error("Failed to read simtel event");
         throw std::runtime_error("Failed to read simtel event");
     }
 }
+void SimtelFileHandler::set_telescope_selection(const std::vector<int>& tel_ids) {
+    selected_tel_index.clear();
+    if(tel_ids.empty()) {
+        return;
+    }
+    selected_tel_index.assign(tel_id_to_index.size(), false);
+    for(const auto tel_id: tel_ids) {
+        auto tel_index = get_tel_index(tel_id);
+        if(!tel_index.has_value()) {
+            spdlog::warn("Telescope {} is not in the run header, it can not be selected", tel_id);
+            continue;
+        }
+        selected_tel_index[*tel_index] = true;
+    }
+}
+/**
+ * @brief Telescope id of a per-telescope sub-block type, e.g. IO_TYPE_SIMTEL_TELEVENT,
+ *        the type is base + tel_id%100 + 1000*(tel_id/100)
+ */
+static std::optional<int> subitem_tel_id(int type, int base) {
+    int offset = type - base;
+    if(offset < 0 || offset % 1000 >= 100) {
+        return std::nullopt;
+    }
+    return offset % 100 + 100 * (offset / 1000);
+}
+int SimtelFileHandler::read_selected_simtel_event() {
+    FullEvent& event = hsdata->event;
+    IO_ITEM_HEADER event_header;
+    event_header.type = IO_TYPE_SIMTEL_EVENT;
+    int rc = get_item_begin(iobuf, &event_header);
+    if(rc < 0) {
+        return rc;
+    }
+    // Same version check and per-event reset as read_simtel_event
+    if(event_header.version > 0) {
+        spdlog::error("Unsupported simtel event version: {}", event_header.version);
+        get_item_end(iobuf, &event_header);
+        return -1;
+    }
+    event.central.glob_count = 0;
+    event.central.teltrg_pattern = 0;
+    event.central.teldata_pattern = 0;
+    event.central.num_teltrg = 0;
+    event.central.num_teldata = 0;
+    event.num_teldata = 0;
+    event.shower.known = 0;
+    for(auto itel = 0; itel < hsdata->run_header.ntel; itel++) {
+        event.teldata[itel].known = 0;
+        event.trackdata[itel].raw_known = 0;
+        event.trackdata[itel].cor_known = 0;
+    }
+    while(true) {
+        int type = next_subitem_type(iobuf);
+        if(type <= 0) {
+            break;
+        }
+        auto televent_tel_id = subitem_tel_id(type, IO_TYPE_SIMTEL_TELEVENT);
+        auto track_tel_id = subitem_tel_id(type, IO_TYPE_SIMTEL_TRACKEVENT);
+        if(type == IO_TYPE_SIMTEL_CENTEVENT) {
+            rc = read_simtel_centralevent(iobuf, &event.central);
+        }
+        else if(type == IO_TYPE_SIMTEL_SHOWER) {
+            rc = read_simtel_shower(iobuf, &event.shower);
+        }
+        else if(televent_tel_id.has_value() || track_tel_id.has_value()) {
+            int tel_id = televent_tel_id.has_value() ? *televent_tel_id : *track_tel_id;
+            auto tel_index = get_tel_index(tel_id);
+            if(!tel_index.has_value() || !selected_tel_index[*tel_index]) {
+                rc = skip_subitem(iobuf);
+            }
+            else if(televent_tel_id.has_value()) {
+                rc = read_simtel_televent(iobuf, &event.teldata[*tel_index], -1);
+                if(rc >= 0) {
+                    event.teldata_list[event.num_teldata++] = tel_id;
+                }
+            }
+            else {
+                rc = read_simtel_track(iobuf, &event.trackdata[*tel_index]);
+            }
+        }
+        else {
+            spdlog::debug("Skip unknown sub-block type {} in simtel event", type);
+            rc = skip_subitem(iobuf);
+        }
+        if(rc < 0) {
+            get_item_end(iobuf, &event_header);
+            return rc;
+        }
+    }
+    return get_item_end(iobuf, &event_header);
+}
 void SimtelFileHandler::handle_history() {
     handle_block<BlockType::History>("history",[this]() {_read_history();});
 }
@@ -1,5 +1,6 @@
 #include "SubarrayDescription.hh"
 #include "spdlog/spdlog.h"
+#include <cmath>
 
 const string TelescopeDescription::print() const
 {
@@ -25,6 +26,36 @@ std::vector<telescope_id_t> SubarrayDescription::get_ordered_telescope_ids() con
     std::sort(ordered_tel_ids.begin(), ordered_tel_ids.end());
     return ordered_tel_ids;
 }
+bool SubarrayDescription::is_compatible(const SubarrayDescription& other) const
+{
+    if(tels.size() != other.tels.size())
+    {
+        return false;
+    }
+    for(const auto& [tel_id, tel_description] : tels)
+    {
+        auto other_tel = other.tels.find(tel_id);
+        if(other_tel == other.tels.end())
+        {
+            return false;
+        }
+        if(tel_description.camera_description.camera_name != other_tel->second.camera_description.camera_name ||
+           tel_description.optics_description.optics_name != other_tel->second.optics_description.optics_name)
+        {
+            return false;
+        }
+        const auto& position = tel_positions.at(tel_id);
+        const auto& other_position = other.tel_positions.at(tel_id);
+        for(int i = 0; i < 3; i++)
+        {
+            if(std::abs(position[i] - other_position[i]) > 1e-6)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 const string SubarrayDescription::print() const
 {
     return fmt::format("SubarrayDescription:\n  tel_descriptions: <dict[tel_id, TelescopeDescription]>\n  tel_positions: <dict[tel_id, array<double,3>]>\n  reference_position: <array<double,3>>\n");
@@ -0,0 +1,123 @@
+#include "ThreadPool.hh"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace {
+// State of one parallel_for call, shared with the helper tasks
+struct ParallelForJob {
+    ParallelForJob(size_t n, const std::function<void(size_t)>& body): n(n), body(body) {}
+    size_t n;
+    const std::function<void(size_t)>& body;
+    std::atomic<size_t> next = 0;
+    size_t done = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable all_done;
+
+    void run()
+    {
+        size_t i;
+        while((i = next.fetch_add(1)) < n)
+        {
+            std::exception_ptr task_error;
+            try {
+                body(i);
+            }
+            catch(...) {
+                task_error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if(task_error && !error)
+            {
+                error = task_error;
+            }
+            if(++done == n)
+            {
+                all_done.notify_all();
+            }
+        }
+    }
+};
+}
+
+ThreadPool::ThreadPool(size_t n_threads)
+{
+    for(size_t i = 0; i < n_threads; i++)
+    {
+        threads.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        stop = true;
+    }
+    tasks_not_empty.notify_all();
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::worker_loop()
+{
+    while(true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            tasks_not_empty.wait(lock, [this]() { return stop || !tasks.empty(); });
+            if(stop && tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t)>& body)
+{
+    if(n == 0)
+    {
+        return;
+    }
+    if(n == 1 || threads.empty())
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            body(i);
+        }
+        return;
+    }
+    auto job = std::make_shared<ParallelForJob>(n, body);
+    size_t n_helpers = std::min(n - 1, threads.size());
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        for(size_t i = 0; i < n_helpers; i++)
+        {
+            // A helper starting after all indices are taken returns without touching body
+            tasks.emplace_back([job]() { job->run(); });
+        }
+    }
+    tasks_not_empty.notify_all();
+    job->run();
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->all_done.wait(lock, [&job]() { return job->done == job->n; });
+    if(job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
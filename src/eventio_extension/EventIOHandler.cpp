@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include "CompressionHandler/GzipHandler.h"
@@ -9,8 +10,38 @@
 #include "CompressionHandler/LocalFileHandler.h"
 #include "CompressionHandler/XRootDHandler.h"
 
+namespace {
+const unsigned char sync_tag_byte[] = {0xD4, 0x1F, 0x8A, 0x37};
+const unsigned char sync_tag_byte_reversed[] = {0x37, 0x8A, 0x1F, 0xD4};
+
+/*
+ * Return the first position in [begin, end) where a sync tag in either byte
+ * order starts, the whole tag must lie in [begin, end).
+ */
+const unsigned char* find_sync_tag(const unsigned char* begin, const unsigned char* end) {
+    const unsigned char* p = begin;
+    while (end - p >= 4) {
+        size_t n = static_cast<size_t>(end - p) - 3;
+        auto le = static_cast<const unsigned char*>(std::memchr(p, sync_tag_byte_reversed[0], n));
+        auto be = static_cast<const unsigned char*>(std::memchr(p, sync_tag_byte[0], n));
+        const unsigned char* candidate = le == nullptr ? be : (be == nullptr ? le : std::min(le, be));
+        if (candidate == nullptr) {
+            return nullptr;
+        }
+        if (std::memcmp(candidate, sync_tag_byte_reversed, 4) == 0 ||
+            std::memcmp(candidate, sync_tag_byte, 4) == 0) {
+            return candidate;
+        }
+        p = candidate + 1;
+    }
+    return nullptr;
+}
+}  // namespace
+
 EventIOHandler::EventIOHandler(const std::string& fname, const char mode,
-                               const std::string& url) {
+                               const std::string& url, size_t readahead_size,
+                               size_t prefetch_depth, size_t prefetch_buffer_size,
+                               size_t max_prefetch_memory) {
     if (fname.find("/eos") == 0) {
         fileHandler_ = std::make_unique<XRootDFileHandler>(url + fname, mode);
     } else {
@@ -23,6 +54,13 @@ EventIOHandler::EventIOHandler(const std::string& fname, const char mode,
     } else {
         compressionHandler_ = nullptr;
     }
+    if (mode == 'r' && readahead_size > 0) {
+        readahead_.resize(readahead_size);
+    }
+    if (mode == 'r' && compressionHandler_ != nullptr && prefetch_depth > 0 && prefetch_buffer_size > 0) {
+        size_t depth = std::min(prefetch_depth, max_prefetch_memory / prefetch_buffer_size);
+        start_prefetch(std::max<size_t>(depth, 1), prefetch_buffer_size);
+    }
 }
 bool EventIOHandler::endsWith(const std::string& str, const std::string& suffix) {
     return str.size() >= suffix.size() &&
@@ -30,12 +68,97 @@ bool EventIOHandler::endsWith(const std::string& str, const std::string& suffix)
 }
 
 size_t EventIOHandler::read(unsigned char* buffer, size_t size) {
+    if (readahead_.empty()) {
+        return source_read(buffer, size);
+    }
+    size_t copied = std::min(size, buffered());
+    std::memcpy(buffer, readahead_.data() + readahead_pos_, copied);
+    readahead_pos_ += copied;
+    if (copied == size) {
+        return copied;
+    }
+    // Large reads bypass the read-ahead buffer, small ones refill it first
+    if (size - copied >= readahead_.size()) {
+        return copied + source_read(buffer + copied, size - copied);
+    }
+    size_t rest = std::min(size - copied, fill_readahead(size - copied));
+    std::memcpy(buffer + copied, readahead_.data() + readahead_pos_, rest);
+    readahead_pos_ += rest;
+    return copied + rest;
+}
+size_t EventIOHandler::raw_read(unsigned char* buffer, size_t size) {
     if (compressionHandler_ == nullptr) {
         return fileHandler_->read(buffer, size);
     } else {
         return compressionHandler_->read(buffer, size);
     }
 }
+size_t EventIOHandler::fill_readahead(size_t min_bytes) {
+    if (buffered() >= min_bytes) {
+        return buffered();
+    }
+    // Keep the unread tail at the front of the buffer
+    size_t remaining = buffered();
+    if (readahead_pos_ > 0) {
+        std::memmove(readahead_.data(), readahead_.data() + readahead_pos_, remaining);
+        readahead_pos_ = 0;
+        readahead_end_ = remaining;
+    }
+    while (readahead_end_ < min_bytes) {
+        size_t nread = source_read(readahead_.data() + readahead_end_, readahead_.size() - readahead_end_);
+        if (nread == 0) {
+            break;
+        }
+        readahead_end_ += nread;
+    }
+    return buffered();
+}
+size_t EventIOHandler::source_read(unsigned char* buffer, size_t size) {
+    size_t nread = 0;
+    if (prefetch_thread_.joinable()) {
+        nread = ring_read(buffer, size);
+    } else if (!read_error_) {
+        // Same as on the prefetch thread, the failure ends the input and is reported as a read error
+        try {
+            nread = raw_read(buffer, size);
+        } catch (const std::exception& e) {
+            std::cerr << "EventIOHandler: decompression failed: " << e.what() << "\n";
+            read_error_ = true;
+        }
+    }
+    source_offset_ += nread;
+    return nread;
+}
+long EventIOHandler::tell() const {
+    if (compressionHandler_ != nullptr) {
+        return -1;
+    }
+    return static_cast<long>(source_offset_ - buffered());
+}
+int EventIOHandler::seek(long offset) {
+    if (compressionHandler_ != nullptr || offset < 0) {
+        return -1;
+    }
+    readahead_pos_ = readahead_end_ = 0;
+    source_offset_ = static_cast<size_t>(offset);
+    return fileHandler_->seek(offset, SEEK_SET);
+}
+bool EventIOHandler::source_exhausted() {
+    if (prefetch_thread_.joinable()) {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        return ring_eof_ && !ring_error_ && ring_count_ == 0;
+    }
+    return !read_error_ && raw_source_exhausted();
+}
+bool EventIOHandler::raw_source_exhausted() const {
+    if (!fileHandler_->IsEnd()) {
+        return false;
+    }
+    if (compressionHandler_ != nullptr) {
+        return !(compressionHandler_->have_leftover() || compressionHandler_->have_uncompressed());
+    }
+    return true;
+}
 size_t EventIOHandler::write(unsigned char* buffer, size_t size) {
     if (compressionHandler_ == nullptr) {
         return fileHandler_->write(buffer, size);
@@ -44,21 +167,42 @@ size_t EventIOHandler::write(unsigned char* buffer, size_t size) {
     }
 }
 int EventIOHandler::seek_current(size_t bytes) {
+    size_t skipped = std::min(bytes, buffered());
+    readahead_pos_ += skipped;
+    bytes -= skipped;
+    if (bytes == 0) {
+        return 0;
+    }
     /*
    * Check whether we can just use seek
    */
     if (compressionHandler_ == nullptr) {
         fileHandler_->seek(bytes, SEEK_CUR);
+        source_offset_ += bytes;
+        return 0;
+    }
+    if (!readahead_.empty()) {
+        // Decompress through the (now empty) read-ahead buffer and drop the data
+        while (bytes > 0) {
+            size_t nread = source_read(readahead_.data(), std::min(bytes, readahead_.size()));
+            if (nread == 0) {
+                break;
+            }
+            bytes -= nread;
+        }
+        readahead_pos_ = readahead_end_ = 0;
     } else {
         unsigned char tbuf[512];
-        auto nbuf = bytes / 512;
-        auto rbuf = bytes % 512;
-        for (int i = 0; i < nbuf; i++) {
-            compressionHandler_->read(tbuf, 512);
+        while (bytes > 0) {
+            size_t nread = source_read(tbuf, std::min(bytes, sizeof(tbuf)));
+            if (nread == 0) {
+                break;
+            }
+            bytes -= nread;
         }
-        compressionHandler_->read(tbuf, rbuf);
     }
-    return 0;
+    // The compressed input ended inside the skipped bytes
+    return bytes == 0 ? 0 : -1;
 }
 /*
  *
@@ -80,55 +224,11 @@ int EventIOHandler::user_function2(unsigned char* buffer, long size) {
     /*
    * find the header and read bytes
    */
-    const unsigned char sync_tag_byte[] = {0xD4, 0x1F, 0x8A, 0x37};
     if (size == 16) {
-        long sync_count = 0;
-        int block_found, byte_number, byte_order = 0;
-        int rc;
-        for (sync_count = -4L, block_found = byte_number = byte_order = 0;
-             !block_found; sync_count++) {
-            rc = read(buffer + byte_number, 1);
-            if (rc <= 0) {
-                if (fileHandler_->IsEnd()) {
-                    return -2;
-                } else {
-                    return -1;
-                }
-            }
-            if (byte_order == 0) {
-                if (*buffer == sync_tag_byte[0]) {
-                    byte_order = 1;
-                } else if (*buffer == sync_tag_byte[3]) {
-                    byte_order = -1;
-                } else {
-                    continue;
-                }
-                byte_number = 1;
-            } else if (byte_order == 1) {
-                if (buffer[byte_number] != sync_tag_byte[byte_number]) {
-                    byte_number = byte_order = 0;
-                    continue;
-                }
-                byte_number++;
-            } else if (byte_order == -1) {
-                if (buffer[byte_number] != sync_tag_byte[3 - byte_number]) {
-                    byte_number = byte_order = 0;
-                    continue;
-                }
-                byte_number++;
-            }
-            if (byte_number == 4) {
-                block_found = 1;
-            }
+        if (readahead_.empty()) {
+            return find_header_bytewise(buffer);
         }
-        rc = read(buffer + 4, 12);
-        if (rc != 12) {
-            return -1;
-        }
-        if (sync_count > 0) {
-            std::cout << "Skipping " << sync_count << " bytes \n";
-        }
-        return 16;
+        return find_header_buffered(buffer);
     } else if (size == 4) {
 
         int rc;
@@ -141,31 +241,183 @@ int EventIOHandler::user_function2(unsigned char* buffer, long size) {
         return -1;
     }
 }
+int EventIOHandler::find_header_buffered(unsigned char* buffer) {
+    long sync_count = 0;
+    const unsigned char* tag = nullptr;
+    while (tag == nullptr) {
+        if (fill_readahead(4) < 4) {
+            return source_exhausted() ? -2 : -1;
+        }
+        const unsigned char* begin = readahead_.data() + readahead_pos_;
+        const unsigned char* end = readahead_.data() + readahead_end_;
+        tag = find_sync_tag(begin, end);
+        if (tag == nullptr) {
+            // The last three bytes could still be the start of a tag
+            sync_count += (end - begin) - 3;
+            readahead_pos_ = readahead_end_ - 3;
+            if (fill_readahead(buffered() + 1) <= 3) {
+                return source_exhausted() ? -2 : -1;
+            }
+        } else {
+            sync_count += tag - begin;
+            readahead_pos_ += tag - begin;
+        }
+    }
+    if (fill_readahead(16) < 16) {
+        return -1;
+    }
+    std::memcpy(buffer, readahead_.data() + readahead_pos_, 16);
+    readahead_pos_ += 16;
+    if (sync_count > 0) {
+        std::cout << "Skipping " << sync_count << " bytes \n";
+    }
+    return 16;
+}
+int EventIOHandler::find_header_bytewise(unsigned char* buffer) {
+    long sync_count = 0;
+    int block_found, byte_number, byte_order = 0;
+    int rc;
+    for (sync_count = -4L, block_found = byte_number = byte_order = 0;
+         !block_found; sync_count++) {
+        rc = read(buffer + byte_number, 1);
+        if (rc <= 0) {
+            return source_exhausted() ? -2 : -1;
+        }
+        if (byte_order == 0) {
+            if (*buffer == sync_tag_byte[0]) {
+                byte_order = 1;
+            } else if (*buffer == sync_tag_byte[3]) {
+                byte_order = -1;
+            } else {
+                continue;
+            }
+            byte_number = 1;
+        } else if (byte_order == 1) {
+            if (buffer[byte_number] != sync_tag_byte[byte_number]) {
+                byte_number = byte_order = 0;
+                continue;
+            }
+            byte_number++;
+        } else if (byte_order == -1) {
+            if (buffer[byte_number] != sync_tag_byte[3 - byte_number]) {
+                byte_number = byte_order = 0;
+                continue;
+            }
+            byte_number++;
+        }
+        if (byte_number == 4) {
+            block_found = 1;
+        }
+    }
+    rc = read(buffer + 4, 12);
+    if (rc != 12) {
+        return -1;
+    }
+    if (sync_count > 0) {
+        std::cout << "Skipping " << sync_count << " bytes \n";
+    }
+    return 16;
+}
 int EventIOHandler::user_function3(unsigned char* buffer, long size) {
     auto bytesread = read(buffer, static_cast<size_t>(size));
-    if (bytesread == static_cast<size_t>(size)) {
+    // The block header announced size bytes, a shorter block is a truncated input and not the end of the file
+    return bytesread == static_cast<size_t>(size) ? 0 : -1;
+}
+int EventIOHandler::user_function4(unsigned char* buffer, long size) {
+    if (seek_current(static_cast<size_t>(size)) != 0) {
+        return -1;
+    }
+    if (buffered() > 0) {
         return 0;
-    } else {
-        if (fileHandler_->IsEnd()) {
-            return -2;
-        } else {
-            return -1;
+    }
+    return source_exhausted() ? -2 : 0;
+}
+void EventIOHandler::start_prefetch(size_t depth, size_t buffer_size) {
+    ring_.resize(depth);
+    for (auto& chunk : ring_) {
+        chunk.data.resize(buffer_size);
+    }
+    prefetch_thread_ = std::thread(&EventIOHandler::prefetch_loop, this);
+}
+void EventIOHandler::stop_prefetch() {
+    if (!prefetch_thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        ring_stop_ = true;
+    }
+    ring_not_full_.notify_all();
+    prefetch_thread_.join();
+}
+void EventIOHandler::prefetch_loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(ring_mutex_);
+            ring_not_full_.wait(lock, [this] { return ring_stop_ || ring_count_ < ring_.size(); });
+            if (ring_stop_) {
+                return;
+            }
+        }
+        // The tail chunk is not visible to the consumer until ring_count_ is increased
+        auto& chunk = ring_[ring_tail_];
+        chunk.size = 0;
+        bool failed = false;
+        try {
+            while (chunk.size < chunk.data.size()) {
+                size_t nread = raw_read(chunk.data.data() + chunk.size, chunk.data.size() - chunk.size);
+                if (nread == 0) {
+                    break;
+                }
+                chunk.size += nread;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "EventIOHandler: decompression failed: " << e.what() << "\n";
+            failed = true;
+        }
+        bool finished = failed || chunk.size < chunk.data.size();
+        {
+            std::lock_guard<std::mutex> lock(ring_mutex_);
+            if (chunk.size > 0) {
+                ring_tail_ = (ring_tail_ + 1) % ring_.size();
+                ring_count_++;
+            }
+            if (finished) {
+                ring_eof_ = true;
+                ring_error_ = failed || !raw_source_exhausted();
+            }
+        }
+        ring_not_empty_.notify_one();
+        if (finished) {
+            return;
         }
     }
 }
-int EventIOHandler::user_function4(unsigned char* buffer, long size) {
-    seek_current(static_cast<size_t>(size));
-    if (fileHandler_->IsEnd()) {
-        if(compressionHandler_ != nullptr) {
-            if(compressionHandler_->have_leftover() || compressionHandler_->have_uncompressed()) {
-                return 0;
+size_t EventIOHandler::ring_read(unsigned char* buffer, size_t size) {
+    size_t copied = 0;
+    while (copied < size) {
+        {
+            std::unique_lock<std::mutex> lock(ring_mutex_);
+            ring_not_empty_.wait(lock, [this] { return ring_count_ > 0 || ring_eof_; });
+            if (ring_count_ == 0) {
+                break;
             }
-            else
+        }
+        // The head chunk is owned by the consumer while ring_count_ > 0
+        auto& chunk = ring_[ring_head_];
+        size_t n = std::min(size - copied, chunk.size - ring_offset_);
+        std::memcpy(buffer + copied, chunk.data.data() + ring_offset_, n);
+        ring_offset_ += n;
+        copied += n;
+        if (ring_offset_ == chunk.size) {
+            ring_offset_ = 0;
+            ring_head_ = (ring_head_ + 1) % ring_.size();
             {
-                return -2;
+                std::lock_guard<std::mutex> lock(ring_mutex_);
+                ring_count_--;
             }
+            ring_not_full_.notify_one();
         }
-        return -2;
     }
-    return 0;
+    return copied;
 }
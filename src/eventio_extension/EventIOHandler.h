@@ -1,7 +1,11 @@
 #pragma once
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include "CompressionHandler/CompressionHandler.h"
 #include "CompressionHandler/FileHandler.h"
 
@@ -10,11 +14,32 @@
  */
 class EventIOHandler {
    public:
+    /*
+   * Size of the internal read-ahead buffer used when reading, 0 falls back
+   * to reading the input byte by byte while searching for the sync tag.
+   */
+    static constexpr size_t default_readahead_size = 1 << 20;
+    /*
+   * Settings of the background decompression thread for compressed input.
+   * prefetch_depth is the number of buffers of prefetch_buffer_size bytes in
+   * the ring, it is reduced so that the ring never exceeds max_prefetch_memory.
+   * A depth of 0 decompresses on the reading thread.
+   */
+    static constexpr size_t default_prefetch_buffer_size = 4 << 20;
+    static constexpr size_t default_max_prefetch_memory = 64 << 20;
+
     EventIOHandler(const std::string& fname, const char mode,
-                   const std::string& url = "root://eos01.ihep.ac.cn");
+                   const std::string& url = "root://eos01.ihep.ac.cn",
+                   size_t readahead_size = default_readahead_size,
+                   size_t prefetch_depth = 0,
+                   size_t prefetch_buffer_size = default_prefetch_buffer_size,
+                   size_t max_prefetch_memory = default_max_prefetch_memory);
     ~EventIOHandler()
     {
-        compressionHandler_->close();
+        stop_prefetch();
+        if (compressionHandler_ != nullptr) {
+            compressionHandler_->close();
+        }
     }
     /*
    * user_function defined in eventio_en.pdf
@@ -23,12 +48,67 @@ class EventIOHandler {
     int user_function2(unsigned char* buffer, long bytes);
     int user_function3(unsigned char* buffer, long bytes);
     int user_function4(unsigned char* buffer, long bytes);
+    /*
+   * Position in the (uncompressed) input, -1 if the input is compressed
+   * and therefore can not be positioned.
+   */
+    long tell() const;
+    int seek(long offset);
 
    private:
     size_t read(unsigned char* buffer, size_t bytes);
+    size_t raw_read(unsigned char* buffer, size_t bytes);
+    size_t source_read(unsigned char* buffer, size_t bytes);
     size_t write(unsigned char* buffer, size_t bytes);
+    /*
+   * Skip bytes of the input, -1 if the compressed input ends before
+   */
     int seek_current(size_t bytes);
+    bool source_exhausted();
+    bool raw_source_exhausted() const;
+    /*
+   * Make sure at least min_bytes are buffered, returns the number of buffered bytes
+   */
+    size_t fill_readahead(size_t min_bytes);
+    size_t buffered() const { return readahead_end_ - readahead_pos_; }
+    /*
+   * Search the sync tag and copy the 16 bytes block header into buffer
+   */
+    int find_header_buffered(unsigned char* buffer);
+    int find_header_bytewise(unsigned char* buffer);
+    /*
+   * Background decompression: the producer fills the ring with
+   * decompressed data, ring_read hands it out to the reading thread.
+   */
+    struct PrefetchChunk {
+        std::vector<unsigned char> data;
+        size_t size = 0;
+    };
+    void start_prefetch(size_t depth, size_t buffer_size);
+    void stop_prefetch();
+    void prefetch_loop();
+    size_t ring_read(unsigned char* buffer, size_t bytes);
     static bool endsWith(const std::string& str, const std::string& suffix);
     std::unique_ptr<FileHandler> fileHandler_;
     std::unique_ptr<CompressionHandler> compressionHandler_;
+    std::vector<unsigned char> readahead_;
+    size_t readahead_pos_ = 0;
+    size_t readahead_end_ = 0;
+    // Bytes taken from the source so far, the read position is this minus the buffered bytes
+    size_t source_offset_ = 0;
+    // Decompression failed on the reading thread, the input then ends with a read error
+    bool read_error_ = false;
+
+    std::vector<PrefetchChunk> ring_;
+    size_t ring_head_ = 0;   // chunk being consumed
+    size_t ring_tail_ = 0;   // chunk being filled by the producer
+    size_t ring_count_ = 0;  // filled chunks, guarded by ring_mutex_
+    size_t ring_offset_ = 0; // consumed bytes of the head chunk
+    bool ring_eof_ = false;
+    bool ring_error_ = false;
+    bool ring_stop_ = false;
+    std::mutex ring_mutex_;
+    std::condition_variable ring_not_full_;
+    std::condition_variable ring_not_empty_;
+    std::thread prefetch_thread_;
 };
@@ -15,6 +15,31 @@ int EventIOHandler_init(const char* fname, const char mode, const char* url) {
     return 0;
 
 }
+int EventIOHandler_init_prefetch(const char* fname, const char mode, const char* url, size_t prefetch_depth,
+                                 size_t prefetch_buffer_size, size_t max_prefetch_memory) {
+    try
+    {
+        eventiohandler = new EventIOHandler(fname, mode, url, EventIOHandler::default_readahead_size,
+                                            prefetch_depth, prefetch_buffer_size, max_prefetch_memory);
+    }
+    catch (const std::exception& e)
+    {
+        return -1;
+    }
+    return 0;
+}
+long EventIOHandler_tell() {
+    if(eventiohandler == nullptr) {
+        return -1;
+    }
+    return eventiohandler->tell();
+}
+int EventIOHandler_seek(long offset) {
+    if(eventiohandler == nullptr) {
+        return -1;
+    }
+    return eventiohandler->seek(offset);
+}
 void EventIOHandler_finalize() {
     delete eventiohandler;
 }
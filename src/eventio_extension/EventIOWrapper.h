@@ -3,12 +3,24 @@ extern "C" {
 #include "stddef.h"
 #endif
 int EventIOHandler_init(const char* fname, const char mode, const char* url = "root://eos01.ihep.ac.cn");
+/*
+ * Same as EventIOHandler_init, compressed input is decompressed by a background
+ * thread into a ring of prefetch_depth buffers of prefetch_buffer_size bytes,
+ * limited to max_prefetch_memory bytes in total.
+ */
+int EventIOHandler_init_prefetch(const char* fname, const char mode, const char* url, size_t prefetch_depth,
+                                 size_t prefetch_buffer_size, size_t max_prefetch_memory);
 int userfunction1(unsigned char* buffer, long size);
 int userfunction2(unsigned char* buffer, long size);
 int userfunction3(unsigned char* buffer, long size);
 int userfunction4(unsigned char* buffer, long size);
 
 int myuser_function(unsigned char* buffer, long size, int function_id);
+/*
+ * Position of the input, only supported for uncompressed files: tell returns -1 and seek fails otherwise
+ */
+long EventIOHandler_tell();
+int EventIOHandler_seek(long offset);
 void EventIOHandler_finalize();
 #ifdef __cplusplus
 }
@@ -8,6 +8,7 @@ from ._pylast_calibrator import *
 from ._pylast_imageprocessor import *
 from ._pylast_showerprocessor import *
 from ._pylast_datawriter import *
+from ._pylast_pipeline import *
 from ._pystatistic import *
 import numpy as np
 
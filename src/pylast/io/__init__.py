@@ -1,2 +1,3 @@
 from .SimtelEventSource import SimtelEventSource
 from ..helper import DataWriter, RootEventSource
+from ..helper import MultiSimtelEventSource, SimtelReadOptions
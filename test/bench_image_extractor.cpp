@@ -0,0 +1,85 @@
+/**
+ * @file bench_image_extractor.cpp
+ * @brief Compare the per pixel local peak extraction with the extraction over pixel tiles
+ *
+ * Usage: bench_image_extractor [n_pixels] [n_samples] [window_width] [repeat]
+ *
+ * Extract a synthetic waveform of pedestal noise and one pulse per pixel, once with maxCoeff and the
+ * per pixel window loop the extractor used before, once with extract_around_local_peak. Windows of at least
+ * a quarter of n_samples are summed from the prefix sums, narrower ones from the samples.
+ */
+#include "ImageExtractor.hh"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+static std::pair<Eigen::VectorXd, Eigen::VectorXd> per_pixel_extraction(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz)
+{
+    int n_pixels = waveform.rows();
+    Eigen::VectorXd charge = Eigen::VectorXd::Zero(n_pixels);
+    Eigen::VectorXd peak_time = Eigen::VectorXd::Zero(n_pixels);
+    for (int ipix = 0; ipix < n_pixels; ipix++) {
+        Eigen::Index peak_index;
+        waveform.row(ipix).maxCoeff(&peak_index);
+        int start = std::max(0, static_cast<int>(peak_index) - window_shift);
+        int end = std::min(static_cast<int>(waveform.cols()), static_cast<int>(peak_index) - window_shift + window_width);
+        charge(ipix) = waveform.block(ipix, start, 1, end - start).sum();
+        double time_sum = 0;
+        for (int i = start; i < end; i++) {
+            if (waveform(ipix, i) > 0) {
+                time_sum += i * waveform(ipix, i);
+            }
+        }
+        peak_time(ipix) = time_sum / charge(ipix) / sampling_rate_ghz;
+    }
+    return std::make_pair(charge, peak_time);
+}
+
+template<typename Extraction>
+static double time_per_call_us(Extraction&& extraction, int repeat, double& checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++) {
+        checksum += extraction().first.sum();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+
+int main(int argc, char** argv)
+{
+    int n_pixels = argc > 1 ? std::stoi(argv[1]) : 1855;
+    int n_samples = argc > 2 ? std::stoi(argv[2]) : 75;
+    int window_width = argc > 3 ? std::stoi(argv[3]) : 7;
+    int repeat = argc > 4 ? std::stoi(argv[4]) : 2000;
+    const int window_shift = 3;
+    const double sampling_rate_ghz = 1.0;
+
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0, 1);
+    std::uniform_int_distribution<int> pulse_position(0, n_samples - 1);
+    std::exponential_distribution<float> amplitude(0.05);
+    R1WaveformMatrix waveform(n_pixels, n_samples);
+    for (int ipix = 0; ipix < n_pixels; ipix++) {
+        int position = pulse_position(rng);
+        float pulse = amplitude(rng);
+        for (int isample = 0; isample < n_samples; isample++) {
+            waveform(ipix, isample) = noise(rng) + pulse * std::exp(-0.3f * (isample - position) * (isample - position));
+        }
+    }
+
+    auto [reference_charge, reference_time] = per_pixel_extraction(waveform, window_width, window_shift, sampling_rate_ghz);
+    auto [charge, peak_time] = extract_around_local_peak(waveform, window_width, window_shift, sampling_rate_ghz);
+    double max_difference = (charge - reference_charge).cwiseAbs().maxCoeff();
+
+    double checksum = 0;
+    double per_pixel_us = time_per_call_us([&] { return per_pixel_extraction(waveform, window_width, window_shift, sampling_rate_ghz); }, repeat, checksum);
+    double tiled_us = time_per_call_us([&] { return extract_around_local_peak(waveform, window_width, window_shift, sampling_rate_ghz); }, repeat, checksum);
+    std::cout << n_pixels << " pixels x " << n_samples << " samples, window " << window_width << ", " << repeat << " calls" << std::endl
+              << "per pixel:  " << per_pixel_us << " us/call" << std::endl
+              << "tiled:      " << tiled_us << " us/call" << std::endl
+              << "speedup " << per_pixel_us / tiled_us << "x, max charge difference " << max_difference
+              << " (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
@@ -1,6 +1,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "CameraGeometry.hh"
+#include "CameraGeometryRegistry.hh"
 #include "doctest/doctest.h"
+#include <array>
+#include <thread>
 
 
 TEST_CASE("test_neighbor_matrix")
@@ -74,3 +77,106 @@ TEST_CASE("test_get_border_pixel_mask")
     CHECK(border_mask_2.count() == 24);
     
 }
+TEST_CASE("test_border_pixel_mask_shared_between_threads")
+{
+    std::vector<double> pix_x;
+    std::vector<double> pix_y;
+    std::vector<double> pix_area;
+    std::vector<int> pix_type;
+    for(int j = 0; j < 7; j++)
+    {
+        for(int i = 0; i < 7; i++)
+        {
+            pix_x.push_back(i);
+            pix_y.push_back(j);
+            pix_area.push_back(1);
+            pix_type.push_back(2);
+        }
+    }
+    const CameraGeometry camera("test", 49, pix_x.data(), pix_y.data(), pix_area.data(), pix_type.data(), 0);
+    std::vector<std::array<int, 3>> counts(4);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < counts.size(); i++)
+    {
+        threads.emplace_back([&camera, &counts, i]() {
+            for(int width = 1; width <= 3; width++)
+            {
+                counts[i][width - 1] = camera.get_border_pixel_mask(width).count();
+            }
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+    for(const auto& count: counts)
+    {
+        CHECK(count[0] == 24);
+        CHECK(count[1] == 40);
+        CHECK(count[2] == 48);
+    }
+}
+TEST_CASE("test_border_pixel_mask_every_width")
+{
+    std::vector<double> pix_x;
+    std::vector<double> pix_y;
+    for(int j = 0; j < 7; j++)
+    {
+        for(int i = 0; i < 7; i++)
+        {
+            pix_x.push_back(i);
+            pix_y.push_back(j);
+        }
+    }
+    std::vector<double> pix_area(49, 1);
+    std::vector<int> pix_type(49, 2);
+    const CameraGeometry camera("test", 49, pix_x.data(), pix_y.data(), pix_area.data(), pix_type.data(), 0);
+    // The innermost pixel is reached with width 4
+    CHECK(camera.border_pixel_mask.size() == 4);
+    CHECK(camera.border_pixel_mask.at(4).count() == 49);
+    CHECK(camera.get_border_pixel_mask(10).count() == 49);
+}
+TEST_CASE("test_camera_geometry_registry")
+{
+    Eigen::VectorXd pix_x(9), pix_y(9);
+    for(int i = 0; i < 9; i++)
+    {
+        pix_x[i] = i % 3;
+        pix_y[i] = i / 3;
+    }
+    Eigen::VectorXd pix_area = Eigen::VectorXd::Ones(9);
+    Eigen::VectorXi pix_type = Eigen::VectorXi::Constant(9, 2);
+    CameraGeometryRegistry registry;
+    auto geometry = registry.get("test", pix_x, pix_y, pix_area, pix_type, 0, 10);
+    CHECK(geometry->pix_x_fov[2] == doctest::Approx(0.2));
+    CHECK(geometry->pix_width_fov[0] == doctest::Approx(0.1));
+    CHECK(geometry->neighbor_offsets.size() == 10);
+    SUBCASE("test_same_camera_is_shared")
+    {
+        std::vector<double> x(pix_x.data(), pix_x.data() + 9);
+        auto same = registry.get("test", Eigen::Map<const Eigen::VectorXd>(x.data(), 9), pix_y, pix_area, pix_type, 0, 10);
+        CHECK(same == geometry);
+        CHECK(registry.size() == 1);
+    }
+    SUBCASE("test_different_cameras")
+    {
+        CHECK(registry.get("other", pix_x, pix_y, pix_area, pix_type, 0, 10) != geometry);
+        CHECK(registry.get("test", pix_x, pix_y, pix_area, pix_type, 0, 20) != geometry);
+        Eigen::VectorXd moved_x = pix_x;
+        moved_x[0] = -0.5;
+        CHECK(registry.get("test", moved_x, pix_y, pix_area, pix_type, 0, 10) != geometry);
+        CHECK(registry.size() == 1);
+    }
+    SUBCASE("test_rebuilt_after_release")
+    {
+        geometry.reset();
+        CHECK(registry.size() == 0);
+        auto rebuilt = registry.get("test", pix_x, pix_y, pix_area, pix_type, 0, 10);
+        CHECK(rebuilt->num_pixels == 9);
+        CHECK(registry.size() == 1);
+    }
+    SUBCASE("test_columns_of_different_lengths")
+    {
+        CHECK_THROWS_AS(registry.get("test", pix_x, pix_y.head(8), pix_area, pix_type, 0, 10), std::runtime_error);
+    }
+}
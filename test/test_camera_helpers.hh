@@ -0,0 +1,40 @@
+/**
+ * @file test_camera_helpers.hh
+ * @brief Synthetic cameras shared by the tests
+ */
+#pragma once
+#include "CameraGeometry.hh"
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Hexagonal camera with rings around the center pixel
+ * @param fov_scale if positive, the fov coordinates and pixel widths are the camera ones times fov_scale
+ */
+inline CameraGeometry make_hex_camera(int n_rings, double fov_scale = 0)
+{
+    std::vector<double> pix_x, pix_y, pix_area;
+    std::vector<int> pix_type;
+    for(int q = -n_rings; q <= n_rings; q++)
+    {
+        for(int r = -n_rings; r <= n_rings; r++)
+        {
+            if(std::abs(q + r) > n_rings)
+            {
+                continue;
+            }
+            pix_x.push_back(q + 0.5 * r);
+            pix_y.push_back(r * std::sqrt(3) / 2);
+            pix_area.push_back(std::sqrt(3) / 2);
+            pix_type.push_back(1);
+        }
+    }
+    CameraGeometry camera("hex", pix_x.size(), pix_x.data(), pix_y.data(), pix_area.data(), pix_type.data(), 0);
+    if(fov_scale > 0)
+    {
+        camera.pix_x_fov = camera.pix_x * fov_scale;
+        camera.pix_y_fov = camera.pix_y * fov_scale;
+        camera.pix_width_fov = camera.pix_width * fov_scale;
+    }
+    return camera;
+}
@@ -0,0 +1,62 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "EventPipeline.hh"
+#include "SimtelEventSource.hh"
+#include "doctest/doctest.h"
+#include <filesystem>
+
+struct ProcessedEvent {
+    int event_id;
+    std::map<int, double> hillas_intensity;
+    bool geometry_valid;
+};
+static ProcessedEvent summarize(const ArrayEvent& event)
+{
+    ProcessedEvent summary{event.event_id, {}, false};
+    for(const auto& [tel_id, dl1]: event.dl1->tels) {
+        summary.hillas_intensity[tel_id] = dl1->image_parameters.hillas.intensity;
+    }
+    summary.geometry_valid = event.dl2->geometry.at("HillasReconstructor").is_valid;
+    return summary;
+}
+
+TEST_CASE("EventPipeline")
+{
+    auto test_directory = std::filesystem::path(__FILE__);
+    auto test_file = (test_directory.parent_path() / "test_data" / "lact_prod0_simtel_particle_gamma_energy_1000.0_1000.0_zenith_0.0_azimuth_0.0_run_1_event_0.zst").string();
+
+    std::vector<ProcessedEvent> serial_events;
+    {
+        SimtelEventSource source(test_file);
+        Calibrator calibrator(*source.subarray);
+        ImageProcessor image_processor(*source.subarray);
+        ShowerProcessor shower_processor(*source.subarray);
+        for(auto& event: source) {
+            calibrator(event);
+            image_processor(event);
+            shower_processor(event);
+            serial_events.push_back(summarize(event));
+        }
+    }
+    REQUIRE(serial_events.size() > 0);
+
+    SUBCASE("test_same_order_and_result")
+    {
+        SimtelEventSource source(test_file);
+        EventPipeline pipeline(source, R"({"n_workers": 3, "max_events_in_flight": 4})");
+        CHECK(pipeline.get_n_workers() == 3);
+        std::vector<ProcessedEvent> pipeline_events;
+        pipeline.run([&pipeline_events](ArrayEvent& event) { pipeline_events.push_back(summarize(event)); });
+        REQUIRE(pipeline_events.size() == serial_events.size());
+        for(size_t i = 0; i < serial_events.size(); i++) {
+            CHECK(pipeline_events[i].event_id == serial_events[i].event_id);
+            CHECK(pipeline_events[i].hillas_intensity == serial_events[i].hillas_intensity);
+            CHECK(pipeline_events[i].geometry_valid == serial_events[i].geometry_valid);
+        }
+    }
+    SUBCASE("test_consumer_error")
+    {
+        SimtelEventSource source(test_file);
+        EventPipeline pipeline(source, R"({"n_workers": 2})");
+        CHECK_THROWS_AS(pipeline.run([](ArrayEvent&) { throw std::runtime_error("consumer failed"); }), std::runtime_error);
+    }
+}
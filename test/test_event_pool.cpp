@@ -0,0 +1,232 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "ArrayEventPool.hh"
+#include "Calibration.hh"
+#include "EventSource.hh"
+#include "ImageProcessor.hh"
+#include "R1Calibration.hh"
+#include "Utils.hh"
+#include "doctest/doctest.h"
+#include "test_synthetic_events.hh"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation of the test binary is counted. Eigen allocates with malloc, so with glibc malloc itself
+// is replaced, otherwise only operator new is seen. The sanitizers replace malloc themselves.
+static std::atomic<size_t> n_allocations = 0;
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* malloc(std::size_t size)
+{
+    n_allocations++;
+    return __libc_malloc(size);
+}
+#else
+void* operator new(std::size_t size)
+{
+    n_allocations++;
+    if(void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+namespace {
+constexpr int n_samples = 40;
+constexpr std::array<int, 3> tel_ids{1, 5, 130};
+constexpr std::array<int, 3> tel_pixels{1855, 1039, 2048};
+
+std::shared_ptr<const TelMonitor> make_monitor(int n_pixels)
+{
+    return std::make_shared<const TelMonitor>(TelMonitor{
+        .n_channels = 2,
+        .n_pixels = n_pixels,
+        .pedestal_per_sample = Eigen::Matrix<double, -1, -1, Eigen::RowMajor>::Constant(2, n_pixels, 100),
+        .dc_to_pe = Eigen::Matrix<double, -1, -1, Eigen::RowMajor>::Constant(2, n_pixels, 0.1)});
+}
+
+// Reads synthetic events the way SimtelEventSource fills them
+class SyntheticEventSource: public EventSource
+{
+public:
+    explicit SyntheticEventSource(int n_events): n_events(n_events)
+    {
+        max_events = -1;
+        for(size_t i = 0; i < tel_ids.size(); i++)
+        {
+            monitors[i] = make_monitor(tel_pixels[i]);
+        }
+    }
+    void load_all_simulated_showers() override {}
+    int n_read = 0;
+protected:
+    bool is_finished() override { return finished; }
+    void init_simulation_config() override {}
+    void init_atmosphere_model() override {}
+    void init_metaparam() override {}
+    void init_subarray() override {}
+    void open_file() override {}
+    ArrayEvent get_event() override
+    {
+        if(n_read == n_events)
+        {
+            finished = true;
+            return ArrayEvent();
+        }
+        ArrayEvent event = acquire_event();
+        event.event_id = n_read++;
+        auto& simulation = event.emplace_level<SimulatedEvent>();
+        simulation.shower.energy = 1.0;
+        auto& monitor = event.emplace_level<EventMonitor>();
+        auto& pointing = event.emplace_level<Pointing>();
+        auto& r0 = event.emplace_level<R0Event>();
+        auto& r1 = event.emplace_level<R1Event>();
+        for(size_t i = 0; i < tel_ids.size(); i++)
+        {
+            const int tel_id = tel_ids[i];
+            const int n_pixels = tel_pixels[i];
+            monitor.add_tel(tel_id, monitors[i]);
+            pointing.add_tel(tel_id, PointingTelescope{.azimuth = 0, .altitude = 1.2});
+            auto* simulated_camera = simulation.reuse_tel(tel_id);
+            simulated_camera->true_image.setConstant(n_pixels, event.event_id);
+            auto* r0_camera = r0.reuse_tel(tel_id);
+            r0_camera->n_pixels = n_pixels;
+            r0_camera->n_samples = n_samples;
+            r0_camera->waveform[0].setConstant(n_pixels, n_samples, 200);
+            r0_camera->waveform[1].resize(0, 0);
+            auto* r1_camera = r1.reuse_tel(tel_id);
+            r1_camera->n_pixels = n_pixels;
+            r1_camera->n_samples = n_samples;
+            Utils::select_gain_channel_by_threshold<uint16_t>(r0_camera->waveform, 4000, r1_camera->gain_selection);
+            R1Calibration::calibrate(r0_camera->waveform, r1_camera->gain_selection, *monitors[i], r1_camera->waveform);
+        }
+        return event;
+    }
+private:
+    int n_events;
+    bool finished = false;
+    std::array<std::shared_ptr<const TelMonitor>, tel_ids.size()> monitors;
+};
+}
+
+TEST_CASE("ArrayEventPool")
+{
+    ArrayEventPool pool(2);
+    SUBCASE("test_recycled_event_is_reset")
+    {
+        ArrayEvent event = pool.acquire();
+        auto* r0_camera = event.emplace_level<R0Event>().add_tel(3);
+        r0_camera->waveform[0].resize(10, 4);
+        const auto* samples = r0_camera->waveform[0].data();
+        event.emplace_level<DL2Event>().add_energy("energy", ReconstructedEnergy{});
+        pool.recycle(std::move(event));
+        CHECK(pool.size() == 1);
+
+        ArrayEvent reused = pool.acquire();
+        CHECK(pool.size() == 0);
+        CHECK_FALSE(reused.has_levels());
+        CHECK(reused.emplace_level<R0Event>().tels.empty());
+        CHECK(reused.emplace_level<DL2Event>().energy.empty());
+        auto* reused_camera = reused.r0->reuse_tel(3);
+        CHECK(reused_camera->waveform[0].data() == samples);
+    }
+    SUBCASE("test_moved_from_event_is_dropped")
+    {
+        ArrayEvent event;
+        event.emplace_level<R0Event>();
+        ArrayEvent moved = std::move(event);
+        CHECK(moved.r0.has_value());
+        CHECK_FALSE(event.has_levels());
+        pool.recycle(std::move(event));
+        CHECK(pool.size() == 0);
+    }
+    SUBCASE("test_max_events")
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            ArrayEvent event;
+            event.emplace_level<Pointing>();
+            pool.recycle(std::move(event));
+        }
+        CHECK(pool.size() == 2);
+    }
+}
+
+TEST_CASE("EventSource recycling")
+{
+    constexpr int n_events = 50;
+    constexpr int n_warmup = 3;
+    SyntheticEventSource source(n_events);
+    SUBCASE("test_no_allocations_in_steady_state")
+    {
+        size_t start = 0;
+        int n_seen = 0;
+        for(auto& event: source)
+        {
+            if(n_seen++ == n_warmup)
+            {
+                start = n_allocations;
+            }
+            CHECK(event.r1->get_tel(130)->waveform.rows() == 2048);
+        }
+        CHECK(n_seen == n_events);
+        CHECK(n_allocations - start == 0);
+    }
+    SUBCASE("test_events_given_back_by_a_consumer")
+    {
+        // Like EventPipeline, the events are moved out of the iterator and recycled once written
+        size_t start = 0;
+        int n_seen = 0;
+        for(auto& event: source)
+        {
+            ArrayEvent written = std::move(event);
+            CHECK(written.simulation->get_tel(5)->true_image(0) == n_seen);
+            if(n_seen++ == n_warmup)
+            {
+                start = n_allocations;
+            }
+            source.recycle_event(std::move(written));
+        }
+        CHECK(n_seen == n_events);
+        CHECK(n_allocations - start == 0);
+        CHECK(source.event_pool->size() == 1);
+    }
+}
+
+TEST_CASE("Processor recycling")
+{
+    // The events repeat, after the first round every telescope slot and map node was allocated by the same event
+    constexpr int n_distinct_events = 8;
+    constexpr int n_events = 5 * n_distinct_events;
+    auto subarray = make_synthetic_subarray();
+    Calibrator calibrator(subarray);
+    // Between the intensities of the synthetic images, so telescopes are kept and rejected
+    ImageProcessor image_processor(subarray, json{{"min_intensity", 2250}});
+    ArrayEventPool pool(1);
+    size_t start = 0;
+    size_t n_kept = 0;
+    size_t n_rejected = 0;
+    for(int i = 0; i < n_events; i++)
+    {
+        if(i == n_distinct_events)
+        {
+            start = n_allocations;
+        }
+        ArrayEvent event = pool.acquire();
+        fill_synthetic_event(event, i % n_distinct_events, subarray);
+        calibrator(event);
+        image_processor(event);
+        CHECK(event.dl0->tels.size() == synthetic_tel_ids.size());
+        CHECK(event.dl1->tels.size() + event.dl1->rejected_tels.size() == synthetic_tel_ids.size());
+        n_kept += event.dl1->tels.size();
+        n_rejected += event.dl1->rejected_tels.size();
+        pool.recycle(std::move(event));
+    }
+    CHECK(n_kept > 0);
+    CHECK(n_rejected > 0);
+    CHECK(n_allocations - start == 0);
+}
@@ -0,0 +1,246 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "EventIOHandler.h"
+#include "doctest/doctest.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Block
+{
+    uint32_t type_word;
+    uint32_t ident;
+    uint32_t length;
+    // FNV-1a hash of the block data
+    uint64_t checksum;
+    bool operator==(const Block& other) const = default;
+};
+struct WalkResult
+{
+    std::vector<Block> blocks;
+    // Code of the user function that ended the walk, -2 at the end of the input
+    int end_code = 0;
+};
+// Settings of one EventIOHandler, the ones not given are the defaults
+struct ReadSettings
+{
+    size_t readahead_size = EventIOHandler::default_readahead_size;
+    size_t prefetch_depth = 0;
+    size_t prefetch_buffer_size = EventIOHandler::default_prefetch_buffer_size;
+};
+
+uint32_t get_word(const unsigned char* bytes, bool big_endian)
+{
+    if(big_endian)
+    {
+        return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+    }
+    return (uint32_t(bytes[3]) << 24) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[1]) << 8) | uint32_t(bytes[0]);
+}
+void put_word(unsigned char* bytes, uint32_t word)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        bytes[i] = static_cast<unsigned char>(word >> (8 * i));
+    }
+}
+uint64_t checksum(const std::vector<unsigned char>& data)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(auto byte: data)
+    {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Read all top-level blocks of the file with their data, like find_io_block and read_io_block do
+ */
+WalkResult read_blocks(const std::string& filename, const ReadSettings& settings)
+{
+    WalkResult result;
+    EventIOHandler handler(filename, 'r', "", settings.readahead_size, settings.prefetch_depth, settings.prefetch_buffer_size);
+    unsigned char header[16];
+    std::vector<unsigned char> data;
+    while((result.end_code = handler.user_function2(header, 16)) == 16)
+    {
+        // A big-endian file starts with 0xD4, a little-endian one with 0x37
+        bool big_endian = header[0] == 0xD4;
+        Block block{get_word(header + 4, big_endian), get_word(header + 8, big_endian), get_word(header + 12, big_endian) & 0x3FFFFFFF, 0};
+        if(block.type_word & 0x20000)
+        {
+            unsigned char extension[4];
+            if((result.end_code = handler.user_function2(extension, 4)) != 4)
+            {
+                return result;
+            }
+            REQUIRE((get_word(extension, big_endian) & 0xFFF) == 0);
+        }
+        data.resize(block.length);
+        if((result.end_code = handler.user_function3(data.data(), block.length)) != 0)
+        {
+            return result;
+        }
+        block.checksum = checksum(data);
+        result.blocks.push_back(block);
+    }
+    return result;
+}
+/**
+ * @brief Walk the top-level blocks skipping their data, like skip_io_block does
+ */
+WalkResult skip_blocks(const std::string& filename, const ReadSettings& settings)
+{
+    WalkResult result;
+    EventIOHandler handler(filename, 'r', "", settings.readahead_size, settings.prefetch_depth, settings.prefetch_buffer_size);
+    unsigned char header[16];
+    while((result.end_code = handler.user_function2(header, 16)) == 16)
+    {
+        bool big_endian = header[0] == 0xD4;
+        Block block{get_word(header + 4, big_endian), get_word(header + 8, big_endian), get_word(header + 12, big_endian) & 0x3FFFFFFF, 0};
+        result.blocks.push_back(block);
+        // -2 once the last block is skipped
+        if((result.end_code = handler.user_function4(nullptr, block.length)) != 0)
+        {
+            return result;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Write little-endian blocks with compressible data through EventIOHandler, the last block announces
+ *        missing_bytes more bytes than it has
+ */
+std::vector<Block> write_blocks(const std::string& filename, int n_blocks, uint32_t missing_bytes = 0)
+{
+    std::vector<Block> blocks;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> length(0, 20000);
+    EventIOHandler handler(filename, 'w', "");
+    for(int i = 0; i < n_blocks; i++)
+    {
+        Block block{static_cast<uint32_t>(2000 + i % 20), static_cast<uint32_t>(i), length(rng), 0};
+        std::vector<unsigned char> data(block.length);
+        for(auto& byte: data)
+        {
+            byte = static_cast<unsigned char>(rng() % 16);
+        }
+        block.checksum = checksum(data);
+        unsigned char header[16] = {0x37, 0x8A, 0x1F, 0xD4};
+        put_word(header + 4, block.type_word);
+        put_word(header + 8, block.ident);
+        const bool last = i == n_blocks - 1;
+        put_word(header + 12, block.length + (last ? missing_bytes : 0));
+        REQUIRE(handler.user_function1(header, 16) == 0);
+        if(!data.empty())
+        {
+            REQUIRE(handler.user_function1(data.data(), static_cast<long>(data.size())) == 0);
+        }
+        blocks.push_back(block);
+    }
+    return blocks;
+}
+// The first size bytes of the (compressed) file
+void copy_head(const std::string& source, const std::string& destination, size_t size)
+{
+    std::ifstream input(source, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    REQUIRE(size < bytes.size());
+    std::ofstream(destination, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(size));
+}
+
+const std::vector<ReadSettings> prefetch_settings{
+    // Default ring
+    {EventIOHandler::default_readahead_size, 4, EventIOHandler::default_prefetch_buffer_size},
+    // Buffers much smaller than the blocks, the ring wraps many times within a block
+    {EventIOHandler::default_readahead_size, 2, 4099},
+    // Byte-wise header search on top of the ring
+    {0, 3, 1021}};
+}
+
+TEST_CASE("EventIOHandler prefetch")
+{
+    auto test_file = (std::filesystem::path(__FILE__).parent_path() / "test_data" / "simtel.zst").string();
+    auto expected = read_blocks(test_file, ReadSettings{.prefetch_depth = 0});
+    REQUIRE(expected.blocks.size() > 1);
+    CHECK(expected.end_code == -2);
+    uint64_t n_bytes = 0;
+    for(const auto& block: expected.blocks)
+    {
+        n_bytes += 16 + block.length;
+    }
+    CHECK(n_bytes > 100 * 2 * 4099);
+    for(const auto& settings: prefetch_settings)
+    {
+        CAPTURE(settings.prefetch_depth);
+        CAPTURE(settings.prefetch_buffer_size);
+        auto result = read_blocks(test_file, settings);
+        CHECK(result.end_code == -2);
+        CHECK(result.blocks == expected.blocks);
+        auto skipped = skip_blocks(test_file, settings);
+        CHECK(skipped.end_code == -2);
+        CHECK(skipped.blocks.size() == expected.blocks.size());
+    }
+}
+
+TEST_CASE("EventIOHandler truncated input")
+{
+    auto directory = std::filesystem::temp_directory_path();
+    auto complete_file = (directory / "test_eventio_handler_complete.zst").string();
+    auto truncated_block_file = (directory / "test_eventio_handler_truncated_block.zst").string();
+    auto truncated_file = (directory / "test_eventio_handler_truncated.zst").string();
+    auto written = write_blocks(complete_file, 60);
+    // A valid zstd stream whose last block is shorter than its header says
+    write_blocks(truncated_block_file, 60, 100);
+    // A zstd stream cut in the middle
+    copy_head(complete_file, truncated_file, std::filesystem::file_size(complete_file) / 2);
+
+    std::vector<ReadSettings> all_settings = prefetch_settings;
+    all_settings.push_back(ReadSettings{.prefetch_depth = 0});
+    all_settings.push_back(ReadSettings{.readahead_size = 0, .prefetch_depth = 0});
+    SUBCASE("test_complete_file")
+    {
+        for(const auto& settings: all_settings)
+        {
+            CAPTURE(settings.readahead_size);
+            CAPTURE(settings.prefetch_depth);
+            auto result = read_blocks(complete_file, settings);
+            CHECK(result.end_code == -2);
+            CHECK(result.blocks == written);
+            CHECK(skip_blocks(complete_file, settings).end_code == -2);
+        }
+    }
+    SUBCASE("test_truncated_block")
+    {
+        for(const auto& settings: all_settings)
+        {
+            CAPTURE(settings.readahead_size);
+            CAPTURE(settings.prefetch_depth);
+            auto result = read_blocks(truncated_block_file, settings);
+            CHECK(result.end_code == -1);
+            CHECK(result.blocks.size() == written.size() - 1);
+            CHECK(skip_blocks(truncated_block_file, settings).end_code == -1);
+        }
+    }
+    SUBCASE("test_truncated_stream")
+    {
+        for(const auto& settings: all_settings)
+        {
+            CAPTURE(settings.readahead_size);
+            CAPTURE(settings.prefetch_depth);
+            auto result = read_blocks(truncated_file, settings);
+            CHECK(result.end_code == -1);
+            CHECK(result.blocks.size() < written.size());
+            CHECK(skip_blocks(truncated_file, settings).end_code == -1);
+        }
+    }
+    std::filesystem::remove(complete_file);
+    std::filesystem::remove(truncated_block_file);
+    std::filesystem::remove(truncated_file);
+}
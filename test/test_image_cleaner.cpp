@@ -0,0 +1,375 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "ImageCleaner.hh"
+#include "ImageProcessor.hh"
+#include "doctest/doctest.h"
+#include "test_camera_helpers.hh"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+// The sparse matrix formulation the kernel replaces
+Eigen::Vector<bool, -1> reference_tailcuts_clean(const CameraGeometry& camera_geometry, const Eigen::VectorXd& image, double picture_thresh, double boundary_thresh, bool keep_isolated_pixels, int min_number_picture_neighbors, int picture_neighbor_passes = 1)
+{
+    Eigen::Vector<bool, -1> pixel_above_picture = (image.array() >= picture_thresh);
+    Eigen::Vector<bool, -1> pixel_in_picture = pixel_above_picture;
+    for(int pass = 0; !keep_isolated_pixels && min_number_picture_neighbors != 0 && pass < picture_neighbor_passes; pass++)
+    {
+        Eigen::VectorXi num_neighbors_in_picture = camera_geometry.neigh_matrix * pixel_in_picture.cast<int>();
+        pixel_in_picture = (pixel_in_picture.array() && (num_neighbors_in_picture.array() >= min_number_picture_neighbors)).matrix();
+    }
+    Eigen::Vector<bool, -1> pixel_above_boundary = (image.array() >= boundary_thresh);
+    Eigen::Vector<bool, -1> pixel_with_picture_neighbors = (camera_geometry.neigh_matrix * pixel_in_picture.cast<int>()).array() > 0;
+    if(keep_isolated_pixels)
+    {
+        return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || pixel_in_picture.array();
+    }
+    Eigen::Vector<bool, -1> pixel_with_boundary_neighbors = (camera_geometry.neigh_matrix * pixel_above_boundary.cast<int>()).array() > 0;
+    return (pixel_above_boundary.array() && pixel_with_picture_neighbors.array()) || (pixel_in_picture.array() && pixel_with_boundary_neighbors.array());
+}
+// Breadth first search over the neighbor matrix, the labelling the union-find replaces
+std::vector<int> reference_island_sizes(const CameraGeometry& camera_geometry, const PixelMask& mask)
+{
+    std::vector<bool> visited(camera_geometry.num_pixels, false);
+    std::vector<int> island_sizes;
+    for(int i = 0; i < camera_geometry.num_pixels; i++)
+    {
+        if(!mask[i] || visited[i])
+        {
+            continue;
+        }
+        int island_size = 0;
+        std::queue<int> queue;
+        queue.push(i);
+        visited[i] = true;
+        while(!queue.empty())
+        {
+            int pixel = queue.front();
+            queue.pop();
+            island_size++;
+            for(Eigen::SparseMatrix<int, Eigen::RowMajor>::InnerIterator it(camera_geometry.neigh_matrix, pixel); it; ++it)
+            {
+                if(mask[it.col()] && !visited[it.col()])
+                {
+                    visited[it.col()] = true;
+                    queue.push(it.col());
+                }
+            }
+        }
+        island_sizes.push_back(island_size);
+    }
+    return island_sizes;
+}
+}
+
+TEST_CASE("TailcutsCleaner")
+{
+    auto camera = make_hex_camera(10);
+    const int n_pixels = camera.num_pixels;
+    REQUIRE(camera.neighbor_offsets.size() == static_cast<size_t>(n_pixels + 1));
+    CHECK(camera.neighbor_offsets.back() == camera.neigh_matrix.nonZeros());
+    SUBCASE("test_matches_sparse_reference")
+    {
+        std::mt19937 rng(7);
+        std::exponential_distribution<double> pe(0.3);
+        for(int trial = 0; trial < 50; trial++)
+        {
+            Eigen::VectorXd image(n_pixels);
+            for(int i = 0; i < n_pixels; i++)
+            {
+                image[i] = pe(rng);
+            }
+            for(bool keep_isolated_pixels: {false, true})
+            {
+                for(int min_neighbors: {0, 1, 2, 3})
+                {
+                    auto mask = TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, keep_isolated_pixels, min_neighbors);
+                    auto expected = reference_tailcuts_clean(camera, image, 10, 5, keep_isolated_pixels, min_neighbors);
+                    CHECK(mask == PixelMask::from_bools(expected));
+                }
+            }
+        }
+    }
+    SUBCASE("test_picture_neighbor_passes")
+    {
+        std::mt19937 rng(11);
+        std::exponential_distribution<double> pe(0.3);
+        int n_shrunk = 0;
+        for(int trial = 0; trial < 50; trial++)
+        {
+            Eigen::VectorXd image(n_pixels);
+            for(int i = 0; i < n_pixels; i++)
+            {
+                image[i] = pe(rng);
+            }
+            for(int passes: {0, 1, 2, 3})
+            {
+                auto mask = TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2, passes);
+                auto expected = reference_tailcuts_clean(camera, image, 10, 5, false, 2, passes);
+                CHECK(mask == PixelMask::from_bools(expected));
+            }
+            // One pass is the default, more passes only remove pixels
+            auto one_pass = TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2);
+            auto two_passes = TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2, 2);
+            CHECK(one_pass == TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2, 1));
+            CHECK((one_pass & two_passes) == two_passes);
+            n_shrunk += two_passes.count() < one_pass.count();
+        }
+        // The second pass matters for some of the images
+        CHECK(n_shrunk > 0);
+        // Without passes the picture pixels need no picture neighbors
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels);
+        image[0] = 20;
+        image[camera.neighbor_indices[camera.neighbor_offsets[0]]] = 7;
+        CHECK(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2, 0).count() == 2);
+        CHECK(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2, 1).count() == 0);
+
+        CHECK(TailcutsCleaner().get_picture_neighbor_passes() == 1);
+        TailcutsCleaner cleaner(json{{"picture_neighbor_passes", 3}});
+        CHECK(cleaner.get_picture_neighbor_passes() == 3);
+        CHECK(cleaner(camera, image).count() == 0);
+        CHECK_THROWS_AS(TailcutsCleaner(json{{"picture_neighbor_passes", -1}}), std::runtime_error);
+        CHECK(ImagePreScreen::from_cleaning(TailcutsCleaner(json{{"picture_neighbor_passes", 0}}), 50).min_picture_pixels == 1);
+    }
+    SUBCASE("test_empty_image")
+    {
+        Eigen::VectorXd image = Eigen::VectorXd::Constant(n_pixels, 7.0);
+        CHECK(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 2).count() == 0);
+    }
+    SUBCASE("test_isolated_pixel")
+    {
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels);
+        image[0] = 20;
+        CHECK(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 0).count() == 0);
+        CHECK(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, true, 0).count() == 1);
+    }
+    SUBCASE("test_image_size_mismatch")
+    {
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels + 1);
+        CHECK_THROWS_AS(TailcutsCleaner::tailcuts_clean(camera, image, 10, 5), std::runtime_error);
+    }
+    SUBCASE("test_mask_parameters")
+    {
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels);
+        // Two islands, one of them reaching the border of the camera
+        for(int i: {0, 1, 2, n_pixels / 2, n_pixels / 2 + 1, n_pixels - 1, n_pixels - 2})
+        {
+            image[i] = 20;
+        }
+        auto mask = TailcutsCleaner::tailcuts_clean(camera, image, 10, 5, false, 1);
+        CHECK(mask.count() == 7);
+        CHECK(ImageProcessor::morphology_parameter(camera, mask).n_islands == 3);
+        Eigen::VectorXd masked_image = mask.masked(image);
+        auto leakage = ImageProcessor::leakage_parameter(camera, masked_image, mask);
+        auto leakage_from_image = ImageProcessor::leakage_parameter(camera, masked_image);
+        CHECK(leakage.pixels_width_1 == doctest::Approx(leakage_from_image.pixels_width_1));
+        CHECK(leakage.intensity_width_2 == doctest::Approx(leakage_from_image.intensity_width_2));
+        CHECK(leakage.pixels_width_1 > 0);
+        auto dilated = mask;
+        ImageProcessor::dilate_image(camera, dilated);
+        CHECK((dilated & mask) == mask);
+        CHECK(dilated.count() > mask.count());
+    }
+    SUBCASE("test_sparse_image")
+    {
+        std::mt19937 rng(3);
+        std::exponential_distribution<double> pe(0.3);
+        Eigen::VectorXd image(n_pixels);
+        Eigen::VectorXd peak_time(n_pixels);
+        for(int i = 0; i < n_pixels; i++)
+        {
+            image[i] = pe(rng);
+            peak_time[i] = i % 17;
+        }
+        TailcutsCleaner cleaner;
+        auto cleaned_image = cleaner.clean(camera, image, peak_time);
+        auto mask = cleaner(camera, image);
+        REQUIRE(cleaned_image.size() == mask.count());
+        CHECK(cleaned_image.n_pixels == n_pixels);
+        CHECK(cleaned_image.mask() == mask);
+        CHECK(std::is_sorted(cleaned_image.pixel_id.begin(), cleaned_image.pixel_id.end()));
+        for(int k = 0; k < cleaned_image.size(); k++)
+        {
+            CHECK(cleaned_image.charge[k] == image[cleaned_image.pixel_id[k]]);
+            CHECK(cleaned_image.peak_time[k] == peak_time[cleaned_image.pixel_id[k]]);
+        }
+        Eigen::VectorXd masked_image = mask.masked(image);
+        CHECK(cleaned_image.to_dense<Eigen::VectorXd>(cleaned_image.charge) == masked_image);
+        CHECK(cleaned_image.sum() == doctest::Approx(masked_image.sum()));
+        // The leakage from the bool mask of the camera sized image and from the kept pixels agree
+        auto leakage = ImageProcessor::leakage_parameter(camera, cleaned_image);
+        auto leakage_from_image = ImageProcessor::leakage_parameter(camera, masked_image);
+        CHECK(leakage.pixels_width_2 == doctest::Approx(leakage_from_image.pixels_width_2));
+        CHECK(leakage.intensity_width_1 == doctest::Approx(leakage_from_image.intensity_width_1));
+        CHECK(ImageProcessor::morphology_parameter(camera, cleaned_image).n_pixels == mask.count());
+        CHECK(cleaner.clean(camera, image).peak_time.empty());
+    }
+}
+
+TEST_CASE("Island labelling")
+{
+    auto camera = make_hex_camera(10);
+    const int n_pixels = camera.num_pixels;
+    SUBCASE("test_matches_breadth_first_search")
+    {
+        std::mt19937 rng(5);
+        for(double occupancy: {0.05, 0.2, 0.5, 0.8})
+        {
+            std::bernoulli_distribution kept(occupancy);
+            for(int trial = 0; trial < 20; trial++)
+            {
+                auto mask = PixelMask(n_pixels);
+                for(int i = 0; i < n_pixels; i++)
+                {
+                    if(kept(rng))
+                    {
+                        mask.set(i);
+                    }
+                }
+                auto island_sizes = reference_island_sizes(camera, mask);
+                auto morphology = ImageProcessor::morphology_parameter(camera, mask);
+                CHECK(morphology.n_pixels == mask.count());
+                CHECK(morphology.n_islands == static_cast<int>(island_sizes.size()));
+                CHECK(morphology.n_small_islands == std::count_if(island_sizes.begin(), island_sizes.end(), [](int size) { return size < 10; }));
+                CHECK(morphology.n_large_islands == std::count_if(island_sizes.begin(), island_sizes.end(), [](int size) { return size >= 30; }));
+                CHECK(morphology.n_medium_islands == morphology.n_islands - morphology.n_small_islands - morphology.n_large_islands);
+                Eigen::VectorXd image = Eigen::VectorXd::Ones(n_pixels);
+                auto sparse_morphology = ImageProcessor::morphology_parameter(camera, SparseImage::from_mask(mask, image));
+                CHECK(sparse_morphology.n_islands == morphology.n_islands);
+                CHECK(sparse_morphology.n_medium_islands == morphology.n_medium_islands);
+            }
+        }
+    }
+    SUBCASE("test_empty_and_full_camera")
+    {
+        auto morphology = ImageProcessor::morphology_parameter(camera, PixelMask(n_pixels));
+        CHECK(morphology.n_pixels == 0);
+        CHECK(morphology.n_islands == 0);
+        Eigen::Vector<bool, -1> all_pixels = Eigen::Vector<bool, -1>::Constant(n_pixels, true);
+        morphology = ImageProcessor::morphology_parameter(camera, PixelMask::from_bools(all_pixels));
+        CHECK(morphology.n_islands == 1);
+        CHECK(morphology.n_large_islands == 1);
+    }
+}
+
+TEST_CASE("ImagePreScreen")
+{
+    auto camera = make_hex_camera(10);
+    const int n_pixels = camera.num_pixels;
+    ImagePreScreen pre_screen;
+    SUBCASE("test_reason_codes")
+    {
+        Eigen::VectorXd image = Eigen::VectorXd::Constant(n_pixels, 3.0);
+        CHECK(pre_screen(image) == ImageRejection::too_few_picture_pixels);
+        image.head(3).setConstant(10.0);
+        pre_screen.min_max_charge = 15;
+        CHECK(pre_screen(image) == ImageRejection::max_charge_too_low);
+        pre_screen.min_max_charge = 10;
+        CHECK(pre_screen(image) == ImageRejection::total_charge_too_low);
+        image.segment(3, 4).setConstant(6.0);
+        CHECK(pre_screen(image) == ImageRejection::none);
+        pre_screen.enabled = false;
+        CHECK(pre_screen(Eigen::VectorXd::Zero(n_pixels)) == ImageRejection::none);
+    }
+    SUBCASE("test_no_loss_with_default_cleaning")
+    {
+        // Images the pre-screen rejects never pass the intensity cut after the default tailcuts cleaning
+        TailcutsCleaner cleaner;
+        pre_screen = ImagePreScreen::from_cleaning(cleaner, 50);
+        CHECK(pre_screen.min_picture_pixels == 3);
+        CHECK(pre_screen.min_total_charge == 50);
+        std::mt19937 rng(9);
+        std::normal_distribution<double> noise(0, 3);
+        std::uniform_int_distribution<int> pixel(0, n_pixels - 1);
+        std::uniform_real_distribution<double> amplitude(0, 40);
+        int n_rejected = 0;
+        for(int trial = 0; trial < 500; trial++)
+        {
+            Eigen::VectorXd image(n_pixels);
+            for(int i = 0; i < n_pixels; i++)
+            {
+                image[i] = noise(rng);
+            }
+            const int center = pixel(rng);
+            const double signal = amplitude(rng);
+            image[center] += signal;
+            for(int32_t j = camera.neighbor_offsets[center]; j < camera.neighbor_offsets[center + 1]; j++)
+            {
+                image[camera.neighbor_indices[j]] += signal / 2;
+            }
+            if(pre_screen(image) != ImageRejection::none)
+            {
+                n_rejected++;
+                CHECK(cleaner.clean(camera, image).sum() < 50);
+            }
+        }
+        CHECK(n_rejected > 100);
+        CHECK(n_rejected < 500);
+    }
+    SUBCASE("test_cuts_follow_the_cleaning")
+    {
+        SubarrayDescription subarray;
+        TelescopeDescription tel;
+        tel.camera_description.camera_geometry = std::make_shared<CameraGeometry>(camera);
+        subarray.add_telescope(1, std::move(tel), {0, 0, 0});
+        auto process = [&subarray, n_pixels](const json& config, const Eigen::VectorXd& image) {
+            ImageProcessor processor(subarray, config);
+            ArrayEvent event;
+            event.emplace_level<DL0Event>();
+            event.dl0->add_tel(1, DL0Camera{image, Eigen::VectorXd::Zero(n_pixels)});
+            processor(event);
+            return event.dl1->rejected_tels.count(1) ? event.dl1->rejected_tels.at(1) : ImageRejection::none;
+        };
+        // One bright pixel with a boundary neighbor: only kept with isolated pixels, with 40 p.e. in total
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels);
+        image[0] = 30;
+        image[camera.neighbor_indices[camera.neighbor_offsets[0]]] = 10;
+        REQUIRE(pre_screen(image) != ImageRejection::none);
+
+        CHECK(process(json::object(), image) == ImageRejection::too_few_picture_pixels);
+        json loose_cleaning = {{"min_intensity", 30}, {"Tailcuts_cleaner", {{"keep_isolated_pixels", true}}}};
+        CHECK(process(loose_cleaning, image) == ImageRejection::none);
+        // The default cleaning keeps three picture pixels with two picture neighbors each, 33 p.e. in total
+        image.setZero();
+        image[0] = 11;
+        for(int32_t j = camera.neighbor_offsets[0]; j < camera.neighbor_offsets[0] + 2; j++)
+        {
+            image[camera.neighbor_indices[j]] = 11;
+        }
+        REQUIRE(TailcutsCleaner().clean(camera, image).size() == 3);
+        CHECK(process(json::object(), image) == ImageRejection::total_charge_too_low);
+        CHECK(process(json{{"min_intensity", 20}}, image) == ImageRejection::none);
+
+        // Explicit cuts may be looser than the cleaning, not tighter. Here the intensity cut rejects the image instead
+        CHECK(process(json{{"pre_screen", {{"min_total_charge", 10}}}}, image) == ImageRejection::intensity_too_low);
+        CHECK_THROWS_AS(ImageProcessor(subarray, json{{"min_intensity", 20}, {"pre_screen", {{"min_total_charge", 50}}}}), std::runtime_error);
+        CHECK_THROWS_AS(ImageProcessor(subarray, json{{"pre_screen", {{"picture_thresh", 12}}}}), std::runtime_error);
+    }
+}
+
+TEST_CASE("PixelMask")
+{
+    auto mask = PixelMask(130);
+    CHECK(mask.words().size() == 3);
+    mask.set(0);
+    mask.set(64);
+    mask.set(129);
+    CHECK(mask.count() == 3);
+    std::vector<int> pixels;
+    mask.for_each([&pixels](int i) { pixels.push_back(i); });
+    CHECK(pixels == std::vector<int>{0, 64, 129});
+    CHECK(PixelMask::from_bools(mask.to_bools()) == mask);
+    // Bits past the last pixel are dropped when reading words back
+    std::vector<uint64_t> words = mask.words();
+    words.back() |= uint64_t(1) << 10;
+    CHECK(PixelMask::from_words(words.data(), words.size(), 130) == mask);
+    CHECK_THROWS_AS(PixelMask::from_words(words.data(), 2, 130), std::runtime_error);
+    auto other = PixelMask(130);
+    other.set(64);
+    other.set(65);
+    CHECK(mask.count_and(other) == 1);
+    CHECK((mask | other).count() == 4);
+    CHECK_THROWS_AS(mask &= PixelMask(129), std::runtime_error);
+}
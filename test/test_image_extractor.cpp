@@ -0,0 +1,256 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "ImageExtractor.hh"
+#include "R1Calibration.hh"
+#include "doctest/doctest.h"
+#include <cmath>
+#include <random>
+
+namespace {
+// The per pixel extraction the prefix sums replace, with the peak from maxCoeff and the charge summed in float
+std::pair<Eigen::VectorXd, Eigen::VectorXd> reference_local_peak(const R1WaveformMatrix& waveform, int window_width, int window_shift, double sampling_rate_ghz, Eigen::VectorXi& peak_index)
+{
+    int n_pixels = waveform.rows();
+    Eigen::VectorXd charge = Eigen::VectorXd::Zero(n_pixels);
+    Eigen::VectorXd peak_time = Eigen::VectorXd::Zero(n_pixels);
+    peak_index.resize(n_pixels);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        Eigen::Index max_index;
+        waveform.row(ipix).maxCoeff(&max_index);
+        peak_index(ipix) = max_index;
+        int start = std::max(0, peak_index(ipix) - window_shift);
+        int end = std::min((int)waveform.cols(), peak_index(ipix) - window_shift + window_width);
+        charge(ipix) = waveform.block(ipix, start, 1, end - start).sum();
+        double time_sum = 0;
+        for(int i = start; i < end; i++) {
+            if(waveform(ipix, i) > 0) {
+                time_sum += i * waveform(ipix, i);
+            }
+        }
+        peak_time(ipix) = time_sum / charge(ipix) / sampling_rate_ghz;
+    }
+    return std::make_pair(charge, peak_time);
+}
+// Integration correction with the search over all the edges for every sample of the reference pulse
+Eigen::VectorXd reference_integration_correction(const Eigen::MatrixXd& reference_pulse, double reference_pulse_sample_width_ns, double sample_width_ns, int window_width, int window_shift)
+{
+    Eigen::VectorXd correction = Eigen::VectorXd::Ones(reference_pulse.rows());
+    for(int ich = 0; ich < reference_pulse.rows(); ich++) {
+        Eigen::VectorXd pulse = reference_pulse.row(ich);
+        double max_pulse_time = (pulse.size() - 0.5) * reference_pulse_sample_width_ns;
+        Eigen::VectorXd pulse_shape_x = Eigen::VectorXd::LinSpaced(pulse.size(), 0.5 * reference_pulse_sample_width_ns, max_pulse_time);
+        int n_sampled_edges = static_cast<int>(std::ceil(max_pulse_time / sample_width_ns)) + 1;
+        Eigen::VectorXd sampled_edges = Eigen::VectorXd::LinSpaced(n_sampled_edges, 0, max_pulse_time);
+        Eigen::VectorXd sampled_pulse = Eigen::VectorXd::Zero(n_sampled_edges - 1);
+        for(int i = 0; i < pulse.size(); i++) {
+            for(int j = 0; j < n_sampled_edges - 1; j++) {
+                if(pulse_shape_x(i) >= sampled_edges(j) && pulse_shape_x(i) < sampled_edges(j + 1)) {
+                    sampled_pulse(j) += pulse(i);
+                    break;
+                }
+            }
+        }
+        double total_weight = pulse.sum();
+        for(int j = 0; j < n_sampled_edges - 1; j++) {
+            sampled_pulse(j) = sampled_pulse(j) / total_weight;
+        }
+        Eigen::Index max_index;
+        sampled_pulse.maxCoeff(&max_index);
+        int start = std::max(0, static_cast<int>(max_index) - window_shift);
+        int end = std::min(static_cast<int>(sampled_pulse.size()), start + window_width);
+        double integration = 0;
+        for(int i = start; i < end; i++) {
+            integration += sampled_pulse(i);
+        }
+        if(integration != 0) {
+            correction(ich) = 1.0 / integration;
+        }
+    }
+    return correction;
+}
+Eigen::MatrixXd gaussian_pulse_shape(int n_channels, int n_points, double sample_width_ns, double center_ns, double sigma_ns)
+{
+    Eigen::MatrixXd pulse(n_channels, n_points);
+    for(int ich = 0; ich < n_channels; ich++) {
+        for(int i = 0; i < n_points; i++) {
+            double t = (i + 0.5) * sample_width_ns - center_ns;
+            double sigma = sigma_ns * (1 + 0.3 * ich);
+            pulse(ich, i) = std::exp(-0.5 * t * t / (sigma * sigma));
+        }
+    }
+    return pulse;
+}
+TelescopeDescription telescope_with_readout(const std::string& camera_name, double sampling_rate, const Eigen::MatrixXd& pulse, double pulse_sample_width)
+{
+    TelescopeDescription tel;
+    tel.camera_description.camera_name = camera_name;
+    auto& readout = tel.camera_description.camera_readout;
+    readout.camera_name = camera_name;
+    readout.sampling_rate = sampling_rate;
+    readout.reference_pulse_sample_width = pulse_sample_width;
+    readout.reference_pulse_shape = pulse;
+    readout.n_channels = pulse.rows();
+    return tel;
+}
+}
+
+TEST_CASE("test_extract_around_peak_r0_matches_r1")
+{
+    std::mt19937 rng(7);
+    int n_pixels = 200;
+    int n_samples = 40;
+    int window_width = 7;
+    int window_shift = 3;
+    double sampling_rate_ghz = 1.0;
+
+    // Pedestal noise plus a pulse at a random position, some pulses close to the edges of the readout window
+    std::normal_distribution<double> noise(0, 5);
+    std::uniform_int_distribution<int> pulse_position(0, n_samples - 1);
+    std::uniform_real_distribution<double> amplitude(20, 3000);
+    std::array<WaveformMatrix, 2> waveform{WaveformMatrix(n_pixels, n_samples), WaveformMatrix(n_pixels, n_samples)};
+    TelMonitor monitor;
+    monitor.n_channels = 2;
+    monitor.n_pixels = n_pixels;
+    monitor.pedestal_per_sample.resize(2, n_pixels);
+    monitor.dc_to_pe.resize(2, n_pixels);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        int position = pulse_position(rng);
+        double pulse = amplitude(rng);
+        for(int ich = 0; ich < 2; ich++) {
+            double pedestal = 300.5 + ich * 10 + ipix % 5 * 0.25;
+            monitor.pedestal_per_sample(ich, ipix) = pedestal;
+            monitor.dc_to_pe(ich, ipix) = ich == 0 ? 0.02 : 0.2;
+            for(int isample = 0; isample < n_samples; isample++) {
+                double signal = pulse / (ich == 0 ? 1 : 10) * std::exp(-0.5 * (isample - position) * (isample - position));
+                waveform[ich](ipix, isample) = static_cast<uint16_t>(std::max(0.0, std::round(pedestal + noise(rng) + signal)));
+            }
+        }
+    }
+    Eigen::VectorXi gain_selection(n_pixels);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        gain_selection(ipix) = ipix % 4 == 0;
+    }
+
+    R1WaveformMatrix r1_waveform;
+    R1Calibration::calibrate_reference(waveform, gain_selection, monitor, r1_waveform);
+    Eigen::VectorXi peak_index(n_pixels);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        Eigen::Index max_index;
+        r1_waveform.row(ipix).maxCoeff(&max_index);
+        peak_index(ipix) = max_index;
+    }
+    auto [r1_charge, r1_time] = extract_around_peak(r1_waveform, peak_index, Eigen::VectorXi::Constant(n_pixels, window_width), Eigen::VectorXi::Constant(n_pixels, window_shift), sampling_rate_ghz);
+    auto [r0_charge, r0_time] = extract_around_peak_r0(waveform, gain_selection, monitor, window_width, window_shift, sampling_rate_ghz);
+
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        CAPTURE(ipix);
+        CHECK(r0_charge(ipix) == doctest::Approx(r1_charge(ipix)).epsilon(1e-4));
+        if(std::abs(r1_charge(ipix)) > 1) {
+            CHECK(r0_time(ipix) == doctest::Approx(r1_time(ipix)).epsilon(1e-4));
+        }
+    }
+}
+
+TEST_CASE("test_extract_around_local_peak_matches_reference")
+{
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0, 2);
+    std::uniform_real_distribution<float> amplitude(0, 500);
+    // Pixel counts that are not a multiple of the tile, pulses at the edges of the readout window
+    for(int n_pixels: {1, 31, 1039})
+    {
+        for(int n_samples: {5, 40, 75})
+        {
+            std::uniform_int_distribution<int> pulse_position(0, n_samples - 1);
+            R1WaveformMatrix waveform(n_pixels, n_samples);
+            for(int ipix = 0; ipix < n_pixels; ipix++) {
+                int position = pulse_position(rng);
+                float pulse = ipix % 7 == 0 ? 0 : amplitude(rng);
+                for(int isample = 0; isample < n_samples; isample++) {
+                    waveform(ipix, isample) = noise(rng) + pulse * std::exp(-0.3f * (isample - position) * (isample - position));
+                }
+                if(ipix % 11 == 0) {
+                    // Ties keep the first maximum
+                    waveform.row(ipix).setConstant(1.5f);
+                }
+            }
+            for(auto [window_width, window_shift]: {std::pair{7, 3}, std::pair{3, 0}, std::pair{100, 50}, std::pair{1, 0}})
+            {
+                CAPTURE(n_pixels);
+                CAPTURE(n_samples);
+                CAPTURE(window_width);
+                CAPTURE(window_shift);
+                Eigen::VectorXi peak_index;
+                auto [reference_charge, reference_time] = reference_local_peak(waveform, window_width, window_shift, 0.5, peak_index);
+                auto [charge, peak_time] = extract_around_local_peak(waveform, window_width, window_shift, 0.5);
+                CHECK(ImageExtractor::get_peak_index(waveform) == peak_index);
+                // Given the peaks, the general extraction gives the same numbers
+                auto [charge_from_peak, time_from_peak] = extract_around_peak(waveform, peak_index, Eigen::VectorXi::Constant(n_pixels, window_width), Eigen::VectorXi::Constant(n_pixels, window_shift), 0.5);
+                for(int ipix = 0; ipix < n_pixels; ipix++) {
+                    CAPTURE(ipix);
+                    // The reference sums in float, the extraction in double, from the prefix sums or the samples
+                    double scale = waveform.row(ipix).cwiseAbs().sum();
+                    CHECK(std::abs(charge_from_peak(ipix) - charge(ipix)) <= 1e-12 * scale);
+                    CHECK(std::abs(charge(ipix) - reference_charge(ipix)) <= 1e-6 * scale);
+                    if(std::abs(reference_charge(ipix)) > 1) {
+                        CHECK(peak_time(ipix) == doctest::Approx(reference_time(ipix)).epsilon(1e-4));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("test_integration_correction")
+{
+    SUBCASE("binning matches the search over all edges")
+    {
+        for(double pulse_sample_width: {0.05, 0.1, 0.25})
+        {
+            for(double sample_width: {1.0, 2.0, 0.75, 1.0 / 0.3})
+            {
+                CAPTURE(pulse_sample_width);
+                CAPTURE(sample_width);
+                Eigen::MatrixXd pulse = gaussian_pulse_shape(2, static_cast<int>(40 / pulse_sample_width), pulse_sample_width, 12.3, 2.1);
+                for(auto [window_width, window_shift]: {std::pair{7, 3}, std::pair{3, 1}, std::pair{1, 0}})
+                {
+                    CHECK(ImageExtractor::compute_integration_correction(pulse, pulse_sample_width, sample_width, window_width, window_shift)
+                          == reference_integration_correction(pulse, pulse_sample_width, sample_width, window_width, window_shift));
+                }
+            }
+        }
+    }
+    SUBCASE("computed once for each camera readout")
+    {
+        Eigen::MatrixXd pulse = gaussian_pulse_shape(2, 400, 0.1, 10, 2);
+        SubarrayDescription subarray;
+        subarray.add_telescope(1, telescope_with_readout("LACT", 1.0, pulse, 0.1), {0, 0, 0});
+        subarray.add_telescope(2, telescope_with_readout("LACT", 1.0, pulse, 0.1), {100, 0, 0});
+        subarray.add_telescope(7, telescope_with_readout("LACT", 1.0, pulse, 0.1), {0, 100, 0});
+        subarray.add_telescope(4, telescope_with_readout("LACT", 0.5, pulse, 0.1), {100, 100, 0});
+        subarray.add_telescope(5, telescope_with_readout("OTHER", 1.0, gaussian_pulse_shape(2, 400, 0.1, 10, 3), 0.1), {200, 0, 0});
+
+        LocalPeakExtractor extractor(subarray);
+        CHECK(&extractor.get_integration_correction(1) == &extractor.get_integration_correction(2));
+        CHECK(&extractor.get_integration_correction(1) == &extractor.get_integration_correction(7));
+        CHECK(&extractor.get_integration_correction(1) != &extractor.get_integration_correction(4));
+        CHECK(&extractor.get_integration_correction(1) != &extractor.get_integration_correction(5));
+        for(int tel_id: {1, 2, 7, 4, 5})
+        {
+            CAPTURE(tel_id);
+            const auto& readout = subarray.tels.at(tel_id).camera_description.camera_readout;
+            CHECK(extractor.get_integration_correction(tel_id) == ImageExtractor::compute_integration_correction(readout.reference_pulse_shape, readout.reference_pulse_sample_width, 1 / readout.sampling_rate, 7, 3));
+        }
+        CHECK_THROWS_AS(extractor.get_integration_correction(3), std::out_of_range);
+        CHECK_THROWS_AS(extractor.get_integration_correction(8), std::out_of_range);
+
+        // The charge of each pixel is scaled by the correction of its gain
+        R1WaveformMatrix waveform = R1WaveformMatrix::Zero(2, 20);
+        waveform(0, 8) = 10;
+        waveform(1, 8) = 10;
+        Eigen::VectorXi gain_selection(2);
+        gain_selection << 0, 1;
+        auto [charge, peak_time] = extractor(waveform, gain_selection, 4);
+        CHECK(charge(0) == doctest::Approx(10 * extractor.get_integration_correction(4)(0)));
+        CHECK(charge(1) == doctest::Approx(10 * extractor.get_integration_correction(4)(1)));
+    }
+}
@@ -0,0 +1,140 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "ImageProcessor.hh"
+#include "doctest/doctest.h"
+#include "test_camera_helpers.hh"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+// The hillas parameters as computed before the fused kernel, with the eigen solver of Eigen
+HillasParameter reference_hillas_parameter(const CameraGeometry& camera_geometry, const Eigen::VectorXd& masked_image)
+{
+    double intensity = masked_image.sum();
+    Eigen::MatrixXd cov_matrix{2, 2};
+    double x = camera_geometry.get_pix_x_fov().dot(masked_image)/intensity;
+    double y = camera_geometry.get_pix_y_fov().dot(masked_image)/intensity;
+    Eigen::VectorXd delta_x = camera_geometry.get_pix_x_fov().array() - x;
+    Eigen::VectorXd delta_y = camera_geometry.get_pix_y_fov().array() - y;
+    cov_matrix(0, 0) = (delta_x.array().square() * masked_image.array()).sum()/(intensity - 1);
+    cov_matrix(1, 1) = (delta_y.array().square() * masked_image.array()).sum()/(intensity - 1);
+    cov_matrix(0, 1) = (delta_x.array() * delta_y.array() * masked_image.array()).sum()/(intensity - 1);
+    cov_matrix(1, 0) = cov_matrix(0, 1);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(cov_matrix);
+    double length = std::sqrt(eigensolver.eigenvalues()(1));
+    double width = std::sqrt(eigensolver.eigenvalues()(0));
+    double psi = std::atan2(eigensolver.eigenvectors().col(1)[1], eigensolver.eigenvectors().col(1)[0]);
+    Eigen::VectorXd longitudinal = delta_x.array() * std::cos(psi) + delta_y.array() * std::sin(psi);
+    double m3_long = pow(longitudinal.array(), 3).matrix().dot(masked_image)/intensity;
+    double m4_long = pow(longitudinal.array(), 4).matrix().dot(masked_image)/intensity;
+    return HillasParameter{length, width, psi, x, y, m3_long/pow(length, 3), m4_long/pow(length, 4), intensity, std::sqrt(x*x + y*y), std::atan2(y, x)};
+}
+// Relative tolerance, with an absolute floor of the order of the pixel size for the angles
+doctest::Approx close(double value, double scale = 1)
+{
+    return doctest::Approx(value).epsilon(1e-8).scale(scale);
+}
+void check_moment_parameters(const CameraGeometry& camera, const Eigen::VectorXd& image, const PixelMask& mask)
+{
+    Eigen::VectorXd masked_image = mask.masked(image);
+    auto parameters = ImageProcessor::moment_parameters(camera, image, mask);
+    auto reference = reference_hillas_parameter(camera, masked_image);
+    const auto& hillas = parameters.hillas;
+    CHECK(hillas.intensity == close(reference.intensity));
+    CHECK(hillas.x == close(reference.x, 1e-3));
+    CHECK(hillas.y == close(reference.y, 1e-3));
+    CHECK(hillas.r == close(reference.r, 1e-3));
+    CHECK(hillas.phi == close(reference.phi));
+    CHECK(hillas.length == close(reference.length, 1e-3));
+    CHECK(hillas.width == close(reference.width, 1e-3));
+    // The eigen solver may return the major axis in either direction, the skewness changes its sign with it
+    CHECK(hillas.psi > -M_PI / 2);
+    CHECK(hillas.psi <= M_PI / 2);
+    double axis_sign = std::cos(hillas.psi - reference.psi) > 0 ? 1 : -1;
+    CHECK(std::abs(std::sin(hillas.psi - reference.psi)) < 1e-8);
+    CHECK(hillas.skewness == close(axis_sign * reference.skewness));
+    CHECK(hillas.kurtosis == close(reference.kurtosis));
+
+    auto concentration = ImageProcessor::concentration_parameter(camera, masked_image, reference);
+    CHECK(parameters.concentration.concentration_cog == close(concentration.concentration_cog));
+    CHECK(parameters.concentration.concentration_core == close(concentration.concentration_core));
+    CHECK(parameters.concentration.concentration_pixel == close(concentration.concentration_pixel));
+
+    auto intensity = ImageProcessor::intensity_parameter(masked_image);
+    CHECK(parameters.intensity.intensity_max == close(intensity.intensity_max));
+    CHECK(parameters.intensity.intensity_mean == close(intensity.intensity_mean));
+    CHECK(parameters.intensity.intensity_std == close(intensity.intensity_std));
+    CHECK(parameters.intensity.intensity_skewness == close(intensity.intensity_skewness));
+    CHECK(parameters.intensity.intensity_kurtosis == close(intensity.intensity_kurtosis));
+}
+}
+
+TEST_CASE("ImageProcessor moment parameters")
+{
+    // About 0.1 degree per pixel in the fov frame
+    auto camera = make_hex_camera(15, 1.0 / 500);
+    const int n_pixels = camera.num_pixels;
+    std::mt19937 rng(11);
+    SUBCASE("test_matches_separate_passes")
+    {
+        std::uniform_real_distribution<double> uniform(-1, 1);
+        std::normal_distribution<double> noise(0, 1);
+        int n_images = 0;
+        for(int trial = 0; trial < 200; trial++)
+        {
+            // Elliptical shower with a tail towards positive longitudinal coordinates
+            const double cog_x = 6 * uniform(rng);
+            const double cog_y = 6 * uniform(rng);
+            const double psi = M_PI * uniform(rng);
+            const double length = 2.5 + uniform(rng);
+            const double width = 0.8 + 0.3 * uniform(rng);
+            Eigen::VectorXd image(n_pixels);
+            for(int i = 0; i < n_pixels; i++)
+            {
+                const double dx = camera.pix_x[i] - cog_x;
+                const double dy = camera.pix_y[i] - cog_y;
+                const double longitudinal = dx * std::cos(psi) + dy * std::sin(psi);
+                const double transverse = -dx * std::sin(psi) + dy * std::cos(psi);
+                const double tail = longitudinal > 0 ? 1.5 : 1;
+                image[i] = 200 * std::exp(-0.5 * (std::pow(longitudinal / (tail * length), 2) + std::pow(transverse / width, 2))) + 2 * noise(rng);
+            }
+            auto mask = ImageProcessor::tailcuts_clean(camera, image, 10, 5, false, 2);
+            if(mask.sum(image) < 50)
+            {
+                continue;
+            }
+            n_images++;
+            check_moment_parameters(camera, image, mask);
+        }
+        CHECK(n_images > 150);
+    }
+    SUBCASE("test_whole_camera")
+    {
+        // Without pixels outside the mask the maximum is not bounded by zero
+        std::uniform_real_distribution<double> signal(1, 30);
+        Eigen::VectorXd image(n_pixels);
+        for(int i = 0; i < n_pixels; i++)
+        {
+            image[i] = signal(rng) + (camera.pix_x[i] > 3 ? 20 : 0);
+        }
+        Eigen::Vector<bool, -1> all_pixels = Eigen::Vector<bool, -1>::Constant(n_pixels, true);
+        check_moment_parameters(camera, image, PixelMask::from_bools(all_pixels));
+    }
+    SUBCASE("test_axis_along_y")
+    {
+        // Pixels on a vertical line, the major axis has no x component
+        Eigen::VectorXd image = Eigen::VectorXd::Zero(n_pixels);
+        auto mask = PixelMask(n_pixels);
+        for(int i = 0; i < n_pixels; i++)
+        {
+            if(std::abs(camera.pix_x[i]) < 1e-9 && std::abs(camera.pix_y[i]) < 8)
+            {
+                image[i] = 100 + camera.pix_y[i];
+                mask.set(i);
+            }
+        }
+        auto hillas = ImageProcessor::moment_parameters(camera, image, mask).hillas;
+        CHECK(hillas.psi == close(M_PI / 2));
+        CHECK(hillas.width == close(0, 1e-3));
+    }
+}
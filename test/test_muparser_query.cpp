@@ -1,6 +1,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include "ImageQuery.hh"
+#include <atomic>
+#include <thread>
+#include <vector>
 
 
 TEST_CASE("TEST_SIMPLE_STRING_QUERY")
@@ -34,4 +37,42 @@ TEST_CASE("TEST_CONFIG_QUERY")
     image_parameters.hillas.intensity = 101;
     image_parameters.hillas.length = 1;
     CHECK((*query_parser)(image_parameters) == true);
-}
\ No newline at end of file
+}
+TEST_CASE("TEST_QUERY_SHARED_BETWEEN_THREADS")
+{
+    const ImageQuery query("hillas_intensity > 100 && leakage_intensity_width_2 < 0.3");
+    std::atomic<int> n_wrong = 0;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 8; i++)
+    {
+        threads.emplace_back([&query, &n_wrong, i]() {
+            ImageParameters image_parameters;
+            for(int j = 0; j < 2000; j++)
+            {
+                image_parameters.hillas.intensity = 50 + (i * 2000 + j) % 100;
+                image_parameters.leakage.intensity_width_2 = (j % 5) * 0.1;
+                bool expected = image_parameters.hillas.intensity > 100 && image_parameters.leakage.intensity_width_2 < 0.3;
+                if(query(image_parameters) != expected)
+                {
+                    n_wrong++;
+                }
+            }
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+    CHECK(n_wrong == 0);
+}
+TEST_CASE("TEST_QUERY_REPLACED")
+{
+    ImageParameters image_parameters;
+    image_parameters.hillas.intensity = 101;
+    // A query created after another one is destroyed must not use the parser of the old one
+    for(int i = 0; i < 10; i++)
+    {
+        auto query_parser = std::make_unique<ImageQuery>(i % 2 == 0 ? "hillas_intensity > 100" : "hillas_intensity < 100");
+        CHECK((*query_parser)(image_parameters) == (i % 2 == 0));
+    }
+}
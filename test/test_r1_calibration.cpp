@@ -0,0 +1,77 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "R1Calibration.hh"
+#include "doctest/doctest.h"
+#include <cmath>
+#include <random>
+
+static TelMonitor make_monitor(int n_pixels, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> pedestal(200, 400);
+    std::uniform_real_distribution<double> dc_to_pe(0.005, 0.2);
+    TelMonitor monitor;
+    monitor.n_channels = 2;
+    monitor.n_pixels = n_pixels;
+    monitor.pedestal_per_sample.resize(2, n_pixels);
+    monitor.dc_to_pe.resize(2, n_pixels);
+    for(int ich = 0; ich < 2; ich++) {
+        for(int ipix = 0; ipix < n_pixels; ipix++) {
+            monitor.pedestal_per_sample(ich, ipix) = pedestal(rng);
+            monitor.dc_to_pe(ich, ipix) = dc_to_pe(rng);
+        }
+    }
+    return monitor;
+}
+
+TEST_CASE("test_calibrate_matches_reference")
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> adc(0, 65535);
+    // Odd sample counts exercise the tail of the vectorized loop
+    for(int n_samples: {1, 7, 16, 33, 75}) {
+        int n_pixels = 101;
+        std::array<WaveformMatrix, 2> waveform{WaveformMatrix(n_pixels, n_samples), WaveformMatrix(n_pixels, n_samples)};
+        for(auto& channel: waveform) {
+            for(Eigen::Index i = 0; i < channel.size(); i++) {
+                channel.data()[i] = static_cast<uint16_t>(adc(rng));
+            }
+        }
+        Eigen::VectorXi gain_selection(n_pixels);
+        for(int ipix = 0; ipix < n_pixels; ipix++) {
+            gain_selection(ipix) = ipix % 3 == 0;
+        }
+        auto monitor = make_monitor(n_pixels, rng);
+
+        R1WaveformMatrix fast, reference;
+        R1Calibration::calibrate(waveform, gain_selection, monitor, fast);
+        R1Calibration::calibrate_reference(waveform, gain_selection, monitor, reference);
+        REQUIRE(fast.rows() == n_pixels);
+        REQUIRE(fast.cols() == n_samples);
+        for(int ipix = 0; ipix < n_pixels; ipix++) {
+            for(int isample = 0; isample < n_samples; isample++) {
+                // Folding the pedestal into an offset loses a few float ulps relative to the largest term
+                double gain = monitor.dc_to_pe(gain_selection(ipix), ipix);
+                double tolerance = 1e-6 * gain * (65535 + 400);
+                CHECK(std::abs(fast(ipix, isample) - reference(ipix, isample)) <= tolerance);
+            }
+        }
+    }
+}
+
+TEST_CASE("test_calibrate_uses_selected_gain")
+{
+    std::mt19937 rng(1);
+    int n_pixels = 4;
+    int n_samples = 3;
+    std::array<WaveformMatrix, 2> waveform{WaveformMatrix::Constant(n_pixels, n_samples, 1000), WaveformMatrix::Constant(n_pixels, n_samples, 500)};
+    Eigen::VectorXi gain_selection(n_pixels);
+    gain_selection << 0, 1, 0, 1;
+    auto monitor = make_monitor(n_pixels, rng);
+    R1WaveformMatrix r1;
+    R1Calibration::calibrate(waveform, gain_selection, monitor, r1);
+    for(int ipix = 0; ipix < n_pixels; ipix++) {
+        int gain = gain_selection(ipix);
+        double expected = (waveform[gain](ipix, 0) - monitor.pedestal_per_sample(gain, ipix)) * monitor.dc_to_pe(gain, ipix);
+        CHECK(r1(ipix, 0) == doctest::Approx(expected).epsilon(1e-5));
+        CHECK(r1(ipix, n_samples - 1) == r1(ipix, 0));
+    }
+}
@@ -0,0 +1,186 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "RandomGenerator.hh"
+#include "ImageProcessor.hh"
+#include "doctest/doctest.h"
+#include "test_camera_helpers.hh"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+// Two sample chi-square of the histograms of two samples of the same size, bins with few entries are merged
+double two_sample_chi_square(const std::vector<int>& first, const std::vector<int>& second, int& degrees_of_freedom)
+{
+    std::map<int, std::pair<int, int>> histogram;
+    for(auto value: first)
+    {
+        histogram[value].first++;
+    }
+    for(auto value: second)
+    {
+        histogram[value].second++;
+    }
+    double chi_square = 0;
+    int n_bins = 0;
+    std::pair<int, int> pending{0, 0};
+    for(const auto& [value, counts]: histogram)
+    {
+        pending.first += counts.first;
+        pending.second += counts.second;
+        if(pending.first + pending.second < 20)
+        {
+            continue;
+        }
+        chi_square += std::pow(pending.first - pending.second, 2) / (pending.first + pending.second);
+        n_bins++;
+        pending = {0, 0};
+    }
+    if(pending.first + pending.second > 0)
+    {
+        chi_square += std::pow(pending.first - pending.second, 2) / (pending.first + pending.second);
+        n_bins++;
+    }
+    degrees_of_freedom = n_bins - 1;
+    return chi_square;
+}
+}
+
+TEST_CASE("Philox4x32")
+{
+    SUBCASE("test_known_answers")
+    {
+        // Known answer vectors of the Random123 reference implementation
+        Philox4x32 zero({0, 0});
+        CHECK(zero({0, 0, 0, 0}) == Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+        Philox4x32 ones({0xffffffff, 0xffffffff});
+        CHECK(ones({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}) == Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+        Philox4x32 pi({0xa4093822, 0x299f31d0});
+        CHECK(pi({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}) == Philox4x32::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+    }
+    SUBCASE("test_uniform_range")
+    {
+        Philox4x32 generator({1, 2});
+        double sum = 0;
+        double min_value = 1;
+        double max_value = 0;
+        const int n_blocks = 100000;
+        for(int i = 0; i < n_blocks; i++)
+        {
+            for(auto u: generator.uniform_pair({static_cast<uint32_t>(i), 0, 0, 0}))
+            {
+                min_value = std::min(min_value, u);
+                max_value = std::max(max_value, u);
+                sum += u;
+            }
+        }
+        CHECK(min_value >= 0);
+        CHECK(max_value < 1);
+        CHECK(sum / (2 * n_blocks) == doctest::Approx(0.5).epsilon(0.005));
+    }
+}
+
+TEST_CASE("PoissonSampler")
+{
+    SUBCASE("test_matches_std_poisson_distribution")
+    {
+        const int n_samples = 200000;
+        std::mt19937 rng(17);
+        for(double mean: {0.05, 0.7, 3.0, 12.5, 60.0, 100.0})
+        {
+            CAPTURE(mean);
+            PoissonSampler sampler(mean);
+            CHECK(sampler.uses_table());
+            Eigen::VectorXi samples(n_samples);
+            sampler.fill(samples, Philox4x32({42, 7}), {3, 5});
+            std::poisson_distribution<int> poisson(mean);
+            std::vector<int> reference(n_samples);
+            for(auto& value: reference)
+            {
+                value = poisson(rng);
+            }
+            int degrees_of_freedom = 0;
+            double chi_square = two_sample_chi_square(std::vector<int>(samples.begin(), samples.end()), reference, degrees_of_freedom);
+            CAPTURE(degrees_of_freedom);
+            // About five standard deviations above the expected value
+            CHECK(chi_square < degrees_of_freedom + 5 * std::sqrt(2.0 * degrees_of_freedom) + 5);
+        }
+    }
+    SUBCASE("test_normal_approximation_moments")
+    {
+        const int n_samples = 200000;
+        for(double mean: {150.0, 1000.0})
+        {
+            CAPTURE(mean);
+            PoissonSampler sampler(mean);
+            CHECK_FALSE(sampler.uses_table());
+            Eigen::VectorXi samples(n_samples);
+            sampler.fill(samples, Philox4x32({42, 7}), {3, 5});
+            Eigen::VectorXd values = samples.cast<double>();
+            const double sample_mean = values.mean();
+            const double sample_variance = (values.array() - sample_mean).square().sum() / (n_samples - 1);
+            CHECK(std::abs(sample_mean - mean) < 5 * std::sqrt(mean / n_samples));
+            CHECK(sample_variance == doctest::Approx(mean).epsilon(0.02));
+        }
+    }
+    SUBCASE("test_reproducible_streams")
+    {
+        PoissonSampler sampler(4.0);
+        Eigen::VectorXi first(1855), second(1855), other_telescope(1855), other_run(1855);
+        sampler.fill(first, Philox4x32({0, 10}), {100, 1});
+        sampler.fill(second, Philox4x32({0, 10}), {100, 1});
+        sampler.fill(other_telescope, Philox4x32({0, 10}), {100, 2});
+        sampler.fill(other_run, Philox4x32({0, 11}), {100, 1});
+        CHECK(first == second);
+        CHECK(first != other_telescope);
+        CHECK(first != other_run);
+        // The first pixels do not depend on the camera size
+        Eigen::VectorXi smaller(1039);
+        sampler.fill(smaller, Philox4x32({0, 10}), {100, 1});
+        CHECK(smaller == first.head(1039));
+    }
+    SUBCASE("test_zero_and_invalid_mean")
+    {
+        PoissonSampler sampler(0.0);
+        Eigen::VectorXi samples(101);
+        sampler.fill(samples, Philox4x32({1, 1}), {1, 1});
+        CHECK(samples.isZero());
+        CHECK_THROWS_AS(PoissonSampler(-1.0), std::runtime_error);
+        CHECK_THROWS_AS(PoissonSampler(NAN), std::runtime_error);
+    }
+}
+TEST_CASE("ImageProcessorFakeImageNoise")
+{
+    SubarrayDescription subarray;
+    TelescopeDescription tel;
+    tel.camera_description.camera_geometry = std::make_shared<const CameraGeometry>(make_hex_camera(10));
+    const int n_pixels = tel.camera_description.camera_geometry->num_pixels;
+    subarray.add_telescope(1, std::move(tel), {0, 0, 0});
+    ImageProcessor image_processor(subarray, json{{"poisson_noise", 3.0}, {"random_seed", 5}});
+    // An event built without a source, e.g. from Python, has no run and event ids set
+    auto make_event = [n_pixels]() {
+        ArrayEvent event;
+        event.emplace_level<DL0Event>();
+        auto* simulated_camera = event.emplace_level<SimulatedEvent>().add_tel(1);
+        simulated_camera->true_image = Eigen::VectorXi::Constant(n_pixels, 2);
+        simulated_camera->true_image_sum = simulated_camera->true_image.sum();
+        return event;
+    };
+    auto first = make_event();
+    auto second = make_event();
+    CHECK(first.run_id == 0);
+    CHECK(first.event_id == 0);
+    image_processor(first);
+    image_processor(second);
+    const auto& fake_image = first.simulation->tels.at(1)->fake_image;
+    REQUIRE(fake_image.size() == n_pixels);
+    CHECK(fake_image != Eigen::VectorXd::Constant(n_pixels, 2));
+    CHECK(fake_image == second.simulation->tels.at(1)->fake_image);
+    // A recycled event does not keep the ids of the previous one
+    first.run_id = 7;
+    first.event_id = 8;
+    first.reset();
+    CHECK(first.run_id == 0);
+    CHECK(first.event_id == 0);
+}
@@ -0,0 +1,163 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "Calibration.hh"
+#include "ImageProcessor.hh"
+#include "ShowerProcessor.hh"
+#include "doctest/doctest.h"
+#include "test_synthetic_events.hh"
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int n_events = 48;
+constexpr int n_threads = 4;
+
+// Bitwise comparison, so results that are NaN in both runs are equal
+template<typename T>
+bool same_bits(const T& first, const T& second)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    return std::memcmp(&first, &second, sizeof(T)) == 0;
+}
+template<typename Vector>
+bool same_values(const Vector& first, const Vector& second)
+{
+    return first.size() == second.size() && std::memcmp(first.data(), second.data(), first.size() * sizeof(first[0])) == 0;
+}
+
+std::vector<ArrayEvent> make_events(const SubarrayDescription& subarray)
+{
+    std::vector<ArrayEvent> events(n_events);
+    for(int i = 0; i < n_events; i++)
+    {
+        fill_synthetic_event(events[i], i, subarray);
+    }
+    return events;
+}
+
+void process(ArrayEvent& event, const Calibrator& calibrator, const ImageProcessor& image_processor, const ShowerProcessor& shower_processor)
+{
+    calibrator(event);
+    image_processor(event);
+    shower_processor(event);
+}
+
+// Every thread processes every n_threads-th event with the same processor instances
+std::vector<ArrayEvent> process_on_threads(const SubarrayDescription& subarray, const Calibrator& calibrator, const ImageProcessor& image_processor, const ShowerProcessor& shower_processor)
+{
+    auto events = make_events(subarray);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < n_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            try
+            {
+                for(int i = t; i < n_events; i += n_threads)
+                {
+                    process(events[i], calibrator, image_processor, shower_processor);
+                }
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error = std::current_exception();
+            }
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+    return events;
+}
+
+void check_same_results(const ArrayEvent& expected, const ArrayEvent& actual)
+{
+    CAPTURE(expected.event_id);
+    REQUIRE(actual.dl0->tels.size() == expected.dl0->tels.size());
+    for(const auto& [tel_id, dl0_camera]: expected.dl0->tels)
+    {
+        const auto* other = actual.dl0->get_tel(tel_id);
+        REQUIRE(other);
+        CHECK(same_values(other->image, dl0_camera->image));
+        CHECK(same_values(other->peak_time, dl0_camera->peak_time));
+    }
+    CHECK(actual.dl1->rejected_tels == expected.dl1->rejected_tels);
+    REQUIRE(actual.dl1->tels.size() == expected.dl1->tels.size());
+    for(const auto& [tel_id, dl1_camera]: expected.dl1->tels)
+    {
+        CAPTURE(tel_id);
+        const auto* other = actual.dl1->get_tel(tel_id);
+        REQUIRE(other);
+        const auto& parameters = dl1_camera->image_parameters;
+        const auto& other_parameters = other->image_parameters;
+        CHECK(same_bits(other_parameters.hillas, parameters.hillas));
+        CHECK(same_bits(other_parameters.leakage, parameters.leakage));
+        CHECK(same_bits(other_parameters.concentration, parameters.concentration));
+        CHECK(same_bits(other_parameters.morphology, parameters.morphology));
+        CHECK(same_bits(other_parameters.intensity, parameters.intensity));
+        CHECK(same_bits(other_parameters.extra, parameters.extra));
+        CHECK(other->mask == dl1_camera->mask);
+        CHECK(other->cleaned_image.pixel_id == dl1_camera->cleaned_image.pixel_id);
+        CHECK(other->cleaned_image.charge == dl1_camera->cleaned_image.charge);
+        CHECK(same_values(other->image, dl1_camera->image));
+    }
+    REQUIRE(actual.dl2->geometry.size() == expected.dl2->geometry.size());
+    for(const auto& [name, geometry]: expected.dl2->geometry)
+    {
+        const auto& other = actual.dl2->geometry.at(name);
+        CHECK(other.is_valid == geometry.is_valid);
+        CHECK(other.telescopes == geometry.telescopes);
+        CHECK(same_bits(other.alt, geometry.alt));
+        CHECK(same_bits(other.az, geometry.az));
+        CHECK(same_bits(other.core_x, geometry.core_x));
+        CHECK(same_bits(other.core_y, geometry.core_y));
+        CHECK(same_bits(other.hmax, geometry.hmax));
+    }
+}
+}
+
+TEST_CASE("Processors shared between threads")
+{
+    auto subarray = make_synthetic_subarray();
+    Calibrator calibrator(subarray);
+    ImageProcessor image_processor(subarray);
+    ShowerProcessor shower_processor(subarray);
+    auto serial_events = make_events(subarray);
+    int n_valid = 0;
+    for(auto& event: serial_events)
+    {
+        process(event, calibrator, image_processor, shower_processor);
+        n_valid += event.dl2->geometry.at("HillasReconstructor").is_valid;
+    }
+    // Most events are reconstructed, so the whole chain is compared
+    CHECK(n_valid > n_events / 2);
+    SUBCASE("test_one_instance_of_each_processor")
+    {
+        auto events = process_on_threads(subarray, calibrator, image_processor, shower_processor);
+        for(int i = 0; i < n_events; i++)
+        {
+            check_same_results(serial_events[i], events[i]);
+        }
+    }
+    SUBCASE("test_with_parallel_telescopes")
+    {
+        // The telescopes of each event also go to the shared thread pool, which the threads use at the same time
+        json parallel_config = {{"parallel_telescopes", true}, {"min_parallel_telescopes", 1}};
+        Calibrator parallel_calibrator(subarray, parallel_config);
+        ImageProcessor parallel_image_processor(subarray, parallel_config);
+        auto events = process_on_threads(subarray, parallel_calibrator, parallel_image_processor, shower_processor);
+        for(int i = 0; i < n_events; i++)
+        {
+            check_same_results(serial_events[i], events[i]);
+        }
+    }
+}
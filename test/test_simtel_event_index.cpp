@@ -0,0 +1,77 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+#include "SimtelEventIndex.hh"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+TEST_CASE("SimtelEventIndex")
+{
+    SimtelEventIndex index(1234, 5678);
+    // Monitor and calibration blocks of telescopes 1 and 2, the monitor of telescope 1 is updated before event 200
+    index.add_calibration_block({2022, 1, 16});
+    index.add_calibration_block({2023, 1, 32});
+    index.add_calibration_block({2022, 2, 48});
+    index.add_event({100, 0, 64, 128, 3});
+    index.add_event({101, 0, 512, 1024, 3});
+    index.add_calibration_block({2022, 1, 1536});
+    index.add_event({200, 2048, 2112, 2176, 4});
+    SUBCASE("test_lookup")
+    {
+        CHECK(index.size() == 3);
+        CHECK(index[1].mc_event_offset == 512);
+        CHECK(index.find_event_id(200).value() == 2);
+        CHECK(index.find_event_id(300).has_value() == false);
+    }
+    SUBCASE("test_calibration_blocks_before")
+    {
+        auto blocks = index.calibration_blocks_before(1);
+        REQUIRE(blocks.size() == 3);
+        CHECK(blocks[0].offset == 16);
+        CHECK(blocks[2].offset == 48);
+        // Only the last monitor of telescope 1 is needed for event 200
+        blocks = index.calibration_blocks_before(2);
+        REQUIRE(blocks.size() == 3);
+        CHECK(blocks[0].offset == 32);
+        CHECK(blocks[1].offset == 48);
+        CHECK(blocks[2].offset == 1536);
+        CHECK(blocks[2].type == 2022);
+        CHECK(blocks[2].ident == 1);
+    }
+    SUBCASE("test_sidecar")
+    {
+        auto index_path = (std::filesystem::temp_directory_path() / "test_simtel_event_index.idx").string();
+        REQUIRE(index.save(index_path));
+        auto loaded = SimtelEventIndex::load(index_path, 1234, 5678);
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->size() == 3);
+        CHECK(loaded->find_event_id(101).value() == 1);
+        CHECK((*loaded)[2].shower_offset == 2048);
+        CHECK((*loaded)[2].event_offset == 2176);
+        CHECK((*loaded)[2].n_calibration_blocks == 4);
+        CHECK(loaded->n_calibration_blocks() == 4);
+        CHECK(loaded->calibration_blocks_before(2).back().offset == 1536);
+        // An index made for a file of another size is outdated
+        CHECK(SimtelEventIndex::load(index_path, 4321, 5678).has_value() == false);
+        // So is one made for a file of the same size written at another time
+        CHECK(SimtelEventIndex::load(index_path, 1234, 8765).has_value() == false);
+        std::filesystem::remove(index_path);
+        CHECK(SimtelEventIndex::load(index_path, 1234, 5678).has_value() == false);
+    }
+}
+TEST_CASE("SimtelEventIndexFileStamp")
+{
+    auto simtel_path = (std::filesystem::temp_directory_path() / "test_simtel_event_index.simtel").string();
+    std::ofstream(simtel_path) << "0123456789";
+    SimtelEventIndex index;
+    index.set_file(simtel_path);
+    CHECK(index.file_size == 10);
+    CHECK(index.file_mtime == SimtelEventIndex::modification_time(simtel_path));
+    // A file rewritten with the same size, later than the index was made
+    auto index_time = std::filesystem::last_write_time(simtel_path);
+    std::ofstream(simtel_path) << "9876543210";
+    std::filesystem::last_write_time(simtel_path, index_time + std::chrono::seconds(10));
+    CHECK(std::filesystem::file_size(simtel_path) == index.file_size);
+    CHECK(SimtelEventIndex::modification_time(simtel_path) != index.file_mtime);
+    std::filesystem::remove(simtel_path);
+}
@@ -2,7 +2,23 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include "SimtelEventSource.hh"
+#include "MultiSimtelEventSource.hh"
+#include <cstdlib>
 #include <filesystem>
+#include <map>
+
+// All entries of a 1D histogram in statistics, including under- and overflow
+float histogram_entries(const Statistics& statistics, const std::string& name)
+{
+    auto hist = std::dynamic_pointer_cast<Histogram1D<float>>(statistics.histograms.at(name));
+    REQUIRE(hist);
+    float entries = hist->underflow() + hist->overflow();
+    for(int i = 0; i < hist->bins(); i++)
+    {
+        entries += hist->get_bin_content(i);
+    }
+    return entries;
+}
 
 TEST_CASE("SimtelEventSourceInitialize")
 {
@@ -40,6 +56,11 @@ TEST_CASE("SimtelEventSourceInitialize")
             CHECK_THROWS_AS(simtel_event_source[4], std::runtime_error);
             CHECK_THROWS_AS(simtel_event_source[11], std::out_of_range);
         }
+        SUBCASE("test_compressed_file_can_not_be_indexed")
+        {
+            CHECK_THROWS_AS(simtel_event_source.build_event_index(false), std::runtime_error);
+            CHECK(simtel_event_source.get_event_number(0).has_value() == false);
+        }
     }
     SUBCASE("test_subarray")
     {
@@ -47,13 +68,62 @@ TEST_CASE("SimtelEventSourceInitialize")
         CHECK(simtel_event_source.allowed_tels.size() == 3);
         CHECK(simtel_event_source.subarray->tels.size() == 3);
         CHECK(simtel_event_source.subarray->tel_positions.size() == 3);
+        for(const auto& event: simtel_event_source) {
+            for(const auto& [tel_id, _]: event.r0->tels) {
+                CHECK((tel_id >= 1 && tel_id <= 3));
+            }
+        }
+    }
+    SUBCASE("test_subarray_same_as_full_read")
+    {
+        // The selected telescopes are decoded as if all telescopes were read
+        SimtelEventSource full_source(test_file.string());
+        SimtelEventSource selected_source(test_file.string(), -1, {1, 2, 3});
+        auto full_it = full_source.begin();
+        int n_events = 0;
+        for(auto selected_it = selected_source.begin(); selected_it != selected_source.end(); ++selected_it, ++full_it) {
+            REQUIRE(full_it != full_source.end());
+            const auto& full_event = *full_it;
+            const auto& selected_event = *selected_it;
+            CHECK(selected_event.event_id == full_event.event_id);
+            for(const auto tel_id: {1, 2, 3}) {
+                const auto* full_tel = full_event.r0->get_tel(tel_id);
+                const auto* selected_tel = selected_event.r0->get_tel(tel_id);
+                REQUIRE((full_tel == nullptr) == (selected_tel == nullptr));
+                if(!full_tel) {
+                    continue;
+                }
+                CHECK(selected_tel->waveform[0] == full_tel->waveform[0]);
+                CHECK(selected_tel->waveform[1] == full_tel->waveform[1]);
+                CHECK(selected_event.pointing->tels.contains(tel_id) == full_event.pointing->tels.contains(tel_id));
+            }
+            n_events++;
+        }
+        CHECK(n_events > 0);
+        CHECK(full_it == full_source.end());
     }
     SUBCASE("test_load_simulated_shower_true")
     {
         SimtelEventSource simtel_event_source(test_file.string(), -1, {}, true);
+        // The showers are collected while reading the events
+        CHECK(simtel_event_source.shower_array.has_value() == false);
+        for(const auto& event: simtel_event_source) {
+            // do no things
+        }
         CHECK(simtel_event_source.shower_array.has_value() == true);
         CHECK(simtel_event_source.shower_array->size() > 0);
     }
+    SUBCASE("test_load_simulated_shower_before_reading")
+    {
+        SimtelEventSource simtel_event_source(test_file.string(), 10, {}, false);
+        auto n_showers = simtel_event_source.get_shower_array().size();
+        CHECK(n_showers > 0);
+        int all_event = 0;
+        for(const auto& event: simtel_event_source) {
+            all_event++;
+        }
+        CHECK(all_event == 10);
+    }
     SUBCASE("test_load_simulated_shower_false")
     {
         SimtelEventSource simtel_event_source(test_file.string(), 10, {}, false);
@@ -64,4 +134,122 @@ TEST_CASE("SimtelEventSourceInitialize")
         CHECK(simtel_event_source.get_shower_array().size() > 0);
     }
     
-}
\ No newline at end of file
+}
+TEST_CASE("SimtelEventSourceRandomAccess")
+{
+    auto test_directory = std::filesystem::path(__FILE__);
+    auto test_file = test_directory.parent_path() / "test_data" / "lact_prod0_simtel_particle_gamma_energy_1000.0_1000.0_zenith_0.0_azimuth_0.0_run_1_event_0.zst";
+    // Only uncompressed files can be indexed
+    auto simtel_file = (std::filesystem::temp_directory_path() / "test_simtel_random_access.simtel").string();
+    auto decompress = "zstd -d -q -f \"" + test_file.string() + "\" -o \"" + simtel_file + "\"";
+    if(std::system(decompress.c_str()) != 0)
+    {
+        MESSAGE("zstd is not available, skip the random access test");
+        return;
+    }
+    // What a sequential read gives for each event
+    struct SequentialEvent {
+        int event_id;
+        std::map<int, std::shared_ptr<const TelMonitor>> monitors;
+        std::map<int, R1WaveformMatrix> r1_waveforms;
+    };
+    std::vector<SequentialEvent> sequential_events;
+    {
+        SimtelEventSource sequential_source(simtel_file);
+        for(const auto& event: sequential_source) {
+            auto& sequential_event = sequential_events.emplace_back(SequentialEvent{.event_id = event.event_id});
+            for(const auto& [tel_id, tel_monitor]: event.monitor->tels) {
+                sequential_event.monitors[tel_id] = *tel_monitor;
+            }
+            for(const auto& [tel_id, r1_camera]: event.r1->tels) {
+                sequential_event.r1_waveforms[tel_id] = r1_camera->waveform;
+            }
+        }
+    }
+    REQUIRE(sequential_events.size() > 1);
+    CHECK(std::filesystem::exists(SimtelEventIndex::sidecar_path(simtel_file)) == false);
+
+    SimtelEventSource source(simtel_file);
+    source.build_event_index(false);
+    REQUIRE(source.is_stream == false);
+    // Backwards, so each event is read after the blocks of the later events
+    for(int index = static_cast<int>(sequential_events.size()) - 1; index >= 0; index--) {
+        const auto& expected = sequential_events[index];
+        auto event = source[index];
+        CHECK(event.event_id == expected.event_id);
+        REQUIRE(event.monitor->tels.size() == expected.monitors.size());
+        for(const auto& [tel_id, expected_monitor]: expected.monitors) {
+            const auto* tel_monitor = event.monitor->get_tel(tel_id);
+            REQUIRE(tel_monitor != nullptr);
+            CHECK(tel_monitor->pedestal_per_sample == expected_monitor->pedestal_per_sample);
+            CHECK(tel_monitor->dc_to_pe == expected_monitor->dc_to_pe);
+        }
+        REQUIRE(event.r1->tels.size() == expected.r1_waveforms.size());
+        for(const auto& [tel_id, expected_waveform]: expected.r1_waveforms) {
+            const auto* r1_camera = event.r1->get_tel(tel_id);
+            REQUIRE(r1_camera != nullptr);
+            CHECK(r1_camera->waveform == expected_waveform);
+        }
+    }
+    std::filesystem::remove(simtel_file);
+}
+TEST_CASE("MultiSimtelEventSource")
+{
+    auto test_directory = std::filesystem::path(__FILE__);
+    auto test_file = (test_directory.parent_path() / "test_data" / "lact_prod0_simtel_particle_gamma_energy_1000.0_1000.0_zenith_0.0_azimuth_0.0_run_1_event_0.zst").string();
+    SimtelEventSource single_source(test_file, -1, {}, true);
+    int n_single_events = 0;
+    for(const auto& event: single_source) {
+        n_single_events++;
+    }
+    auto n_single_showers = single_source.shower_array->size();
+    REQUIRE(single_source.statistics.has_value());
+    CHECK(histogram_entries(*single_source.statistics, SimtelEventSource::event_energy_histogram) == n_single_events);
+    SUBCASE("test_ordered")
+    {
+        MultiSimtelEventSource multi_source({test_file, test_file}, 2, true, -1, {}, true);
+        CHECK(multi_source.subarray->tels.size() == 16);
+        int n_events = 0;
+        for(const auto& event: multi_source) {
+            n_events++;
+        }
+        CHECK(n_events == 2 * n_single_events);
+        CHECK(multi_source.get_shower_array().size() == 2 * n_single_showers);
+        REQUIRE(multi_source.statistics.has_value());
+        CHECK(histogram_entries(*multi_source.statistics, SimtelEventSource::event_energy_histogram) == 2 * n_single_events);
+    }
+    SUBCASE("test_unordered_statistics")
+    {
+        MultiSimtelEventSource multi_source({test_file, test_file, test_file}, 2, false);
+        for(const auto& event: multi_source) {
+        }
+        REQUIRE(multi_source.statistics.has_value());
+        CHECK(histogram_entries(*multi_source.statistics, SimtelEventSource::event_energy_histogram) == 3 * n_single_events);
+    }
+    SUBCASE("test_unordered_max_events")
+    {
+        MultiSimtelEventSource multi_source({test_file, test_file, test_file}, 3, false, 5, {1, 2, 3});
+        CHECK(multi_source.subarray->tels.size() == 3);
+        int n_events = 0;
+        for(const auto& event: multi_source) {
+            n_events++;
+        }
+        CHECK(n_events == std::min(5, 3 * n_single_events));
+    }
+    SUBCASE("test_no_match")
+    {
+        CHECK_THROWS_AS(MultiSimtelEventSource::expand_glob("not_exist_*.simtel.zst"), std::runtime_error);
+    }
+}
+TEST_CASE("StatisticsMerge")
+{
+    Statistics first;
+    first.add_histogram("energy", make_regular_histogram<float>(-1, 3, 60));
+    first.fill_1d("energy", 1.0f);
+    Statistics merged;
+    merged += first;
+    merged += first;
+    CHECK(histogram_entries(merged, "energy") == 2);
+    // The merged histogram is a copy, the one of the first statistics is unchanged
+    CHECK(histogram_entries(first, "energy") == 1);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file test_synthetic_events.hh
+ * @brief Synthetic subarray and events with shower images, to run the processors without simtel files
+ */
+#pragma once
+#include "ArrayEvent.hh"
+#include "SubarrayDescription.hh"
+#include "test_camera_helpers.hh"
+#include <array>
+#include <cmath>
+#include <random>
+
+constexpr int synthetic_n_rings = 12;
+constexpr int synthetic_n_samples = 30;
+constexpr int synthetic_peak_sample = 12;
+constexpr double synthetic_altitude = 1.2;
+// Size of the camera unit in the field of view, in rad
+constexpr double synthetic_fov_scale = 0.002;
+constexpr std::array<int, 4> synthetic_tel_ids{1, 2, 5, 9};
+
+/**
+ * @brief Four telescopes on a square, all with the same hexagonal camera and a one channel readout
+ */
+inline SubarrayDescription make_synthetic_subarray()
+{
+    auto camera_geometry = std::make_shared<const CameraGeometry>(make_hex_camera(synthetic_n_rings, synthetic_fov_scale));
+    // Gaussian reference pulse with a sigma of two samples, sampled every 0.1 ns
+    Eigen::MatrixXd reference_pulse(1, 400);
+    for(int i = 0; i < reference_pulse.cols(); i++)
+    {
+        double t = (i + 0.5) * 0.1 - 10;
+        reference_pulse(0, i) = std::exp(-0.5 * t * t / 4);
+    }
+    SubarrayDescription subarray;
+    const std::array<std::array<double, 3>, synthetic_tel_ids.size()> positions{{{100, 100, 0}, {-100, 100, 0}, {-100, -100, 0}, {100, -100, 0}}};
+    for(size_t i = 0; i < synthetic_tel_ids.size(); i++)
+    {
+        TelescopeDescription tel;
+        tel.camera_description.camera_name = "hex";
+        tel.camera_description.camera_geometry = camera_geometry;
+        auto& readout = tel.camera_description.camera_readout;
+        readout.camera_name = "hex";
+        readout.sampling_rate = 1.0;
+        readout.reference_pulse_sample_width = 0.1;
+        readout.reference_pulse_shape = reference_pulse;
+        readout.n_channels = 1;
+        readout.n_pixels = camera_geometry->num_pixels;
+        readout.n_samples = synthetic_n_samples;
+        subarray.add_telescope(synthetic_tel_ids[i], std::move(tel), positions[i]);
+    }
+    return subarray;
+}
+
+/**
+ * @brief Fill the event with R1 waveforms of elliptical images pointing to a common source, the pointing and the shower.
+ *        The images only depend on event_index. The telescope storage of a recycled event is reused.
+ */
+inline void fill_synthetic_event(ArrayEvent& event, int event_index, const SubarrayDescription& subarray)
+{
+    std::mt19937 rng(event_index);
+    std::normal_distribution<double> noise(0, 0.3);
+    event.event_id = event_index;
+    auto& simulation = event.emplace_level<SimulatedEvent>();
+    simulation.shower.energy = 1.0;
+    simulation.shower.az = 0;
+    simulation.shower.alt = synthetic_altitude;
+    simulation.shower.core_x = 0;
+    simulation.shower.core_y = 0;
+    auto& pointing = event.emplace_level<Pointing>();
+    pointing.set_array_pointing(0, synthetic_altitude);
+    auto& r1 = event.emplace_level<R1Event>();
+    std::array<double, synthetic_n_samples> pulse;
+    double pulse_sum = 0;
+    for(int k = 0; k < synthetic_n_samples; k++)
+    {
+        pulse[k] = std::exp(-0.5 * std::pow((k - synthetic_peak_sample) / 2.0, 2));
+        pulse_sum += pulse[k];
+    }
+    // The source moves around the camera center from event to event
+    const double source_x = 0.5 * std::sin(event_index);
+    const double source_y = 0.5 * std::cos(event_index);
+    for(size_t i = 0; i < synthetic_tel_ids.size(); i++)
+    {
+        const int tel_id = synthetic_tel_ids[i];
+        const auto& camera_geometry = *subarray.tels.at(tel_id).camera_description.camera_geometry;
+        const int n_pixels = camera_geometry.num_pixels;
+        pointing.add_tel(tel_id, PointingTelescope{.azimuth = 0, .altitude = synthetic_altitude});
+        const double psi = 0.7 * event_index + M_PI / 2 * i + 0.3;
+        const double cog_x = source_x + 3 * std::cos(psi);
+        const double cog_y = source_y + 3 * std::sin(psi);
+        const double amplitude = 150 + 10 * (event_index % 7);
+        auto* r1_camera = r1.reuse_tel(tel_id);
+        r1_camera->n_pixels = n_pixels;
+        r1_camera->n_samples = synthetic_n_samples;
+        r1_camera->gain_selection.setZero(n_pixels);
+        r1_camera->waveform.resize(n_pixels, synthetic_n_samples);
+        for(int pix = 0; pix < n_pixels; pix++)
+        {
+            const double dx = camera_geometry.pix_x[pix] - cog_x;
+            const double dy = camera_geometry.pix_y[pix] - cog_y;
+            const double l = dx * std::cos(psi) + dy * std::sin(psi);
+            const double w = -dx * std::sin(psi) + dy * std::cos(psi);
+            const double charge = amplitude * std::exp(-0.5 * (l * l / 6.25 + w * w / 0.64));
+            for(int k = 0; k < synthetic_n_samples; k++)
+            {
+                r1_camera->waveform(pix, k) = static_cast<float>(charge * pulse[k] / pulse_sum + noise(rng));
+            }
+        }
+    }
+}
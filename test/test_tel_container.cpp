@@ -0,0 +1,69 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "DL0Event.hh"
+#include "Pointing.hh"
+#include "doctest/doctest.h"
+#include <stdexcept>
+
+TEST_CASE("BaseTelContainer")
+{
+    DL0Event dl0;
+    auto* dl0_camera = dl0.add_tel(70);
+    REQUIRE(dl0_camera != nullptr);
+    dl0_camera->image = Eigen::VectorXd::Ones(3);
+    dl0.add_tel(3);
+    dl0.add_tel(64);
+    SUBCASE("test_add_and_get")
+    {
+        CHECK(dl0.add_tel(3) == nullptr);
+        CHECK(dl0.tels.size() == 3);
+        CHECK(dl0.get_tel(70)->image.size() == 3);
+        CHECK(dl0.get_tel(4) == nullptr);
+        CHECK(dl0.get_tel(1000) == nullptr);
+        CHECK_THROWS_AS(dl0.tels.at(4), std::out_of_range);
+        CHECK_THROWS_AS(dl0.add_tel(-1), std::out_of_range);
+    }
+    SUBCASE("test_ascending_iteration")
+    {
+        std::vector<int> tel_ids;
+        for(const auto& [tel_id, camera]: dl0.tels) {
+            CHECK(camera == dl0.get_tel(tel_id));
+            tel_ids.push_back(tel_id);
+        }
+        CHECK(tel_ids == std::vector<int>{3, 64, 70});
+        CHECK(dl0.get_ordered_tels() == tel_ids);
+        CHECK(dl0.get_tels().size() == 3);
+    }
+    SUBCASE("test_move_and_clear")
+    {
+        DL0Event moved = std::move(dl0);
+        CHECK(moved.tels.size() == 3);
+        CHECK(moved.get_tel(70)->image.size() == 3);
+        moved.tels.clear();
+        CHECK(moved.tels.empty());
+        CHECK(moved.tels.begin() == moved.tels.end());
+        CHECK(moved.add_tel(70) != nullptr);
+    }
+    SUBCASE("test_reset_and_reuse")
+    {
+        const auto* image = dl0.get_tel(70)->image.data();
+        dl0.reset();
+        CHECK(dl0.tels.empty());
+        CHECK(dl0.get_tel(70) == nullptr);
+        auto* reused = dl0.reuse_tel(70);
+        REQUIRE(reused != nullptr);
+        CHECK(reused->image.data() == image);
+        CHECK(dl0.reuse_tel(70) == nullptr);
+        CHECK(dl0.reuse_tel(200)->image.size() == 0);
+        CHECK(dl0.get_ordered_tels() == std::vector<int>{70, 200});
+        // Adding a telescope replaces the data left in its slot
+        CHECK(dl0.add_tel(3)->image.size() == 0);
+    }
+    SUBCASE("test_aggregate_arguments")
+    {
+        Pointing pointing;
+        pointing.add_tel(2, 1.0, 2.0);
+        pointing.add_tel(5, PointingTelescope{.azimuth = 3.0, .altitude = 4.0});
+        CHECK(pointing.tels.at(2)->altitude == 2.0);
+        CHECK(pointing.tels.at(5)->azimuth == 3.0);
+    }
+}
@@ -0,0 +1,45 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "ThreadPool.hh"
+#include "doctest/doctest.h"
+#include <atomic>
+#include <stdexcept>
+
+TEST_CASE("ThreadPool")
+{
+    ThreadPool pool(3);
+    SUBCASE("test_all_indices_once")
+    {
+        std::vector<std::atomic<int>> calls(1000);
+        pool.parallel_for(calls.size(), [&calls](size_t i) { calls[i]++; });
+        for(const auto& n_calls: calls) {
+            CHECK(n_calls == 1);
+        }
+    }
+    SUBCASE("test_nested")
+    {
+        std::atomic<int> total = 0;
+        pool.parallel_for(8, [&pool, &total](size_t) {
+            pool.parallel_for(8, [&total](size_t) { total++; });
+        });
+        CHECK(total == 64);
+    }
+    SUBCASE("test_exception")
+    {
+        std::atomic<int> n_calls = 0;
+        CHECK_THROWS_AS(pool.parallel_for(20, [&n_calls](size_t i) {
+            n_calls++;
+            if(i == 5) {
+                throw std::runtime_error("task failed");
+            }
+        }), std::runtime_error);
+        // The other tasks still run
+        CHECK(n_calls == 20);
+    }
+    SUBCASE("test_without_threads")
+    {
+        ThreadPool serial_pool(0);
+        int sum = 0;
+        serial_pool.parallel_for(10, [&sum](size_t i) { sum += i; });
+        CHECK(sum == 45);
+    }
+}